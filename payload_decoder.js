@@ -1,34 +1,148 @@
-function decodeUplink(input) {
-    // input payload is an array of bytes (e.g., input.bytes)
-    var bytes = input.bytes;
+// TTN uplink decoder
+// generated by tools/codegen/uplink_gen.py from tools/codegen/uplink_schema.json,
+// do not edit: change the schema and run
+//   python3 tools/codegen/uplink_gen.py --js payload_decoder.js
+
+// bit reader, MSB first; arithmetic instead of bitwise operators, which work on 32 bits
+function readBits(bytes, state, n) {
+    var value = 0;
+    for (var i = 0; i < n; i++) {
+        var bit = (bytes[state.pos >> 3] >> (7 - (state.pos & 7))) & 1;
+        value = value * 2 + bit;
+        state.pos++;
+    }
+    return value;
+}
 
-    // decode the uint64 timestamp (big-endian representation)
-    var unixTimestamp = (bytes[0] << 56 >>> 0) | (bytes[1] << 48) | (bytes[2] << 40) | (bytes[3] << 32) | (bytes[4] << 24) | (bytes[5] << 16) | (bytes[6] << 8) | bytes[7]; // use `>>> 0` to ensure unsigned shift
+function decode_telemetry(bytes) {
+    if (bytes.length * 8 < 69) {
+        return { errors: ["telemetry frame too short"] };
+    }
+    var header = bytes[0];
+    if (header !== 18) {
+        return { errors: ["unsupported telemetry type/version " + header] };
+    }
+    var state = { pos: 8 };
+    var data = {};
+    var has_velocity = readBits(bytes, state, 1);
+    data.time = new Date((readBits(bytes, state, 32)) * 1000).toISOString();  // s
+    data.battery = readBits(bytes, state, 7);  // %
+    data.temperature = Math.round((-4000 + readBits(bytes, state, 11) * 10) * 0.01 * 1e6) / 1e6;  // degC
+    data.humidity = Math.round((readBits(bytes, state, 10) * 10) * 0.01 * 1e6) / 1e6;  // %RH
+    if (has_velocity) {
+        data.velocity = -32768 + readBits(bytes, state, 16);
+    }
+    return { data: data };
+}
 
-    // convert and display Unix timestamp as a human-readable date and time 
-    var date = new Date(unixTimestamp * 1000); // convert seconds to milliseconds
-    var readable_date = date.toISOString(); // ISO format (YYYY-MM-DDTHH:mm:ss.sssZ)
+function decode_waveform_fragment(bytes) {
+    if (bytes.length * 8 < 32) {
+        return { errors: ["waveform_fragment frame too short"] };
+    }
+    var header = bytes[0];
+    if (header !== 33) {
+        return { errors: ["unsupported waveform_fragment type/version " + header] };
+    }
+    var state = { pos: 8 };
+    var data = {};
+    data.seq = readBits(bytes, state, 8);
+    data.index = readBits(bytes, state, 8);
+    data.count = 1 + readBits(bytes, state, 8);
+    // followed by the window slice: epoch ms (uint64, big-endian) then uint16 samples (little-endian)
+    data.payload_bytes = bytes.length - (state.pos + 7 >> 3);
+    return { data: data };
+}
 
-    // decode the int16 values (big-endian representation)
-    var battery = (bytes[8] << 8) | bytes[9];
-    var temperature = (bytes[10] << 8) | bytes[11];
-    var humidity = (bytes[12] << 8) | bytes[13];     
-    var velocity = (bytes[14] << 8) | bytes[15];
+function decode_trigger(bytes) {
+    if (bytes.length * 8 < 81) {
+        return { errors: ["trigger frame too short"] };
+    }
+    var header = bytes[0];
+    if (header !== 49) {
+        return { errors: ["unsupported trigger type/version " + header] };
+    }
+    var state = { pos: 8 };
+    var data = {};
+    data.seq = readBits(bytes, state, 8);
+    data.time = new Date((readBits(bytes, state, 32)) * 1000).toISOString();  // s
+    data.ms = readBits(bytes, state, 10);  // ms
+    data.timed = readBits(bytes, state, 1);
+    data.ratio = Math.round((readBits(bytes, state, 10)) * 0.1 * 1e6) / 1e6;
+    data.sta = readBits(bytes, state, 12);  // counts
+    return { data: data };
+}
 
-    // convert to signed 16-bit integers
-    if (battery & 0x8000) battery -= 0x10000;
-    if (temperature & 0x8000) temperature -= 0x10000;
-    if (humidity & 0x8000) humidity -= 0x10000;
-    if (velocity & 0x8000) velocity -= 0x10000;
+function decode_noise(bytes) {
+    if (bytes.length * 8 < 82) {
+        return { errors: ["noise frame too short"] };
+    }
+    var header = bytes[0];
+    if (header !== 65) {
+        return { errors: ["unsupported noise type/version " + header] };
+    }
+    var state = { pos: 8 };
+    var data = {};
+    data.period = 1 + readBits(bytes, state, 10);  // ms
+    data.segments = readBits(bytes, state, 16);
+    data.band0 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    data.band1 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    data.band2 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    data.band3 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    data.band4 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    data.band5 = Math.round((-400 + readBits(bytes, state, 8) * 5) * 0.1 * 1e6) / 1e6;  // dB
+    return { data: data };
+}
 
-    // return decoded values as JSON
-    return {
-        data: {
-            Timestamp: readable_date,   // timestamp (human-readable format)
-            Battery: battery,           // battery level as int16
-            Temperature: temperature,   // temperature (adjust as needed)
-            Humidity: humidity,         // humidity (adjust as needed)
-            Velocity: velocity          // velocity level as int16                 
-        },
-    };
-}
\ No newline at end of file
+function decode_event(bytes) {
+    if (bytes.length * 8 < 178) {
+        return { errors: ["event frame too short"] };
+    }
+    var header = bytes[0];
+    if (header !== 81) {
+        return { errors: ["unsupported event type/version " + header] };
+    }
+    var state = { pos: 8 };
+    var data = {};
+    data.seq = readBits(bytes, state, 8);
+    data.model = readBits(bytes, state, 8);
+    data.label = readBits(bytes, state, 2);
+    data.margin = readBits(bytes, state, 7);
+    data.sent = readBits(bytes, state, 1);
+    data.duration = -128 + readBits(bytes, state, 8);
+    data.peak_ratio = -128 + readBits(bytes, state, 8);
+    data.peak_sta = -128 + readBits(bytes, state, 8);
+    data.rise = -128 + readBits(bytes, state, 8);
+    data.hv = -128 + readBits(bytes, state, 8);
+    data.freq = -128 + readBits(bytes, state, 8);
+    data.onset0 = -128 + readBits(bytes, state, 8);
+    data.onset1 = -128 + readBits(bytes, state, 8);
+    data.onset2 = -128 + readBits(bytes, state, 8);
+    data.onset3 = -128 + readBits(bytes, state, 8);
+    data.onset4 = -128 + readBits(bytes, state, 8);
+    data.onset5 = -128 + readBits(bytes, state, 8);
+    data.coda0 = -128 + readBits(bytes, state, 8);
+    data.coda1 = -128 + readBits(bytes, state, 8);
+    data.coda2 = -128 + readBits(bytes, state, 8);
+    data.coda3 = -128 + readBits(bytes, state, 8);
+    data.coda4 = -128 + readBits(bytes, state, 8);
+    data.coda5 = -128 + readBits(bytes, state, 8);
+    return { data: data };
+}
+
+function decodeUplink(input) {
+    switch (input.fPort) {
+    case 2:
+        return decode_telemetry(input.bytes);
+    case 5:
+        return decode_waveform_fragment(input.bytes);
+    case 6:
+        return decode_trigger(input.bytes);
+    case 7:
+        return decode_noise(input.bytes);
+    case 8:
+        return decode_event(input.bytes);
+    default:
+        // health (3) and energy (4) records are decoded by the ingest tool
+        return { data: { port: input.fPort, bytes: input.bytes.length } };
+    }
+}
@@ -6,20 +6,48 @@
  */
 
 #include "app_adc.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include "app_log.h"
+#include <string.h>
+
+// hardware sample timestamps need TIMER2 and PPI (nRF52), other targets stamp in software
+#if defined(CONFIG_NRFX_TIMER2) && defined(CONFIG_NRFX_PPI)
+#define ADC_HW_TIMESTAMPS   1
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_saadc.h>
+#else
+#define ADC_HW_TIMESTAMPS   0
+#endif
+
+LOG_MODULE_REGISTER(app_adc, CONFIG_APP_ADC_LOG_LEVEL);
 
 //  ========== globals =====================================================================
-// ADC buffer to store raw ADC readings
+// ADC buffer to store raw ADC readings: battery, and one scan of the geophone components
 static int16_t buffer1;
-static int16_t buffer0;
-static uint16_t ring_buffer[ADC_BUFFER_SIZE];
+static int16_t scan[ADC_COMPONENTS];
+
+// one ring per component, all indexed by ring_head
+static uint16_t ring_buffer[ADC_COMPONENTS][ADC_BUFFER_SIZE];
 static uint32_t sampling_rate_ms = SAMPLING_RATE_MS;
 static bool stop_sampling = false;
 static bool adc_initialized = false;
 
-// ADC channel configuration obtained from the device tree
-static const struct adc_dt_spec adc_channel = ADC_DT_SPEC_GET(DT_PATH(zephyr_user));
+// ADC channel configuration obtained from the device tree, see ADC_IO_*
+static const struct adc_dt_spec adc_channels[] = {
+    DT_FOREACH_PROP_ELEM_SEP(DT_PATH(zephyr_user), io_channels, ADC_DT_SPEC_GET_BY_IDX, (,))
+};
 static struct adc_sequence sequence0, sequence1;
 
+// the scan result is in channel order, it must match the component order
+BUILD_ASSERT(ARRAY_SIZE(adc_channels) == ADC_IO_GEOPHONE_E + 1, "Z, battery, N and E channels");
+BUILD_ASSERT(DT_IO_CHANNELS_INPUT_BY_IDX(DT_PATH(zephyr_user), ADC_IO_GEOPHONE_Z) <
+             DT_IO_CHANNELS_INPUT_BY_IDX(DT_PATH(zephyr_user), ADC_IO_GEOPHONE_N) &&
+             DT_IO_CHANNELS_INPUT_BY_IDX(DT_PATH(zephyr_user), ADC_IO_GEOPHONE_N) <
+             DT_IO_CHANNELS_INPUT_BY_IDX(DT_PATH(zephyr_user), ADC_IO_GEOPHONE_E),
+             "geophone channels must be numbered Z < N < E");
+
 // define a stack for the ADC thread, with a size of 1024 bytes
 K_THREAD_STACK_DEFINE(adc_stack, 1024);
 
@@ -38,105 +66,228 @@ K_SEM_DEFINE(data_ready_sem, 0, 1);
 // semaphore to signal sampling rate change
 K_SEM_DEFINE(rate_change_sem, 0, 1);
 
-// define a ring buffer to store ADC samples
-static uint16_t ring_buffer[ADC_BUFFER_SIZE];
-
 // index to track the head of the ring buffer
 int ring_head = 0;
 
-// configure ADC sequence
-static int8_t configure_adc_sequence(struct adc_sequence *sequence, uint8_t channel_bitmask, void *buffer, size_t buffer_size) {
-    sequence->channels = BIT(channel_bitmask);
+// cycle counter when data_ready_sem was last given, for the consumer wake-up latency
+uint32_t data_ready_cycles;
+
+// hardware sample timestamps: the SAADC DONE event captures TIMER2 (1 MHz) through PPI,
+// so the sample instant is recorded without CPU involvement or thread latency. The timer
+// only runs around each scan, started with a kernel tick reference, so that it does not
+// keep the high-frequency clock on between samples
+#if ADC_HW_TIMESTAMPS
+static const nrfx_timer_t adc_timer = NRFX_TIMER_INSTANCE(2);
+static int64_t scan_ref_ticks;
+#endif
+static bool adc_timestamps = false;
+
+// mutex to keep the captured timestamp paired with the conversion that produced it
+K_MUTEX_DEFINE(adc_read_lock);
+
+// uptime (us) of the first sample of each acquisition block, indexed by block number;
+// one extra slot keeps the base of the oldest, partially overwritten block
+static int64_t block_ts_us[ADC_BLOCK_COUNT + 1];
+
+static int64_t last_ts_us = -1;
+static uint32_t sample_count = 0;
+BUILD_ASSERT(ADC_BUFFER_SIZE % ADC_BLOCK_SIZE == 0, "ring must hold whole blocks");
+
+// configure ADC sequence, several channels make a scan
+static int8_t configure_adc_sequence(struct adc_sequence *sequence, uint32_t channels, void *buffer, size_t buffer_size) {
+    sequence->channels = channels;
     sequence->buffer = buffer;
     sequence->buffer_size = buffer_size;
-    return adc_sequence_init_dt(&adc_channel, sequence);
+    return adc_sequence_init_dt(&adc_channels[ADC_IO_GEOPHONE_Z], sequence);
+}
+
+#if ADC_HW_TIMESTAMPS
+//  ========== adc_timer_handler ============================================================
+static void adc_timer_handler(nrf_timer_event_t event_type, void *p_context)
+{
+    // compare events are not used, the timer only runs for captures
+}
+
+//  ========== adc_timestamp_init ==========================================================
+// 32-bit timer at 1 MHz, stopped until a scan, and PPI link SAADC DONE -> TIMER CAPTURE0
+static int8_t adc_timestamp_init(void)
+{
+    nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(NRFX_MHZ_TO_HZ(1));
+    uint8_t channel;
+
+    config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    if (nrfx_timer_init(&adc_timer, &config, adc_timer_handler) != NRFX_SUCCESS) {
+        return -EIO;
+    }
+
+    if (nrfx_gppi_channel_alloc(&channel) != NRFX_SUCCESS) {
+        return -EBUSY;
+    }
+    nrfx_gppi_channel_endpoints_setup(channel,
+            nrf_saadc_event_address_get(NRF_SAADC, NRF_SAADC_EVENT_DONE),
+            nrfx_timer_task_address_get(&adc_timer, NRF_TIMER_TASK_CAPTURE0));
+    nrfx_gppi_channels_enable(BIT(channel));
+    return 0;
+}
+
+//  ========== adc_timer_start =============================================================
+// start the timer from 0 for one scan, together with the kernel tick count (error below
+// one tick, as for the software timestamps)
+static void adc_timer_start(void)
+{
+    unsigned int key = irq_lock();
+    nrfx_timer_clear(&adc_timer);
+    nrfx_timer_enable(&adc_timer);
+    scan_ref_ticks = k_uptime_ticks();
+    irq_unlock(key);
+}
+
+//  ========== adc_capture_us ==============================================================
+// uptime (us) of the last conversion from the hardware capture, then the timer is shut
+// down; its running time goes to the energy ledger
+static int64_t adc_capture_us(void)
+{
+    uint32_t done = nrfx_timer_capture_get(&adc_timer, NRF_TIMER_CC_CHANNEL0);
+    uint32_t running = nrfx_timer_capture(&adc_timer, NRF_TIMER_CC_CHANNEL1);
+    nrfx_timer_disable(&adc_timer);
+
+    app_energy_add(ENERGY_TIMER, running);
+    return k_ticks_to_us_floor64(scan_ref_ticks) + done;
+}
+#else
+//  ========== adc_timestamp_init ==========================================================
+static int8_t adc_timestamp_init(void)
+{
+    return 0;
+}
+
+//  ========== adc_timer_start =============================================================
+static void adc_timer_start(void)
+{
+}
+
+//  ========== adc_capture_us ==============================================================
+// software timestamp taken right after the conversion (emulated ADC on native_sim)
+static int64_t adc_capture_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
 }
+#endif
 
 //  ========== app_nrf52_adc_init ==========================================================
 int8_t app_nrf52_adc_init()
 {
     if (adc_initialized) {
-        printk("ADC is already initialized\n");
+        LOG_INF("ADC is already initialized");
         return 0;
     }
 
-   if (!adc_is_ready_dt(&adc_channel)) {
-        printk("ADC is not ready. Check hardware configuration.\n");
+   if (!adc_is_ready_dt(&adc_channels[ADC_IO_GEOPHONE_Z])) {
+        LOG_ERR("ADC is not ready. Check hardware configuration.");
         return -1;
     }
 
-    int8_t err = adc_channel_setup_dt(&adc_channel);
-    if (err < 0) {
-        printk("failed to setup ADC channel. Error: %d\n", err);
-        return err;
+    for (size_t i = 0; i < ARRAY_SIZE(adc_channels); i++) {
+        int8_t err = adc_channel_setup_dt(&adc_channels[i]);
+        if (err < 0) {
+            LOG_ERR("failed to setup ADC channel %u. Error: %d", adc_channels[i].channel_id, err);
+            return err;
+        }
     }
 
-    if (configure_adc_sequence(&sequence0, 0, &buffer0, sizeof(buffer0)) < 0 ||
-        configure_adc_sequence(&sequence1, 1, &buffer1, sizeof(buffer1)) < 0) {
-        printk("failed to configure ADC sequences\n");
+    // Z, N and E converted back to back in one scan, one wake-up per sample for all three
+    uint32_t geophone = BIT(adc_channels[ADC_IO_GEOPHONE_Z].channel_id) |
+                        BIT(adc_channels[ADC_IO_GEOPHONE_N].channel_id) |
+                        BIT(adc_channels[ADC_IO_GEOPHONE_E].channel_id);
+    if (configure_adc_sequence(&sequence0, geophone, scan, sizeof(scan)) < 0 ||
+        configure_adc_sequence(&sequence1, BIT(adc_channels[ADC_IO_BATTERY].channel_id),
+                               &buffer1, sizeof(buffer1)) < 0) {
+        LOG_ERR("failed to configure ADC sequences");
         return -1;
     }
 
+    if (adc_timestamp_init() == 0) {
+        adc_timestamps = true;
+    } else {
+        LOG_ERR("failed to set up ADC sample timestamps");
+    }
+
     adc_initialized = true;
-    printk("ADC initialized successfully\n");
+    LOG_INF("ADC initialized successfully");
     return 1;
 }
 
 //  ========== app_nrf52_get_ain1 ==========================================================
+// battery voltage (mV) on AIN1, negative on ADC error; state of charge is in app_power
 int16_t app_nrf52_get_ain1()
 {
-    int16_t percent;
-
     // read sample from the ADC
-    if (adc_read(adc_channel.dev, &sequence1) < 0) {        
-	    printk("failed to read ADC sequence 1.\n");
-	    return 0;
+    k_mutex_lock(&adc_read_lock, K_FOREVER);
+    int err = adc_read(adc_channels[ADC_IO_BATTERY].dev, &sequence1);
+    k_mutex_unlock(&adc_read_lock);
+    app_energy_add(ENERGY_SAADC, ENERGY_SAADC_CONV_US);
+    if (err < 0) {
+	    LOG_ERR("failed to read ADC sequence 1.");
+	    return err;
     }
 
     // convert ADC reading to voltage
-    int32_t voltage = (buffer1 * ADC_REFERENCE_VOLTAGE) / ADC_RESOLUTION;
-    printk("convert voltage: %d mV\n", voltage);
-
-    // ensure voltage is within range
-    if (voltage > BATTERY_MAX_VOLTAGE) voltage = BATTERY_MAX_VOLTAGE;
-    if (voltage < BATTERY_MIN_VOLTAGE) voltage = BATTERY_MIN_VOLTAGE + 1;
-    printk("clamped voltage: %d mV\n", voltage);
-
-    // non-linear scaling
-    int32_t range = BATTERY_MAX_VOLTAGE - BATTERY_MIN_VOLTAGE;
-    int32_t difference = voltage - BATTERY_MIN_VOLTAGE;
-
-    if (range > 0 && difference > 0) {
-        // use power scaling: percentage = ((difference / range) ^ 1.5) * 100
-        double normalized = (double)difference / range;  // normalize to range [0, 1]
-        double scaled = pow(normalized, 1.2);            // apply non-linear scaling
-        percent = (int16_t)(scaled * 100);               // convert to percentage
-    } else {
-        printk("error: invalid range or difference.\n");
-        percent = 0;
-    }
-
-    printk("battery level (non-linear): %d%%\n", percent);
-    return percent;
+    return (int16_t)((buffer1 * ADC_REFERENCE_VOLTAGE) / ADC_RESOLUTION);
 }
 
 //  ========== app_adc_thread ==============================================================
 static void app_adc_thread(void *arg1, void *arg2, void *arg3)
 {
+    int64_t last_ms = k_uptime_get();
+
     while (!stop_sampling) {
-        if (adc_read(adc_channel.dev, &sequence0) == 0) {
+        // a sample later than twice the nominal interval is a missed deadline
+        int64_t now_ms = k_uptime_get();
+        if (now_ms - last_ms > 2 * sampling_rate_ms) {
+            app_metrics_inc(METRIC_ADC_DEADLINE_MISS);
+        }
+        last_ms = now_ms;
+
+        k_mutex_lock(&adc_read_lock, K_FOREVER);
+        // the capture is the DONE event of the last conversion of the scan, E, about
+        // 2 x ENERGY_SAADC_CONV_US after Z
+        if (adc_timestamps) {
+            adc_timer_start();
+        }
+        int err = adc_read(adc_channels[ADC_IO_GEOPHONE_Z].dev, &sequence0);
+        int64_t ts_us = adc_timestamps ? adc_capture_us() : -1;
+        ts_us = err == 0 ? ts_us : -1;
+        k_mutex_unlock(&adc_read_lock);
+        app_energy_add(ENERGY_SAADC, ADC_COMPONENTS * ENERGY_SAADC_CONV_US);
+
+        if (err == 0) {
             k_mutex_lock(&buffer_lock, K_FOREVER);
-            ring_buffer[ring_head] = buffer0;
+            for (int c = 0; c < ADC_COMPONENTS; c++) {
+                ring_buffer[c][ring_head] = scan[c];
+            }
             ring_head = (ring_head + 1) % ADC_BUFFER_SIZE;
+
+            // tag the first sample of each block, keep the newest for interpolation
+            if ((sample_count % ADC_BLOCK_SIZE) == 0) {
+                block_ts_us[(sample_count / ADC_BLOCK_SIZE) % (ADC_BLOCK_COUNT + 1)] = ts_us;
+            }
+            last_ts_us = ts_us;
+            sample_count++;
             k_mutex_unlock(&buffer_lock);
+
+            // previous sample still not consumed by the STA/LTA thread
+            if (k_sem_count_get(&data_ready_sem) > 0) {
+                app_metrics_inc(METRIC_ADC_OVERRUN);
+            }
+            data_ready_cycles = k_cycle_get_32();
             k_sem_give(&data_ready_sem);
         } else {
-            printk("failed to read ADC sequence 0\n");
+            APP_LOG_RATELIMIT(LOG_ERR, 1000, "failed to read ADC sequence 0");
         }
 
         // check for a rate change signal
         if (k_sem_take(&rate_change_sem, K_NO_WAIT) == 0) {
-            printk("sampling rate updated to %d ms\n", sampling_rate_ms);
+            LOG_DBG("sampling rate updated to %d ms", sampling_rate_ms);
             k_sem_reset(&rate_change_sem);  // reset semaphore count
         }
         k_sleep(K_MSEC(sampling_rate_ms));
@@ -151,6 +302,7 @@ void app_adc_sampling_start(void)
     stop_sampling = false;
     k_thread_create(&adc_thread_data, adc_stack, K_THREAD_STACK_SIZEOF(adc_stack),
                     app_adc_thread, NULL, NULL, NULL, 1, 0, K_NO_WAIT);
+    k_thread_name_set(&adc_thread_data, "adc");
     //printk("ADC sampling thrad started\n");
 }
 
@@ -168,26 +320,135 @@ void app_adc_sampling_stop(void)
 // use a mutex to ensure thread-safe access.
 void app_adc_get_buffer(uint16_t *dest, size_t size, int offset)
 {
+    (void)app_adc_get_buffer_ts(dest, size, offset);
+}
+
+//  ========== sample_time_us ==============================================================
+// uptime (us) of the sample at ring index, interpolated between the hardware captures of
+// its block and of the next one (or of the newest sample), -1 if unknown
+// must be called with buffer_lock held
+static int64_t sample_time_us(int index)
+{
+    uint32_t dist = (ring_head - index + ADC_BUFFER_SIZE - 1) % ADC_BUFFER_SIZE + 1;
+    if (dist > sample_count) {
+        return -1;
+    }
+
+    uint32_t abs = sample_count - dist;
+    uint32_t block = abs / ADC_BLOCK_SIZE;
+    uint32_t offset = abs % ADC_BLOCK_SIZE;
+    int64_t t0 = block_ts_us[block % (ADC_BLOCK_COUNT + 1)];
+    if (t0 < 0 || offset == 0) {
+        return t0;
+    }
+
+    if ((block + 1) * ADC_BLOCK_SIZE < sample_count) {
+        int64_t t1 = block_ts_us[(block + 1) % (ADC_BLOCK_COUNT + 1)];
+        return t1 < 0 ? -1 : t0 + (t1 - t0) * offset / ADC_BLOCK_SIZE;
+    }
+
+    // block still being filled: interpolate up to the newest sample
+    uint32_t newest = (sample_count - 1) % ADC_BLOCK_SIZE;
+    return t0 + (last_ts_us - t0) * offset / newest;
+}
+
+//  ========== app_adc_get_buffer_ts =======================================================
+// same as app_adc_get_buffer, also returns the uptime (us) of dest[0] from the hardware
+// sample timestamps, or -1 if it is not known
+int64_t app_adc_get_buffer_ts(uint16_t *dest, size_t size, int offset)
+{
+    int64_t ts_us;
+
     if (!dest || size > ADC_BUFFER_SIZE) {
-        printk("invalid parameters in adc_get_buffer.\n");
-        return;
+        LOG_ERR("invalid parameters in adc_get_buffer.");
+        return -1;
     }
 
-    // handle negative offsets by wrapping them around the buffer
+    k_mutex_lock(&buffer_lock, K_FOREVER);
     int start_index = (ring_head + offset + ADC_BUFFER_SIZE) % ADC_BUFFER_SIZE;
+    for (size_t i = 0; i < size; i++) {
+        dest[i] = ring_buffer[ADC_COMP_Z][(start_index + i) % ADC_BUFFER_SIZE];
+    }
+    ts_us = sample_time_us(start_index);
+    k_mutex_unlock(&buffer_lock);
+    return ts_us;
+}
+
+//  ========== copy_run ====================================================================
+// copy n samples of a component ring from the one back samples before the head, in at
+// most two runs
+// must be called with buffer_lock held
+static void copy_run(uint16_t *dest, int comp, size_t back, size_t n)
+{
+    int start = (ring_head - (int)back + ADC_BUFFER_SIZE) % ADC_BUFFER_SIZE;
+    size_t first = MIN(n, (size_t)(ADC_BUFFER_SIZE - start));
+
+    memcpy(dest, &ring_buffer[comp][start], first * sizeof(uint16_t));
+    memcpy(dest + first, &ring_buffer[comp][0], (n - first) * sizeof(uint16_t));
+}
 
-    //printk("fetching ADC buffer: start_index=%d, size=%zu\n", start_index, size);
+//  ========== app_adc_get_new =============================================================
+// copy the Z samples acquired since *cursor (a sample count, 0 at start), at most max of
+// the newest ones, and advance the cursor; returns the number of samples copied
+size_t app_adc_get_new(uint16_t *dest, size_t max, uint32_t *cursor)
+{
+    k_mutex_lock(&buffer_lock, K_FOREVER);
+    size_t n = MIN(sample_count - *cursor, MIN(max, ADC_BUFFER_SIZE));
+    copy_run(dest, ADC_COMP_Z, n, n);
+    *cursor = sample_count;
+    k_mutex_unlock(&buffer_lock);
+    return n;
+}
+
+//  ========== app_adc_get_new_soa =========================================================
+// copy the oldest samples of all the components not yet read at *cursor, at most
+// ADC_BLOCK_SIZE, and advance the cursor past them; the caller loops until it gets 0.
+// Samples already overwritten in the ring are skipped and counted
+size_t app_adc_get_new_soa(struct adc_soa_block *dest, uint32_t *cursor)
+{
+    uint32_t skipped = 0;
 
     k_mutex_lock(&buffer_lock, K_FOREVER);
-    // for (int i = 0; i < 10; i++) {  // Print first 10 entries
-    //     printk("ring_buffer[%d]: %d\n", i, ring_buffer[i]);
-    // }
+    uint32_t pending = sample_count - *cursor;
+    if (pending > ADC_BUFFER_SIZE) {
+        skipped = pending - ADC_BUFFER_SIZE;
+        pending = ADC_BUFFER_SIZE;
+    }
+    size_t n = MIN(pending, ADC_BLOCK_SIZE);
+    for (int c = 0; c < ADC_COMPONENTS; c++) {
+        copy_run(dest->c[c], c, pending, n);
+    }
+    *cursor = sample_count - pending + n;
+    k_mutex_unlock(&buffer_lock);
 
-    for (size_t i = 0; i < size; i++) {
-        dest[i] = ring_buffer[(start_index + i) % ADC_BUFFER_SIZE];
-        //printk("dest[%zu] = ring_buffer[%d] = %d\n", i, (start_index + i) % ADC_BUFFER_SIZE, dest[i]);
+    if (skipped) {
+        app_metrics_add(METRIC_ADC_SKIPPED, skipped);
+        APP_LOG_RATELIMIT(LOG_WRN, 10000, "%u samples overwritten before they were read",
+                          skipped);
+    }
+    return n;
+}
+
+//  ========== app_adc_sample_count ========================================================
+// samples acquired since the start, the count app_adc_get_new cursors follow
+uint32_t app_adc_sample_count(void)
+{
+    return sample_count;
+}
+
+//  ========== app_adc_sample_ts ===========================================================
+// uptime (us) of sample number count (the cursor of app_adc_get_new counts the same way),
+// -1 if it is not known or already overwritten in the ring
+int64_t app_adc_sample_ts(uint32_t count)
+{
+    int64_t ts_us = -1;
+
+    k_mutex_lock(&buffer_lock, K_FOREVER);
+    if (count < sample_count && sample_count - count <= ADC_BUFFER_SIZE) {
+        ts_us = sample_time_us(count % ADC_BUFFER_SIZE);
     }
     k_mutex_unlock(&buffer_lock);
+    return ts_us;
 }
 
 // set ADC sampling rate
@@ -196,4 +457,10 @@ void app_adc_set_sampling_rate(uint32_t rate_ms)
     sampling_rate_ms = rate_ms;
     k_sem_give(&rate_change_sem);  // signal the thread about the rate change
     //printk("sampling rate set to %d ms.\n", rate_ms);
-}
\ No newline at end of file
+}
+
+// current ADC sampling interval
+uint32_t app_adc_get_sampling_rate(void)
+{
+    return sampling_rate_ms;
+}
@@ -22,12 +22,35 @@
 #define ADC_RESOLUTION              4096    // 12-bit resolution
 #define ADC_BUFFER_SIZE             1024     
 #define SAMPLING_RATE_MS            10
-#define BATTERY_MAX_VOLTAGE         2980
-#define BATTERY_MIN_VOLTAGE         2270
+#define ADC_BLOCK_SIZE              32      // samples per hardware-timestamped block
+#define ADC_BLOCK_COUNT             (ADC_BUFFER_SIZE / ADC_BLOCK_SIZE)
+
+// three-component geophone, converted together in one SAADC scan per sample
+#define ADC_COMPONENTS              3
+
+// io-channels of zephyr,user in the device tree, in this order
+#define ADC_IO_GEOPHONE_Z           0
+#define ADC_IO_BATTERY              1
+#define ADC_IO_GEOPHONE_N           2
+#define ADC_IO_GEOPHONE_E           3
 
 //  ========== globals =====================================================================
+enum adc_component {
+    ADC_COMP_Z = 0,             // vertical, the component of event windows and the recorder
+    ADC_COMP_N,
+    ADC_COMP_E,
+};
+
+// new samples of every component, one array per component (structure of arrays) so that
+// each is contiguous for the detector loops
+struct adc_soa_block {
+    uint16_t c[ADC_COMPONENTS][ADC_BLOCK_SIZE];
+};
+
 extern struct k_sem data_ready_sem;
+extern struct k_thread adc_thread_data;
 extern int ring_head;
+extern uint32_t data_ready_cycles;
 
 //  ========== prototypes ==================================================================
 int8_t app_nrf52_adc_init();
@@ -35,6 +58,12 @@ int16_t app_nrf52_get_ain1();
 void app_adc_sampling_start(void);
 void app_adc_sampling_stop(void);
 void app_adc_get_buffer(uint16_t *dest, size_t size, int offset);
+int64_t app_adc_get_buffer_ts(uint16_t *dest, size_t size, int offset);
+size_t app_adc_get_new(uint16_t *dest, size_t max, uint32_t *cursor);
+size_t app_adc_get_new_soa(struct adc_soa_block *dest, uint32_t *cursor);
+uint32_t app_adc_sample_count(void);
+int64_t app_adc_sample_ts(uint32_t count);
 void app_adc_set_sampling_rate(uint32_t rate_ms);
+uint32_t app_adc_get_sampling_rate(void);
 
 #endif /* APP_ADC_H */
\ No newline at end of file
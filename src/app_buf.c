@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_buf.h"
+#include "app_metrics.h"
+
+//  ========== globals =====================================================================
+// fixed-block pools, sized at build time: a producer fills a buffer, hands it to the
+// TX thread (app_lorawan_queue) and the last net_buf_unref returns it to its pool
+NET_BUF_POOL_FIXED_DEFINE(uplink_pool, UPLINK_POOL_COUNT, UPLINK_FRAME_SIZE,
+                          sizeof(struct uplink_meta), NULL);
+NET_BUF_POOL_FIXED_DEFINE(window_pool, WINDOW_POOL_COUNT, WINDOW_SIZE,
+                          sizeof(struct uplink_meta), NULL);
+
+BUILD_ASSERT(UPLINK_WINDOW_TS_SIZE % sizeof(uint16_t) == 0 &&
+             UPLINK_FRAG_HDR_SIZE % sizeof(uint16_t) == 0,
+             "window samples must stay 2-byte aligned");
+
+//  ========== app_buf_uplink_alloc ========================================================
+// one uplink frame, NULL (and counted) when the pool is exhausted
+struct net_buf *app_buf_uplink_alloc(k_timeout_t timeout)
+{
+    struct net_buf *buf = net_buf_alloc(&uplink_pool, timeout);
+    if (!buf) {
+        app_metrics_inc(METRIC_UPLINK_DROP);
+        return NULL;
+    }
+
+    app_buf_meta(buf)->fragmented = false;
+    app_buf_meta(buf)->done = NULL;
+    return buf;
+}
+
+//  ========== app_buf_window_alloc ========================================================
+// one event window with the headroom of the first fragment header already reserved
+struct net_buf *app_buf_window_alloc(k_timeout_t timeout)
+{
+    struct net_buf *buf = net_buf_alloc(&window_pool, timeout);
+    if (!buf) {
+        app_metrics_inc(METRIC_UPLINK_DROP);
+        return NULL;
+    }
+
+    net_buf_reserve(buf, UPLINK_FRAG_HDR_SIZE);
+    app_buf_meta(buf)->fragmented = true;
+    app_buf_meta(buf)->done = NULL;
+    return buf;
+}
+
+//  ========== app_buf_meta ================================================================
+struct uplink_meta *app_buf_meta(struct net_buf *buf)
+{
+    return net_buf_user_data(buf);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BUF_H
+#define APP_BUF_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/net_buf.h>
+#include "app_adc.h"
+#include "app_uplink_codec.h"
+
+//  ========== defines =====================================================================
+// uplink frames: telemetry, health and energy records, one LoRaWAN payload each
+#define UPLINK_FRAME_SIZE       222     // largest EU868 application payload (DR5)
+#define UPLINK_POOL_COUNT       6
+
+// event windows: timestamp and one ring of ADC samples, fragmented by the TX thread;
+// UPLINK_FRAG_HDR_SIZE of headroom keeps the first fragment header in place and the
+// samples 2-byte aligned (layout in app_uplink_codec.h)
+#define WINDOW_DATA_SIZE        (UPLINK_WINDOW_TS_SIZE + ADC_BUFFER_SIZE * sizeof(uint16_t))
+#define WINDOW_SIZE             (UPLINK_FRAG_HDR_SIZE + WINDOW_DATA_SIZE)
+#define WINDOW_POOL_COUNT       2
+
+//  ========== globals =====================================================================
+// per buffer metadata, stored in the net_buf user data
+struct uplink_meta {
+    uint8_t port;
+    bool fragmented;        // event window, split into payload-sized fragments
+    uint8_t seq;            // window sequence number, given at the trigger
+    struct k_sem *done;     // given once the TX thread is done with the buffer, optional
+};
+
+//  ========== prototypes ==================================================================
+struct net_buf *app_buf_uplink_alloc(k_timeout_t timeout);
+struct net_buf *app_buf_window_alloc(k_timeout_t timeout);
+struct uplink_meta *app_buf_meta(struct net_buf *buf);
+
+#endif /* APP_BUF_H */
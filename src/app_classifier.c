@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_classifier.h"
+#include "app_classifier_model.h"
+#include "app_adc.h"
+#include "app_psd.h"
+#include "app_buf.h"
+#include "app_lorawan.h"
+#include "app_log.h"
+#include <zephyr/sys/atomic.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <math.h>
+#include <stdlib.h>
+
+LOG_MODULE_REGISTER(app_classifier, CONFIG_APP_CLASSIFIER_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define CLF_STACK_SIZE          1536    // feature extraction calls the FFT
+#define CLF_PRIORITY            12      // after the recorder and fetch threads
+
+BUILD_ASSERT(CLF_MODEL_FEATURES == CLF_FEATURES && CLF_MODEL_CLASSES == CLF_CLASSES,
+             "app_classifier_model.h does not match the feature vector, regenerate it");
+BUILD_ASSERT(CLF_F_CODA_BANDS + PSD_BANDS == CLF_FEATURES, "one level per PSD band");
+BUILD_ASSERT(PSD_SEGMENT <= ADC_BUFFER_SIZE, "a PSD segment must fit in the event window");
+
+//  ========== globals =====================================================================
+K_THREAD_STACK_DEFINE(clf_stack, CLF_STACK_SIZE);
+struct k_thread clf_thread_data;
+K_SEM_DEFINE(clf_ready, 0, 1);
+
+// one event at a time: the window is held from the capture until the decision
+static atomic_t busy = ATOMIC_INIT(0);
+static uint16_t window[ADC_BUFFER_SIZE];
+static int64_t window_t0_us;
+static uint32_t window_start;           // sample count of window[0]
+static struct clf_event pending;
+
+static float work[2 * PSD_SEGMENT];
+
+// classes whose window goes out, see CONFIG_APP_CLASSIFIER_SEND_MASK
+static uint32_t send_mask = CONFIG_APP_CLASSIFIER_SEND_MASK;
+static uint32_t class_count[CLF_CLASSES];
+static uint32_t suppressed = 0;
+
+static const char *const class_names[CLF_CLASSES] = {
+    [CLF_ROCKFALL]      = "rockfall",
+    [CLF_CREEP]         = "creep",
+    [CLF_ANTHROPOGENIC] = "anthropogenic",
+    [CLF_WEATHER]       = "weather",
+};
+
+// int8 quantization of each feature, q = v * scale + offset
+static const struct {
+    float scale;
+    float offset;
+} quant[CLF_FEATURES] = {
+    [CLF_F_DURATION]    = { 16.0f, 0.0f },
+    [CLF_F_PEAK_RATIO]  = { 32.0f, 0.0f },
+    [CLF_F_PEAK_STA]    = { 2.0f, -60.0f },
+    [CLF_F_RISE]        = { 255.0f, -128.0f },
+    [CLF_F_HV]          = { 4.0f, 0.0f },
+    [CLF_F_FREQ]        = { 5.0f, -128.0f },
+    [CLF_F_ONSET_BANDS ... CLF_FEATURES - 1] = { 2.0f, 0.0f },
+};
+
+//  ========== band_shape ==================================================================
+// band levels of one segment in dB re its strongest band, so that the shape of the
+// spectrum is compared and not the amplitude
+static void band_shape(const uint16_t *x, float level[PSD_BANDS])
+{
+    float band[PSD_BANDS];
+    float top = 0.0f;
+
+    app_psd_bands(x, work, band);
+    for (int b = 0; b < PSD_BANDS; b++) {
+        top = MAX(top, band[b]);
+    }
+    for (int b = 0; b < PSD_BANDS; b++) {
+        level[b] = (band[b] > 0.0f && top > 0.0f) ? 10.0f * log10f(band[b] / top) : -64.0f;
+    }
+}
+
+//  ========== zero_crossings ==============================================================
+// zero crossings of x around its mean, a cheap estimate of the dominant frequency
+static uint32_t zero_crossings(const uint16_t *x, size_t n)
+{
+    uint32_t sum = 0, crossings = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    int32_t mean = (int32_t)(sum / n);
+    bool above = x[0] > mean;
+    for (size_t i = 1; i < n; i++) {
+        bool a = x[i] > mean;
+        crossings += a != above;
+        above = a;
+    }
+    return crossings;
+}
+
+//  ========== clf_features ================================================================
+// feature vector of an event from the detector statistics and the Z samples of its window
+static void clf_features(const struct clf_event *ev, int8_t x[CLF_FEATURES])
+{
+    float v[CLF_FEATURES];
+    float fs = 1000.0f / app_adc_get_sampling_rate();
+    uint32_t duration = MAX(ev->duration, 1u);
+
+    // part of the event in the window, a long event runs past its end
+    int32_t onset = CLAMP((int32_t)(ev->onset - window_start), 0, ADC_BUFFER_SIZE - 2);
+    int32_t end = MIN(onset + (int32_t)duration, ADC_BUFFER_SIZE);
+    end = MAX(end, onset + 2);
+
+    v[CLF_F_DURATION] = log2f(duration / fs);
+    v[CLF_F_PEAK_RATIO] = log2f(MAX(ev->peak_ratio_x10, 1u) / 10.0f);
+    v[CLF_F_PEAK_STA] = 20.0f * log10f(MAX(ev->peak_sta, 1u));
+    v[CLF_F_RISE] = (float)ev->peak_offset / duration;
+
+    // the energies are sums of rectified amplitudes, hence 20 log10
+    v[CLF_F_HV] = 0.0f;
+    if (ev->components == ADC_COMPONENTS) {
+        float h = (float)(ev->energy[1] + ev->energy[2]) / 2.0f;
+        v[CLF_F_HV] = 20.0f * log10f((h + 1.0f) / (ev->energy[0] + 1.0f));
+    }
+
+    v[CLF_F_FREQ] = zero_crossings(&window[onset], end - onset) * fs / (2.0f * (end - onset));
+
+    // first segment from the onset, last one to the end of the event (the same one for a
+    // short event)
+    band_shape(&window[MIN(onset, ADC_BUFFER_SIZE - PSD_SEGMENT)], &v[CLF_F_ONSET_BANDS]);
+    band_shape(&window[MAX(end - PSD_SEGMENT, 0)], &v[CLF_F_CODA_BANDS]);
+
+    for (int f = 0; f < CLF_FEATURES; f++) {
+        float q = v[f] * quant[f].scale + quant[f].offset;
+        x[f] = (int8_t)CLAMP(lroundf(q), INT8_MIN, INT8_MAX);
+    }
+}
+
+//  ========== app_classifier_infer ========================================================
+// class with the highest sum of leaf votes over the trees; margin is the lead over the
+// runner-up per tree, 0 (tie) to 127 (unanimous and certain)
+int app_classifier_infer(const int8_t x[CLF_FEATURES], uint8_t *margin)
+{
+    int32_t votes[CLF_CLASSES] = {0};
+
+    for (int t = 0; t < CLF_MODEL_TREES; t++) {
+        const struct clf_node *node = &clf_nodes[clf_roots[t]];
+        while (node->feature >= 0) {
+            node = &clf_nodes[x[node->feature] <= node->threshold ? node->left : node->right];
+        }
+        for (int c = 0; c < CLF_CLASSES; c++) {
+            votes[c] += clf_leaves[node->left][c];
+        }
+    }
+
+    int best = 0, second = 1;
+    if (votes[second] > votes[best]) {
+        best = 1;
+        second = 0;
+    }
+    for (int c = 2; c < CLF_CLASSES; c++) {
+        if (votes[c] > votes[best]) {
+            second = best;
+            best = c;
+        } else if (votes[c] > votes[second]) {
+            second = c;
+        }
+    }
+
+    *margin = (uint8_t)CLAMP((votes[best] - votes[second]) / CLF_MODEL_TREES, 0, INT8_MAX);
+    return best;
+}
+
+//  ========== queue_event =================================================================
+// the event frame goes out whatever the decision, so that suppressed events stay visible
+static void queue_event(const struct clf_event *ev, const int8_t x[CLF_FEATURES], int label,
+                        uint8_t margin, bool sent)
+{
+    struct net_buf *buf = app_buf_uplink_alloc(K_NO_WAIT);
+    if (!buf) {
+        APP_LOG_RATELIMIT(LOG_WRN, 10000, "no free uplink buffer, event frame dropped");
+        return;
+    }
+
+    struct uplink_event frame = {
+        .seq = ev->seq,
+        .model = CLF_MODEL_ID,
+        .label = (uint8_t)label,
+        .margin = margin,
+        .sent = sent,
+        .duration = x[CLF_F_DURATION],
+        .peak_ratio = x[CLF_F_PEAK_RATIO],
+        .peak_sta = x[CLF_F_PEAK_STA],
+        .rise = x[CLF_F_RISE],
+        .hv = x[CLF_F_HV],
+        .freq = x[CLF_F_FREQ],
+        .onset0 = x[CLF_F_ONSET_BANDS + 0],
+        .onset1 = x[CLF_F_ONSET_BANDS + 1],
+        .onset2 = x[CLF_F_ONSET_BANDS + 2],
+        .onset3 = x[CLF_F_ONSET_BANDS + 3],
+        .onset4 = x[CLF_F_ONSET_BANDS + 4],
+        .onset5 = x[CLF_F_ONSET_BANDS + 5],
+        .coda0 = x[CLF_F_CODA_BANDS + 0],
+        .coda1 = x[CLF_F_CODA_BANDS + 1],
+        .coda2 = x[CLF_F_CODA_BANDS + 2],
+        .coda3 = x[CLF_F_CODA_BANDS + 3],
+        .coda4 = x[CLF_F_CODA_BANDS + 4],
+        .coda5 = x[CLF_F_CODA_BANDS + 5],
+    };
+
+    int len = uplink_event_encode(&frame, net_buf_tail(buf), net_buf_tailroom(buf));
+    if (len < 0) {
+        net_buf_unref(buf);
+        return;
+    }
+    net_buf_add(buf, len);
+    app_lorawan_queue(buf, LORAWAN_EVENT_PORT);
+}
+
+//  ========== app_classifier_thread =======================================================
+static void app_classifier_thread(void *arg1, void *arg2, void *arg3)
+{
+    int8_t x[CLF_FEATURES];
+    uint8_t margin;
+
+    while (1) {
+        k_sem_take(&clf_ready, K_FOREVER);
+
+        uint32_t start = k_cycle_get_32();
+        clf_features(&pending, x);
+        int label = app_classifier_infer(x, &margin);
+        uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+        // a class of interest, or a decision too close to call; a placeholder model only
+        // labels events, field data is not dropped on its word
+        bool send = CLF_MODEL_PLACEHOLDER || (send_mask & BIT(label)) ||
+                    margin < CLF_MIN_MARGIN;
+
+        class_count[label]++;
+        suppressed += !send;
+        LOG_INF("event %u: %s, margin %u, %u us, window %s", pending.seq, class_names[label],
+                margin, us, send ? "sent" : "suppressed");
+
+        queue_event(&pending, x, label, margin, send);
+        if (send) {
+            app_lorawan_window_tx(pending.seq, window, window_t0_us);
+        }
+        atomic_set(&busy, 0);
+    }
+}
+
+//  ========== app_classifier_start ========================================================
+void app_classifier_start(void)
+{
+    k_thread_create(&clf_thread_data, clf_stack, K_THREAD_STACK_SIZEOF(clf_stack),
+                    app_classifier_thread, NULL, NULL, NULL, CLF_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&clf_thread_data, "classify");
+}
+
+//  ========== app_classifier_capture ======================================================
+// take the event window from the ADC ring, detector thread; false while the previous event
+// is still being classified, the caller then sends the window itself
+bool app_classifier_capture(void)
+{
+    if (!atomic_cas(&busy, 0, 1)) {
+        return false;
+    }
+
+    // a sample may land between the two calls, one sample off at most
+    window_t0_us = app_adc_get_buffer_ts(window, ADC_BUFFER_SIZE, 0);
+    window_start = app_adc_sample_count() - ADC_BUFFER_SIZE;
+    return true;
+}
+
+//  ========== app_classifier_submit =======================================================
+// classify a closed event whose window was captured
+void app_classifier_submit(const struct clf_event *ev)
+{
+    pending = *ev;
+    k_sem_give(&clf_ready);
+}
+
+//  ========== shell commands ==============================================================
+static int cmd_classifier_show(const struct shell *sh, size_t argc, char **argv)
+{
+    shell_print(sh, "model %u, %u trees, %u nodes, send mask 0x%x%s", CLF_MODEL_ID,
+                CLF_MODEL_TREES, (unsigned int)ARRAY_SIZE(clf_nodes), send_mask,
+                CLF_MODEL_PLACEHOLDER ? " (placeholder model, every window sent)" : "");
+    for (int c = 0; c < CLF_CLASSES; c++) {
+        shell_print(sh, "%-14s %u", class_names[c], class_count[c]);
+    }
+    shell_print(sh, "%u windows suppressed", suppressed);
+    return 0;
+}
+
+static int cmd_classifier_mask(const struct shell *sh, size_t argc, char **argv)
+{
+    char *end;
+    unsigned long mask = strtoul(argv[1], &end, 0);
+
+    if (*end != '\0' || mask >= BIT(CLF_CLASSES)) {
+        shell_error(sh, "mask must be below 0x%x", (unsigned int)BIT(CLF_CLASSES));
+        return -EINVAL;
+    }
+    send_mask = (uint32_t)mask;
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(classifier_cmds,
+    SHELL_CMD(show, NULL, "Print the model and the events classified since boot",
+              cmd_classifier_show),
+    SHELL_CMD_ARG(mask, NULL, "Set the classes whose window is sent, until reset: <mask>",
+                  cmd_classifier_mask, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(classifier, &classifier_cmds, "Event classifier", NULL);
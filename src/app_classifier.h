@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CLASSIFIER_H
+#define APP_CLASSIFIER_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_adc.h"
+
+//  ========== defines =====================================================================
+// int8 decision-tree ensemble run on each closed event; the model is generated by
+// tools/classifier/clf_export.py into app_classifier_model.h
+#define CLF_CLASSES             4
+#define CLF_FEATURES            18
+#define CLF_MIN_MARGIN          16      // vote margin per tree (127 = certain), below: sent
+
+// the event window keeps CLF_PRE_EVENT samples before the onset: it is taken at the end of
+// the event, or earlier for a long event before the ring loses the onset
+#define CLF_PRE_EVENT           (ADC_BUFFER_SIZE / 4)
+#define CLF_CAPTURE_AGE         (ADC_BUFFER_SIZE - CLF_PRE_EVENT)
+
+//  ========== globals =====================================================================
+enum clf_class {
+    CLF_ROCKFALL = 0,
+    CLF_CREEP,                  // slope creep, slow emergent low-frequency signal
+    CLF_ANTHROPOGENIC,          // footsteps, vehicles, machinery
+    CLF_WEATHER,                // rain, wind
+};
+
+// feature vector, each quantized to int8 (see quant[] in app_classifier.c)
+enum clf_feature {
+    CLF_F_DURATION = 0,         // 16 log2(s)
+    CLF_F_PEAK_RATIO,           // 32 log2(STA/LTA)
+    CLF_F_PEAK_STA,             // 2 (dB re 1 count - 30)
+    CLF_F_RISE,                 // time to the peak ratio / duration, 0..1 on -128..127
+    CLF_F_HV,                   // 4 dB, horizontal over vertical energy, 0 with Z only
+    CLF_F_FREQ,                 // 5 Hz - 128, zero-crossing frequency of Z
+    CLF_F_ONSET_BANDS,          // PSD_BANDS levels of the first segment after the onset,
+    CLF_F_CODA_BANDS = CLF_F_ONSET_BANDS + 6,   // then of the last one, 2 dB re the
+                                                // strongest band of the segment
+};
+
+// an event as seen by the detector, filled while it runs
+struct clf_event {
+    uint8_t seq;                // window sequence number, shared with the trigger frame
+    uint8_t components;         // components summed in energy[], 1 in Z mode
+    uint32_t onset;             // sample count of the triggering sample
+    uint32_t duration;          // samples from the onset
+    uint32_t peak_offset;       // samples from the onset to the highest STA/LTA ratio
+    uint32_t peak_ratio_x10;
+    uint32_t peak_sta;          // STA at the peak ratio, ADC counts
+    uint64_t energy[ADC_COMPONENTS];    // characteristic function summed over the event
+};
+
+// tree node: feature < 0 for a leaf, left is then its row in the vote table
+struct clf_node {
+    int8_t feature;
+    int8_t threshold;           // x[feature] <= threshold goes left
+    uint16_t left;
+    uint16_t right;
+};
+
+extern struct k_thread clf_thread_data;
+
+//  ========== prototypes ==================================================================
+void app_classifier_start(void);
+bool app_classifier_capture(void);
+void app_classifier_submit(const struct clf_event *ev);
+int app_classifier_infer(const int8_t x[CLF_FEATURES], uint8_t *margin);
+
+#endif /* APP_CLASSIFIER_H */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// generated by tools/classifier/clf_export.py from default_model.json, do not edit
+// hand-written placeholder until a model is trained on labelled field events: duration,
+// zero-crossing frequency and rise time; votes are rockfall, creep, anthropogenic,
+// weather
+
+#ifndef APP_CLASSIFIER_MODEL_H
+#define APP_CLASSIFIER_MODEL_H
+
+#define CLF_MODEL_ID            1
+#define CLF_MODEL_FEATURES      18
+#define CLF_MODEL_CLASSES       4
+#define CLF_MODEL_TREES         3
+#define CLF_MODEL_PLACEHOLDER   1       // 1: not trained, no window held back
+
+// feature, threshold, left, right; a leaf has feature -1 and its vote row in left
+static const struct clf_node clf_nodes[] = {
+    { 0, 16, 1, 2 },            // tree 0, duration
+    { -1, 0, 0, 0 },
+    { 0, 64, 3, 4 },            // duration
+    { -1, 0, 1, 0 },
+    { -1, 0, 2, 0 },
+    { 5, -103, 6, 7 },          // tree 1, freq
+    { -1, 0, 3, 0 },
+    { 5, -28, 8, 9 },           // freq
+    { -1, 0, 4, 0 },
+    { -1, 0, 5, 0 },
+    { 3, -77, 11, 12 },         // tree 2, rise
+    { -1, 0, 6, 0 },
+    { -1, 0, 7, 0 },
+};
+
+static const uint16_t clf_roots[CLF_MODEL_TREES] = {
+    0, 5, 10,
+};
+
+// rockfall, creep, anthropogenic, weather
+static const int8_t clf_leaves[][CLF_MODEL_CLASSES] = {
+    { 40, 0, 60, 0 },
+    { 80, 10, 20, 20 },
+    { 10, 60, 10, 50 },
+    { 20, 80, 0, 20 },
+    { 60, 20, 40, 10 },
+    { 30, 0, 60, 40 },
+    { 70, 0, 40, 0 },
+    { 10, 40, 10, 60 },
+};
+
+#endif /* APP_CLASSIFIER_MODEL_H */
@@ -7,10 +7,62 @@
 
 //  ========== includes ==================================================================
 #include "app_ds3231.h"
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_ds3231, CONFIG_APP_CLOCK_LOG_LEVEL);
 
 //  ========== globals ===================================================================
-static int64_t system_rtc_offset_ms = 0;
-static struct k_mutex offset_mutex;
+// wall-clock model, read lock-free by app_ds3231_get_time
+static struct app_timebase ds3231_timebase = APP_TIMEBASE_INITIALIZER;
+
+// 1 Hz square-wave input used to discipline the clock, optional in the device tree
+#define DS3231_SQW_NODE     DT_PATH(zephyr_user)
+#if DT_NODE_HAS_PROP(DS3231_SQW_NODE, ds3231_sqw_gpios)
+#define DS3231_HAS_SQW      1
+static const struct gpio_dt_spec sqw_gpio = GPIO_DT_SPEC_GET(DS3231_SQW_NODE, ds3231_sqw_gpios);
+static struct gpio_callback sqw_cb;
+#else
+#define DS3231_HAS_SQW      0
+#endif
+
+// discipline state, last_edge_ticks and disciplined are kept for the fallback check
+static int64_t last_edge_ticks = -1;
+static bool disciplined = false;
+
+#if DS3231_HAS_SQW
+// edge timestamps captured by the ISR, consumed by the fit work
+#define DS3231_EDGE_QUEUE   8
+static int64_t edge_queue[DS3231_EDGE_QUEUE];
+static atomic_t edge_queued = ATOMIC_INIT(0);
+static uint32_t edge_consumed;
+
+// regression window: edge index (seconds) and kernel ticks of the last edges
+static struct {
+    int32_t index[DS3231_FIT_EDGES];
+    int64_t ticks[DS3231_FIT_EDGES];
+    uint8_t head;
+    uint8_t count;
+} fit;
+
+static struct i2c_dt_spec discipline_i2c;
+static struct k_work fit_work;
+static int32_t edge_index;
+static bool anchored = false;
+static int64_t anchor_epoch_s;
+static int32_t anchor_index;
+
+// asynchronous anchor read: submitted by the fit work, completed on the bus thread
+static struct i2c_txn anchor_txn;
+static uint8_t anchor_reg = DS3231_REG_TIME;
+static uint8_t anchor_buf[7];
+static atomic_t anchor_busy = ATOMIC_INIT(0);
+static atomic_t anchor_ready = ATOMIC_INIT(0);
+static int32_t anchor_txn_index;
+static int64_t anchor_txn_ticks;
+static int64_t anchor_txn_epoch_s;
+#endif
+
+static void ds3231_decode_time(const uint8_t *time_buf, struct tm *tm);
 
 //  ========== bcd_to_bin ================================================================ 
 static uint8_t bcd_to_bin(uint8_t val)
@@ -37,34 +89,42 @@ void set_ds3231_from_unix_time(const struct device *rtc_dev, int64_t unix_time)
 // ========== ds3231_set_time ============================================================
 int8_t ds3231_set_time(const struct device *i2c_dev, const struct tm *tm)
 {
-    uint8_t time_buf[7];
+    struct i2c_dt_spec spec = { .bus = i2c_dev, .addr = DS3231_I2C_ADDR };
+    struct i2c_txn txn;
+    uint8_t time_buf[8];
     int8_t ret;
 
     if (!i2c_dev || !tm) {
         return -EINVAL;
     }
 
-    time_buf[0] = bin_to_bcd(tm->tm_sec);
-    time_buf[1] = bin_to_bcd(tm->tm_min);
-    time_buf[2] = bin_to_bcd(tm->tm_hour);
-    time_buf[3] = bin_to_bcd(tm->tm_wday + 1);         // struct tm: 0=Sun → DS3231: 1=Sun
-    time_buf[4] = bin_to_bcd(tm->tm_mday);
-    time_buf[5] = bin_to_bcd(tm->tm_mon + 1);          // struct tm: 0=Jan → DS3231: 1=Jan
-    time_buf[6] = bin_to_bcd(tm->tm_year - 100);       // struct tm: years since 1900 → DS3231: years since 2000
+    time_buf[0] = DS3231_REG_TIME;
+    time_buf[1] = bin_to_bcd(tm->tm_sec);
+    time_buf[2] = bin_to_bcd(tm->tm_min);
+    time_buf[3] = bin_to_bcd(tm->tm_hour);
+    time_buf[4] = bin_to_bcd(tm->tm_wday + 1);         // struct tm: 0=Sun → DS3231: 1=Sun
+    time_buf[5] = bin_to_bcd(tm->tm_mday);
+    time_buf[6] = bin_to_bcd(tm->tm_mon + 1);          // struct tm: 0=Jan → DS3231: 1=Jan
+    time_buf[7] = bin_to_bcd(tm->tm_year - 100);       // struct tm: years since 1900 → DS3231: years since 2000
 
-    ret = i2c_burst_write(i2c_dev, DS3231_I2C_ADDR, DS3231_REG_TIME, time_buf, sizeof(time_buf));
+    // register address followed by the time registers, through the bus scheduler
+    app_i2c_txn_write(&txn, &spec, time_buf, sizeof(time_buf));
+    ret = app_i2c_transfer_wait(&txn);
     if (ret < 0) {
-        printk("failed to write time to DS3231: %d\n", ret);
+        LOG_ERR("failed to write time to DS3231: %d", ret);
         return ret;
     }
 
-    printk("DS3231 time set successfully\n");
+    LOG_INF("DS3231 time set successfully");
     return 0;
 }
 
 //  ========== ds3231_get_time ================================================================ 
 int8_t ds3231_get_time(const struct device *i2c_dev, struct tm *tm)
 {
+    struct i2c_dt_spec spec = { .bus = i2c_dev, .addr = DS3231_I2C_ADDR };
+    struct i2c_txn txn;
+    uint8_t reg = DS3231_REG_TIME;
     uint8_t time_buf[7];
     int8_t ret;
 
@@ -72,12 +132,21 @@ int8_t ds3231_get_time(const struct device *i2c_dev, struct tm *tm)
         return -EINVAL;
     }
 
-    ret = i2c_burst_read(i2c_dev, DS3231_I2C_ADDR, DS3231_REG_TIME, time_buf, sizeof(time_buf));
+    app_i2c_txn_write_read(&txn, &spec, &reg, sizeof(reg), time_buf, sizeof(time_buf));
+    ret = app_i2c_transfer_wait(&txn);
     if (ret < 0) {
-        printk("failed to read DS3231 registers. error: %d", ret);
+        LOG_ERR("failed to read DS3231 registers. error: %d", ret);
         return ret;
     }
 
+    ds3231_decode_time(time_buf, tm);
+    return 0;
+}
+
+//  ========== ds3231_decode_time =============================================================
+// convert the 7 BCD time registers to struct tm
+static void ds3231_decode_time(const uint8_t *time_buf, struct tm *tm)
+{
     tm->tm_sec  = bcd_to_bin(time_buf[0] & 0x7F);
     tm->tm_min  = bcd_to_bin(time_buf[1] & 0x7F);
     tm->tm_hour = bcd_to_bin(time_buf[2] & 0x3F);  // 24-hour format
@@ -85,23 +154,22 @@ int8_t ds3231_get_time(const struct device *i2c_dev, struct tm *tm)
     tm->tm_mday = bcd_to_bin(time_buf[4] & 0x3F);
     tm->tm_mon  = bcd_to_bin(time_buf[5] & 0x1F) - 1;  // struct tm: 0=Jan
     tm->tm_year = bcd_to_bin(time_buf[6]) + 100;       // since 1900 → 2000 + xx
-
-    return 0;
 }
 
-//  ========== app_rtc_init ================================================================
+//  ========== app_ds3231_init =============================================================
+// returns the I2C bus of the DS3231, used by the time read/write helpers
 const struct device *app_ds3231_init(void)
 {
-    const struct device *i2c_dev = DEVICE_DT_GET_ONE(maxim_ds3231);
-    if (!i2c_dev) {
-        printk("no DS3231 device found\n");
+    const struct device *i2c_dev = DS3231_I2C_BUS;
+    if (!device_is_ready(i2c_dev)) {
+        LOG_ERR("no DS3231 device found");
         return NULL;
     }
 
-    // initialize mutex
-    k_mutex_init(&offset_mutex);
+    LOG_INF("DS3231 initialized and started successfully (device: %s)", i2c_dev->name);
 
-    printk("DS3231 initialized and started successfully (device: %s)\n", i2c_dev->name);
+    // start the 1 Hz discipline when SQW is wired, periodic I2C syncs are used otherwise
+    (void)app_ds3231_discipline_start(i2c_dev);
     return i2c_dev;
 }
 
@@ -110,7 +178,7 @@ const struct device *app_ds3231_init(void)
 int8_t app_ds3231_sync_uptime(const struct device *i2c_dev)
 {
     if (!i2c_dev) {
-        printk("DS3231 device is NULL\n");
+        LOG_ERR("DS3231 device is NULL");
         return -EINVAL;
     }
 
@@ -122,7 +190,7 @@ int8_t app_ds3231_sync_uptime(const struct device *i2c_dev)
 
     // get time from external RTC
     if (ds3231_get_time(i2c_dev, &rtc_tm) != 0) {
-        printk("failed to read time from DS3231\n");
+        LOG_ERR("failed to read time from DS3231");
         return -EIO;
     }
 
@@ -132,51 +200,276 @@ int8_t app_ds3231_sync_uptime(const struct device *i2c_dev)
     current_uptime_ms = k_uptime_get();
     new_offset_ms = rtc_epoch_ms - current_uptime_ms;
 
-    // safely update the global offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    system_rtc_offset_ms = new_offset_ms;
-    k_mutex_unlock(&offset_mutex);
+    // publish the new offset without blocking readers
+    app_timebase_publish_offset(&ds3231_timebase, new_offset_ms);
 
     // debugging output
-    printk("synced: DS3231 epoch_ms = %lld, uptime = %lld, offset = %lld\n",
-           rtc_epoch_ms, current_uptime_ms, new_offset_ms);
+    LOG_DBG("synced: DS3231 epoch_ms = %lld, uptime = %lld, offset = %lld",
+            rtc_epoch_ms, current_uptime_ms, new_offset_ms);
 
     return 0;
 }
 
-//  ========== app_rtc_get_time ==========================================================
-uint64_t app_ds3231_get_time()
+//  ========== app_ds3231_get_time =======================================================
+// lock-free, safe from the acquisition hot path and from ISR context
+uint64_t app_ds3231_get_time(void)
+{
+    return app_timebase_now_ms(&ds3231_timebase);
+}
+
+// same in microseconds, interpolated between 1 Hz edges when disciplined
+uint64_t app_ds3231_get_time_us(void)
+{
+    return app_timebase_now_us(&ds3231_timebase);
+}
+
+// wall-clock time of a kernel tick count captured earlier (e.g. a sample instant)
+int64_t app_ds3231_ticks_to_us(int64_t ticks)
+{
+    return app_timebase_ticks_to_us(&ds3231_timebase, ticks);
+}
+
+int64_t app_ds3231_uptime_us_to_epoch_us(int64_t uptime_us)
 {
-    int64_t now_ms = k_uptime_get();
-    int64_t offset;
+    return app_timebase_uptime_us_to_epoch_us(&ds3231_timebase, uptime_us);
+}
+
+#if DS3231_HAS_SQW
+//  ========== sqw_isr =====================================================================
+// falling edge of SQW: the DS3231 seconds register has just rolled over
+static void sqw_isr(const struct device *port, struct gpio_callback *cb, uint32_t pins)
+{
+    atomic_val_t n = atomic_get(&edge_queued);
 
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    offset = system_rtc_offset_ms;
-    k_mutex_unlock(&offset_mutex);
+    edge_queue[n % DS3231_EDGE_QUEUE] = k_uptime_ticks();
+    atomic_inc(&edge_queued);
+    k_work_submit(&fit_work);
+}
+
+//  ========== fit helpers =================================================================
+static void fit_reset(void)
+{
+    fit.head = 0;
+    fit.count = 0;
+}
 
-    // protect against overflow
-    if (offset > 0 && now_ms > UINT64_MAX - offset) {
-        return UINT64_MAX;
+static void fit_push(int32_t index, int64_t ticks)
+{
+    fit.index[fit.head] = index;
+    fit.ticks[fit.head] = ticks;
+    fit.head = (fit.head + 1) % DS3231_FIT_EDGES;
+    if (fit.count < DS3231_FIT_EDGES) {
+        fit.count++;
     }
-    if (offset < 0 && now_ms < (uint64_t)(-offset)) {
-        return 0;
+}
+
+// anchor read completed: hand the result over to the fit work
+static void fit_anchor_done(struct i2c_txn *txn, int result)
+{
+    struct tm rtc_tm;
+
+    // the read must complete within the second that started at the edge
+    if (result == 0 &&
+        k_uptime_ticks() - anchor_txn_ticks < CONFIG_SYS_CLOCK_TICKS_PER_SECOND * 9 / 10) {
+        ds3231_decode_time(anchor_buf, &rtc_tm);
+        anchor_txn_epoch_s = timeutil_timegm64(&rtc_tm);
+        atomic_set(&anchor_ready, 1);
+        k_work_submit(&fit_work);
+    } else if (result != 0) {
+        LOG_ERR("failed to read time from DS3231");
+    }
+    atomic_clear(&anchor_busy);
+}
+
+// read the full time right after an edge to anchor edge_index to epoch seconds
+static void fit_anchor(void)
+{
+    if (k_uptime_ticks() - last_edge_ticks > CONFIG_SYS_CLOCK_TICKS_PER_SECOND / 2) {
+        return;
+    }
+    if (atomic_set(&anchor_busy, 1)) {
+        return;
+    }
+
+    anchor_txn_index = edge_index;
+    anchor_txn_ticks = last_edge_ticks;
+    app_i2c_txn_write_read(&anchor_txn, &discipline_i2c, &anchor_reg, sizeof(anchor_reg),
+                           anchor_buf, sizeof(anchor_buf));
+    anchor_txn.cb = fit_anchor_done;
+    if (app_i2c_submit(&anchor_txn, K_NO_WAIT) < 0) {
+        atomic_clear(&anchor_busy);
     }
-    uint64_t timestamp_ms = now_ms + offset;
-    return timestamp_ms;
+}
+
+// least squares fit of ticks = a + b * edge_index, then publish the model at the last edge
+static void fit_update(void)
+{
+    const int64_t tps = CONFIG_SYS_CLOCK_TICKS_PER_SECOND;
+    uint8_t last = (fit.head + DS3231_FIT_EDGES - 1) % DS3231_FIT_EDGES;
+    int64_t n = fit.count;
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for (uint8_t i = 0; i < fit.count; i++) {
+        int64_t x = fit.index[i] - fit.index[last];
+        int64_t y = fit.ticks[i] - fit.ticks[last];
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    int64_t den = n * sxx - sx * sx;
+    if (den == 0) {
+        return;
+    }
+
+    // ticks per second in Q16 and deviation from nominal
+    int64_t slope_q16 = ((n * sxy - sx * sy) << 16) / den;
+    int64_t ppm = ((slope_q16 - (tps << 16)) * 1000000) / (tps << 16);
+    if (ppm > DS3231_MAX_PPM || ppm < -DS3231_MAX_PPM) {
+        LOG_WRN("DS3231 fit rejected (%lld ppm)", ppm);
+        fit_reset();
+        return;
+    }
+
+    // fitted tick of the last edge (relative, Q16) and microseconds per tick (Q24)
+    int64_t yhat_q16 = ((sy << 16) - slope_q16 * sx) / n;
+    uint32_t scale_q24 = (uint32_t)((1000000LL << 40) / slope_q16);
+    int64_t edge_epoch_us = (anchor_epoch_s + (edge_index - anchor_index)) * 1000000LL;
+    int64_t corr_us = (yhat_q16 * scale_q24) >> 40;
+
+    app_timebase_publish(&ds3231_timebase, fit.ticks[last], edge_epoch_us - corr_us, scale_q24);
+
+    if (!disciplined || (edge_index % 60) == 0) {
+        LOG_INF("DS3231 disciplined: %lld ppm over %u edges", ppm, fit.count);
+    }
+    disciplined = true;
+}
+
+//  ========== ds3231_fit_work =============================================================
+// consume captured edges, re-anchor when needed and refresh the clock model
+static void ds3231_fit_work(struct k_work *work)
+{
+    const int64_t tps = CONFIG_SYS_CLOCK_TICKS_PER_SECOND;
+    uint32_t queued = (uint32_t)atomic_get(&edge_queued);
+
+    // apply a completed anchor read
+    if (atomic_clear(&anchor_ready)) {
+        anchor_epoch_s = anchor_txn_epoch_s;
+        anchor_index = anchor_txn_index;
+        anchored = true;
+    }
+
+    // the work fell too far behind the ISR: start over from the newest edges
+    if (queued - edge_consumed > DS3231_EDGE_QUEUE) {
+        edge_consumed = queued - DS3231_EDGE_QUEUE;
+        last_edge_ticks = -1;
+    }
+
+    while (edge_consumed != queued) {
+        int64_t t = edge_queue[edge_consumed % DS3231_EDGE_QUEUE];
+        edge_consumed++;
+
+        if (last_edge_ticks >= 0) {
+            int64_t dt = t - last_edge_ticks;
+            int64_t k = (dt + tps / 2) / tps;
+            if (k < 1) {
+                continue;   // glitch on the line
+            }
+            if (dt - k * tps > tps / 10 || k * tps - dt > tps / 10 || k > 10) {
+                // spurious edge or long gap: the edge count may be off, re-anchor
+                anchored = false;
+                fit_reset();
+            }
+            edge_index += k;
+        } else {
+            // first edge or lost track: the anchor no longer matches edge_index
+            anchored = false;
+            fit_reset();
+        }
+        last_edge_ticks = t;
+        fit_push(edge_index, t);
+    }
+
+    if (!anchored || edge_index - anchor_index >= DS3231_ANCHOR_EDGES) {
+        fit_anchor();
+    }
+    if (anchored && fit.count >= 2) {
+        fit_update();
+    }
+}
+#endif
+
+//  ========== app_ds3231_discipline_start =================================================
+// enable the 1 Hz square wave and timestamp its edges
+int8_t app_ds3231_discipline_start(const struct device *i2c_dev)
+{
+#if DS3231_HAS_SQW
+    int8_t ret;
+
+    if (!i2c_dev || !gpio_is_ready_dt(&sqw_gpio)) {
+        LOG_ERR("DS3231 SQW input not ready");
+        return -ENODEV;
+    }
+    discipline_i2c.bus = i2c_dev;
+    discipline_i2c.addr = DS3231_I2C_ADDR;
+    k_work_init(&fit_work, ds3231_fit_work);
+
+    // INTCN = 0, RS2:RS1 = 00 -> 1 Hz square wave on SQW, oscillator enabled
+    struct i2c_txn txn;
+    uint8_t ctrl[2] = { DS3231_REG_CONTROL, 0x00 };
+    app_i2c_txn_write(&txn, &discipline_i2c, ctrl, sizeof(ctrl));
+    ret = app_i2c_transfer_wait(&txn);
+    if (ret < 0) {
+        LOG_ERR("failed to enable DS3231 square wave: %d", ret);
+        return ret;
+    }
+
+    ret = gpio_pin_configure_dt(&sqw_gpio, GPIO_INPUT);
+    if (ret < 0) {
+        return ret;
+    }
+    gpio_init_callback(&sqw_cb, sqw_isr, BIT(sqw_gpio.pin));
+    gpio_add_callback(sqw_gpio.port, &sqw_cb);
+    ret = gpio_pin_interrupt_configure_dt(&sqw_gpio, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret < 0) {
+        LOG_ERR("failed to configure SQW interrupt: %d", ret);
+        return ret;
+    }
+
+    LOG_INF("DS3231 1 Hz discipline started");
+    return 0;
+#else
+    ARG_UNUSED(i2c_dev);
+    return -ENOTSUP;
+#endif
+}
+
+//  ========== app_ds3231_disciplined ======================================================
+// true while the clock follows recent 1 Hz edges
+bool app_ds3231_disciplined(void)
+{
+    return disciplined &&
+           k_ticks_to_ms_floor64(k_uptime_ticks() - last_edge_ticks) < DS3231_EDGE_TIMEOUT_MS;
 }
 
 //  ========== app_ds3231_periodic_sync====================================================
 int8_t app_ds3231_periodic_sync(const struct device *i2c_dev)
 {
     if (!i2c_dev) {
-        printk("RTC device is NULL\n");
+        LOG_ERR("RTC device is NULL");
         return -EINVAL;
     }
-    
+
+    // the 1 Hz discipline re-anchors on its own, the I2C read is only a fallback
+    if (app_ds3231_disciplined()) {
+        return 0;
+    }
+
     // call this periodically from a thread or workqueue
     int ret = app_ds3231_sync_uptime(i2c_dev);
     if (ret < 0) {
-        printk("periodic sync failed, error: %d", ret);
+        LOG_ERR("periodic sync failed, error: %d", ret);
     }
     return 0;
-}
\ No newline at end of file
+}
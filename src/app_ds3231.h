@@ -15,18 +15,36 @@
 #include <zephyr/drivers/rtc.h>
 #include <zephyr/drivers/counter.h>
 #include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/gpio.h>
 #include <zephyr/sys_clock.h>
+#include <zephyr/sys/timeutil.h>
+#include "app_timebase.h"
+#include "app_i2c_sched.h"
 #include <time.h>
 
 //  ========== defines =====================================================================
 #define ONE_YEAR_MS         31536000000LL
 #define DS3231_I2C_ADDR     0x68
 #define DS3231_REG_TIME     0x00
+#define DS3231_REG_CONTROL  0x0E
+#define DS3231_NODE         DT_COMPAT_GET_ANY_STATUS_OKAY(maxim_ds3231)
+#define DS3231_I2C_BUS      DEVICE_DT_GET(DT_BUS(DS3231_NODE))    // bus the DS3231 sits on
+
+// clock discipline on the 1 Hz square-wave output (SQW wired to ds3231-sqw-gpios)
+#define DS3231_FIT_EDGES        16      // edges used by the offset/frequency regression
+#define DS3231_ANCHOR_EDGES     3600    // full I2C time read once per hour
+#define DS3231_MAX_PPM          200     // reject fits further than this from nominal
+#define DS3231_EDGE_TIMEOUT_MS  3000    // discipline lost without edges for this long
 
 //  ========== prototypes ===================================================================
 const struct device *app_ds3231_init(void);
 int8_t  app_ds3231_sync_uptime(const struct device *i2c_dev);
-uint64_t app_ds3231_get_time();
+uint64_t app_ds3231_get_time(void);
+uint64_t app_ds3231_get_time_us(void);
+int64_t app_ds3231_ticks_to_us(int64_t ticks);
+int64_t app_ds3231_uptime_us_to_epoch_us(int64_t uptime_us);
+int8_t app_ds3231_discipline_start(const struct device *i2c_dev);
+bool app_ds3231_disciplined(void);
 int8_t app_ds3231_periodic_sync(const struct device *i2c_dev);
 int8_t ds3231_set_time(const struct device *i2c_dev, const struct tm *tm);
 int8_t ds3231_get_time(const struct device *i2c_dev, struct tm *tm);
@@ -7,6 +7,18 @@
 
 #include "app_eeprom.h"
 #include "app_rtc.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_eeprom, CONFIG_APP_FLASH_LOG_LEVEL);
+
+//  ========== globals =====================================================================
+// read-ahead runs on its own queue: a reader waits for it with K_FOREVER, so it must not
+// run on a queue its callers may use (the system workqueue runs the I2C boot and others)
+K_THREAD_STACK_DEFINE(eeprom_rd_stack, EEPROM_RD_STACK_SIZE);
+static struct k_work_q eeprom_rd_wq;
 
 //  ========== app_eeprom_init =============================================================
 int8_t app_eeprom_init(const struct device *dev)
@@ -17,15 +29,15 @@ int8_t app_eeprom_init(const struct device *dev)
 	// getting EEPROM size
 	dev = DEVICE_DT_GET(SPI_FLASH_DEVICE);
 	if (dev == NULL) {
-		printk("no eeprom device found. error: %d\n", dev);
+		LOG_ERR("no eeprom device found. error: %d", dev);
 		return 0;
 	}
 	
 	if (!device_is_ready(dev)) {
-		printk("eeprom is not ready\n");
+		LOG_ERR("eeprom is not ready");
 		return 0;
 	} else {
-        printk("- found device \"%s\"\n", dev->name);
+        LOG_DBG("- found device \"%s\"", dev->name);
     }
 	return 1;
 }
@@ -36,38 +48,176 @@ int8_t app_eeprom_write(const struct device *dev, int16_t data)
 	int8_t ret = 0;
 	
 	// writing data in the first page of 4kbytes
-	ret = eeprom_write(dev, SPI_FLASH_OFFSET, &data, sizeof(data));
+	uint32_t start = app_energy_start();
+	ret = flash_write(dev, SPI_FLASH_BASE + SPI_FLASH_OFFSET, &data, sizeof(data));
+	app_energy_stop(ENERGY_QSPI, start);
+	app_metrics_inc(METRIC_FLASH_WRITE);
 	if (ret!=0) {
-		printk("error writing data. error: %d\n", ret);
+		LOG_ERR("error writing data. error: %d", ret);
 	} else {
 	//	printk("wrote %zu bytes to address 0x00\n", sizeof(data));
 	}
 	// printing data
-	printk("write -> rom val: %d\n", data);
+	LOG_DBG("write -> rom val: %d", data);
 	return 0;
 }
 
-//  ========== app_rom_read ================================================================
-int16_t* app_eeprom_read(const struct device *dev)
+//  ========== app_eeprom_read =============================================================
+// read len bytes at offset into a caller buffer
+int8_t app_eeprom_read(const struct device *dev, off_t offset, void *data, size_t len)
 {
-	int8_t ret = 0;
-	int16_t data[MAX_RECORDS];
+	int8_t ret = flash_read(dev, SPI_FLASH_BASE + offset, data, len);
+	if (ret) {
+		LOG_ERR("error reading data at 0x%x. error: %d", (uint32_t)offset, ret);
+		return ret;
+	}
+	return 0;
+}
 
-	// reading the first page
-	ret = eeprom_read(dev, SPI_FLASH_OFFSET, &data, sizeof(data));
+//  ========== app_eeprom_program ==========================================================
+// program len bytes at offset, the area must have been erased
+int8_t app_eeprom_program(const struct device *dev, off_t offset, const void *data, size_t len)
+{
+	uint32_t start = app_energy_start();
+	int8_t ret = flash_write(dev, SPI_FLASH_BASE + offset, data, len);
+	app_energy_stop(ENERGY_QSPI, start);
+	app_metrics_inc(METRIC_FLASH_WRITE);
 	if (ret) {
-		printk("error reading data. error: %d\n", ret);
-	} else {
-	//	printk("read %zu bytes from address 0x00\n", sizeof(data));
+		LOG_ERR("error writing data at 0x%x. error: %d", (uint32_t)offset, ret);
+	}
+	return ret;
+}
+
+//  ========== app_eeprom_erase ============================================================
+// erase size bytes at offset, both multiples of SPI_FLASH_SECTOR_SIZE
+int8_t app_eeprom_erase(const struct device *dev, off_t offset, size_t size)
+{
+	uint32_t start = app_energy_start();
+	int8_t ret = flash_erase(dev, SPI_FLASH_BASE + offset, size);
+	app_energy_stop(ENERGY_QSPI, start);
+	app_metrics_inc(METRIC_FLASH_ERASE);
+	if (ret) {
+		LOG_ERR("error erasing 0x%x. error: %d", (uint32_t)offset, ret);
+	}
+	return ret;
+}
+
+//  ========== eeprom_readahead_work =======================================================
+// read the next chunk into the idle half of the buffer while the caller consumes the other
+static void eeprom_readahead_work(struct k_work *work)
+{
+	struct eeprom_reader *rd = CONTAINER_OF(work, struct eeprom_reader, work);
+	uint8_t *dst = rd->buf + (rd->half ^ 1) * rd->chunk;
+
+	rd->ahead_ret = flash_read(rd->dev, SPI_FLASH_BASE + rd->ahead_offset, dst, rd->ahead_len);
+	k_sem_give(&rd->done);
+}
+
+static void eeprom_readahead_submit(struct eeprom_reader *rd)
+{
+	if (rd->offset >= rd->end) {
+		return;
+	}
+
+	rd->ahead_offset = rd->offset;
+	rd->ahead_len = MIN(rd->chunk, (size_t)(rd->end - rd->offset));
+	rd->pending = true;
+	k_work_submit_to_queue(&eeprom_rd_wq, &rd->work);
+}
+
+//  ========== eeprom_rd_init ==============================================================
+static int eeprom_rd_init(void)
+{
+	struct k_work_queue_config cfg = { .name = "eeprom_rd" };
+
+	k_work_queue_start(&eeprom_rd_wq, eeprom_rd_stack, K_THREAD_STACK_SIZEOF(eeprom_rd_stack),
+			   EEPROM_RD_PRIORITY, &cfg);
+	return 0;
+}
+SYS_INIT(eeprom_rd_init, APPLICATION, 0);
+
+//  ========== app_eeprom_reader_init ======================================================
+// prepare a streaming read of len bytes at offset
+// buf must hold chunk bytes, or 2 * chunk bytes when readahead is enabled
+int8_t app_eeprom_reader_init(struct eeprom_reader *rd, const struct device *dev, off_t offset,
+			      size_t len, uint8_t *buf, size_t chunk, bool readahead)
+{
+	if (!rd || !dev || !buf || chunk == 0) {
+		return -EINVAL;
 	}
+	__ASSERT(!readahead || k_current_get() != k_work_queue_thread_get(&eeprom_rd_wq),
+		 "read-ahead waited on from its own queue");
 
-	// reading data
-	for (int8_t i = 0; i < MAX_RECORDS; i++) {
-		printk("read -> rom val: %d\n", data[i]);
+	rd->dev = dev;
+	rd->offset = offset;
+	rd->end = offset + len;
+	rd->buf = buf;
+	rd->chunk = chunk;
+	rd->readahead = readahead;
+	rd->half = 1;
+	rd->pending = false;
+	k_work_init(&rd->work, eeprom_readahead_work);
+	k_sem_init(&rd->done, 0, 1);
+
+	// start fetching the first chunk right away
+	if (readahead) {
+		eeprom_readahead_submit(rd);
 	}
-	return data;
+	return 0;
 }
 
+//  ========== app_eeprom_reader_next ======================================================
+// deliver the next chunk: returns its length (0 at the end of the stream) or an error
+// the chunk stays valid until the next call
+ssize_t app_eeprom_reader_next(struct eeprom_reader *rd, const uint8_t **data)
+{
+	size_t len;
+	int ret;
 
+	if (rd->offset >= rd->end) {
+		return 0;
+	}
+
+	if (!rd->readahead) {
+		len = MIN(rd->chunk, (size_t)(rd->end - rd->offset));
+		ret = flash_read(rd->dev, SPI_FLASH_BASE + rd->offset, rd->buf, len);
+		if (ret) {
+			LOG_ERR("error reading data at 0x%x. error: %d", (uint32_t)rd->offset, ret);
+			return ret;
+		}
+		*data = rd->buf;
+		rd->offset += len;
+		return len;
+	}
+
+	// wait for the chunk fetched in the background, then hand it over; a failed read ends
+	// the stream, nothing is left in flight for a next call to wait on
+	k_sem_take(&rd->done, K_FOREVER);
+	rd->pending = false;
+	if (rd->ahead_ret) {
+		LOG_ERR("error reading data at 0x%x. error: %d", (uint32_t)rd->ahead_offset,
+		        rd->ahead_ret);
+		rd->offset = rd->end;
+		return rd->ahead_ret;
+	}
 
+	rd->half ^= 1;
+	*data = rd->buf + rd->half * rd->chunk;
+	len = rd->ahead_len;
+	rd->offset += len;
 
+	// the caller is done with the other half: fetch the following chunk into it
+	eeprom_readahead_submit(rd);
+	return len;
+}
+
+//  ========== app_eeprom_reader_close =====================================================
+// wait for an outstanding read-ahead so the buffer can be reused
+void app_eeprom_reader_close(struct eeprom_reader *rd)
+{
+	if (rd->pending) {
+		k_sem_take(&rd->done, K_FOREVER);
+		rd->pending = false;
+	}
+	rd->offset = rd->end;
+}
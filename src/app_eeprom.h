@@ -12,16 +12,53 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
-#include <zephyr/drivers/eeprom.h>
+#include <zephyr/drivers/flash.h>
+#include <sys/types.h>
 
 //  ========== defines =====================================================================
+#if DT_HAS_COMPAT_STATUS_OKAY(nordic_qspi_nor)
 #define SPI_FLASH_DEVICE        DT_COMPAT_GET_ANY_STATUS_OKAY(nordic_qspi_nor)
+#define SPI_FLASH_BASE          0x00000			// store offsets are device offsets
+#define SPI_FLASH_SIZE          (DT_PROP(SPI_FLASH_DEVICE, size) / 8)		// MX25R64: 8 MB
+#else
+// native_sim: the store is a partition of the simulated flash (boards/native_sim.overlay)
+#define SPI_FLASH_DEVICE        DT_MTD_FROM_FIXED_PARTITION(DT_NODELABEL(qspi_store_partition))
+#define SPI_FLASH_BASE          DT_REG_ADDR(DT_NODELABEL(qspi_store_partition))
+#define SPI_FLASH_SIZE          DT_REG_SIZE(DT_NODELABEL(qspi_store_partition))
+#endif
 #define SPI_FLASH_OFFSET		0x00000
-#define MAX_RECORDS             65534   // samples (2 bytes) + timestamp (4 bytes)                   
+#define SPI_FLASH_SECTOR_SIZE	4096			// MX25R64 erase unit
+#define EEPROM_RD_STACK_SIZE	1024
+#define EEPROM_RD_PRIORITY		9				// above the recorder and fetch threads it serves
+
+//  ========== globals =====================================================================
+// streaming reader state, delivers [offset, end) in chunks from a caller buffer
+// with read-ahead the buffer holds two chunks: one is read while the other is consumed
+struct eeprom_reader {
+	const struct device *dev;
+	off_t offset;			// offset of the next chunk to deliver
+	off_t end;
+	uint8_t *buf;
+	size_t chunk;
+	bool readahead;
+	uint8_t half;			// half of buf delivered last
+	bool pending;			// read-ahead in progress
+	off_t ahead_offset;
+	size_t ahead_len;
+	int ahead_ret;
+	struct k_work work;
+	struct k_sem done;
+};
 
 //  ========== prototypes ==================================================================
 int8_t app_eeprom_init(const struct device *dev);
 int8_t app_eeprom_write(const struct device *dev, int16_t data);
-int16_t* app_eeprom_read(const struct device *dev);
+int8_t app_eeprom_read(const struct device *dev, off_t offset, void *data, size_t len);
+int8_t app_eeprom_program(const struct device *dev, off_t offset, const void *data, size_t len);
+int8_t app_eeprom_erase(const struct device *dev, off_t offset, size_t size);
+int8_t app_eeprom_reader_init(struct eeprom_reader *rd, const struct device *dev, off_t offset,
+			      size_t len, uint8_t *buf, size_t chunk, bool readahead);
+ssize_t app_eeprom_reader_next(struct eeprom_reader *rd, const uint8_t **data);
+void app_eeprom_reader_close(struct eeprom_reader *rd);
 
-#endif /* APP_EEPROM_H */
\ No newline at end of file
+#endif /* APP_EEPROM_H */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_energy.h"
+#include <zephyr/init.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+
+//  ========== globals =====================================================================
+// current draw of each subsystem while active, from the datasheets of the parts fitted;
+// adjust for a new board and the ledger figures follow
+static const struct energy_board board = {
+#if defined(CONFIG_BOARD_MDBT50Q_LORA_DEV)
+    .name = "mdbt50q_lora_dev",
+    .current_ua = {
+        [ENERGY_SAADC]      = 1300,     // SAADC and HFCLK during a conversion
+        [ENERGY_CPU_ACTIVE] = 3300,     // 64 MHz, code from flash, DC/DC on
+        [ENERGY_CPU_IDLE]   = 12,       // System ON with RTC, DS3231 and sensors idle
+        [ENERGY_I2C]        = 450,      // TWIM 100 kHz and target
+        [ENERGY_NVMC]       = 3000,     // nRF52840 NVMC write/erase
+        [ENERGY_QSPI]       = 4200,     // MX25R6435F program/erase and QSPI
+        [ENERGY_RADIO_TX]   = 45000,    // LoRa transceiver at +14 dBm
+        [ENERGY_TIMER]      = 400,      // TIMER at 1 MHz on HFINT, while a scan runs
+    },
+#else
+    .name = "nrf52840 default",
+    .current_ua = {
+        [ENERGY_SAADC]      = 1300,
+        [ENERGY_CPU_ACTIVE] = 3300,
+        [ENERGY_CPU_IDLE]   = 3,
+        [ENERGY_I2C]        = 450,
+        [ENERGY_NVMC]       = 3000,
+        [ENERGY_QSPI]       = 4200,
+        [ENERGY_RADIO_TX]   = 45000,
+        [ENERGY_TIMER]      = 400,
+    },
+#endif
+};
+
+static const char *const sub_names[ENERGY_COUNT] = {
+    [ENERGY_SAADC]      = "saadc",
+    [ENERGY_CPU_ACTIVE] = "cpu_active",
+    [ENERGY_CPU_IDLE]   = "cpu_idle",
+    [ENERGY_I2C]        = "i2c",
+    [ENERGY_NVMC]       = "nvmc",
+    [ENERGY_QSPI]       = "qspi",
+    [ENERGY_RADIO_TX]   = "radio_tx",
+    [ENERGY_TIMER]      = "timer",
+};
+
+// active time (us) per subsystem and radio airtime per data rate since the last reset;
+// CPU time is not accumulated here, it comes from the kernel runtime statistics
+static struct k_spinlock ledger_lock;
+static uint64_t active_us[ENERGY_COUNT];
+static uint64_t dr_airtime_us[ENERGY_DR_COUNT];
+static int64_t ledger_start_ms;
+static uint64_t cpu_active_base;
+static uint64_t cpu_idle_base;
+static atomic_t datarate = ATOMIC_INIT(0);
+
+//  ========== app_energy_add ==============================================================
+void app_energy_add(enum energy_sub sub, uint32_t us)
+{
+    K_SPINLOCK(&ledger_lock) {
+        active_us[sub] += us;
+    }
+}
+
+//  ========== app_energy_start and stop ===================================================
+// bracket an operation: start = app_energy_start(); ...; app_energy_stop(sub, start);
+uint32_t app_energy_start(void)
+{
+    return k_cycle_get_32();
+}
+
+void app_energy_stop(enum energy_sub sub, uint32_t start)
+{
+    app_energy_add(sub, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+}
+
+//  ========== app_energy_set_datarate =====================================================
+void app_energy_set_datarate(uint8_t dr)
+{
+    atomic_set(&datarate, MIN(dr, ENERGY_DR_COUNT - 1));
+}
+
+//  ========== app_energy_airtime_us =======================================================
+// LoRa time on air of an uplink (Semtech AN1200.13): 125 kHz, CR 4/5, explicit header,
+// CRC on, 8 preamble symbols, low data rate optimisation at SF11 and SF12
+uint32_t app_energy_airtime_us(uint8_t dr, size_t len)
+{
+    int32_t sf = 12 - MIN(dr, ENERGY_DR_COUNT - 1);
+    int32_t de = sf >= 11 ? 1 : 0;
+    uint32_t tsym_us = (1u << sf) * 8;
+    int32_t num = 8 * (int32_t)(len + ENERGY_LORA_OVERHEAD) - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * de);
+    int32_t nsym = 8 + (num > 0 ? DIV_ROUND_UP(num, den) * 5 : 0);
+
+    return tsym_us * 49 / 4 + nsym * tsym_us;
+}
+
+//  ========== app_energy_tx ===============================================================
+// account one uplink of len application bytes at the current data rate
+void app_energy_tx(size_t len)
+{
+    uint8_t dr = (uint8_t)atomic_get(&datarate);
+    uint32_t us = app_energy_airtime_us(dr, len);
+
+    K_SPINLOCK(&ledger_lock) {
+        active_us[ENERGY_RADIO_TX] += us;
+        dr_airtime_us[dr] += us;
+    }
+}
+
+//  ========== cpu_times ===================================================================
+static void cpu_times(uint64_t *active, uint64_t *idle)
+{
+    k_thread_runtime_stats_t all;
+
+    *active = 0;
+    *idle = 0;
+    if (k_thread_runtime_stats_all_get(&all) == 0) {
+        *active = all.total_cycles;
+        *idle = all.idle_cycles;
+    }
+}
+
+//  ========== app_energy_reset ============================================================
+void app_energy_reset(void)
+{
+    uint64_t active, idle;
+
+    cpu_times(&active, &idle);
+    K_SPINLOCK(&ledger_lock) {
+        memset(active_us, 0, sizeof(active_us));
+        memset(dr_airtime_us, 0, sizeof(dr_airtime_us));
+        cpu_active_base = active;
+        cpu_idle_base = idle;
+        ledger_start_ms = k_uptime_get();
+    }
+}
+
+//  ========== ledger_snapshot =============================================================
+// active time of every subsystem since the last reset, returns the elapsed time (ms)
+static int64_t ledger_snapshot(uint64_t us[ENERGY_COUNT], uint64_t dr_us[ENERGY_DR_COUNT])
+{
+    uint64_t active, idle;
+    int64_t elapsed;
+
+    cpu_times(&active, &idle);
+    K_SPINLOCK(&ledger_lock) {
+        memcpy(us, active_us, sizeof(active_us));
+        memcpy(dr_us, dr_airtime_us, sizeof(dr_airtime_us));
+        us[ENERGY_CPU_ACTIVE] = k_cyc_to_us_floor64(active - cpu_active_base);
+        us[ENERGY_CPU_IDLE] = k_cyc_to_us_floor64(idle - cpu_idle_base);
+        elapsed = k_uptime_get() - ledger_start_ms;
+    }
+    return MAX(elapsed, 1);
+}
+
+// charge per day in 0.01 mAh: us * uA / 3.6e9 (uAh -> mAh x 100) scaled to 86400 s
+static uint64_t centi_mah_per_day(uint64_t us, uint32_t ua, int64_t elapsed_ms)
+{
+    return us * ua * 24 / (10000 * (uint64_t)elapsed_ms);
+}
+
+//  ========== app_energy_encode ===========================================================
+// energy report, big-endian, ENERGY_REPORT_SIZE bytes: version u8, ledger age (h) u16,
+// charge per subsystem (0.01 mAh/day) u16 each, airtime per data rate (s/day) u16 each
+size_t app_energy_encode(uint8_t *buf, size_t size)
+{
+    uint64_t us[ENERGY_COUNT], dr_us[ENERGY_DR_COUNT];
+    size_t pos = 0;
+
+    if (size < ENERGY_REPORT_SIZE) {
+        return 0;
+    }
+
+    int64_t elapsed = ledger_snapshot(us, dr_us);
+    buf[pos++] = ENERGY_REPORT_VERSION;
+    sys_put_be16((uint16_t)MIN(elapsed / 3600000, UINT16_MAX), &buf[pos]);
+    pos += 2;
+
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        uint64_t v = centi_mah_per_day(us[i], board.current_ua[i], elapsed);
+        sys_put_be16((uint16_t)MIN(v, UINT16_MAX), &buf[pos]);
+        pos += 2;
+    }
+    for (int i = 0; i < ENERGY_DR_COUNT; i++) {
+        uint64_t v = dr_us[i] * 86400 / ((uint64_t)elapsed * 1000);
+        sys_put_be16((uint16_t)MIN(v, UINT16_MAX), &buf[pos]);
+        pos += 2;
+    }
+    return pos;
+}
+
+//  ========== app_energy_init =============================================================
+static int app_energy_init(void)
+{
+    app_energy_reset();
+    return 0;
+}
+SYS_INIT(app_energy_init, APPLICATION, 0);
+
+//  ========== shell commands ==============================================================
+static int cmd_energy_dump(const struct shell *sh, size_t argc, char **argv)
+{
+    uint64_t us[ENERGY_COUNT], dr_us[ENERGY_DR_COUNT];
+    uint64_t total = 0;
+    int64_t elapsed = ledger_snapshot(us, dr_us);
+
+    shell_print(sh, "board: %s, ledger age: %lld s", board.name, elapsed / 1000);
+    shell_print(sh, "%-12s %12s %8s %12s", "subsystem", "active ms", "uA", "mAh/day");
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        uint64_t c = centi_mah_per_day(us[i], board.current_ua[i], elapsed);
+        total += c;
+        shell_print(sh, "%-12s %12llu %8u %8llu.%02llu", sub_names[i], us[i] / 1000,
+                    board.current_ua[i], c / 100, c % 100);
+    }
+    shell_print(sh, "%-12s %12s %8s %8llu.%02llu", "total", "", "", total / 100, total % 100);
+
+    for (int i = 0; i < ENERGY_DR_COUNT; i++) {
+        shell_print(sh, "airtime DR%d: %llu ms", i, dr_us[i] / 1000);
+    }
+    return 0;
+}
+
+static int cmd_energy_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    app_energy_reset();
+    shell_print(sh, "energy ledger cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(energy_cmds,
+    SHELL_CMD(dump, NULL, "Print active time and charge per subsystem", cmd_energy_dump),
+    SHELL_CMD(reset, NULL, "Restart the ledger", cmd_energy_reset),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(energy, &energy_cmds, "Energy ledger", NULL);
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_ENERGY_H
+#define APP_ENERGY_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//  ========== defines =====================================================================
+#define ENERGY_SAADC_CONV_US    12      // tACQ 10 us + tCONV 2 us per SAADC conversion
+#define ENERGY_LORA_OVERHEAD    13      // MHDR + FHDR + FPort + MIC bytes added to the payload
+#define ENERGY_DR_COUNT         6       // EU868 DR0 (SF12) .. DR5 (SF7), 125 kHz
+#define ENERGY_REPORT_VERSION   2
+#define ENERGY_REPORT_SIZE      (3 + 2 * ENERGY_COUNT + 2 * ENERGY_DR_COUNT)
+
+//  ========== globals =====================================================================
+// subsystems the ledger accounts active time for
+enum energy_sub {
+    ENERGY_SAADC = 0,
+    ENERGY_CPU_ACTIVE,
+    ENERGY_CPU_IDLE,
+    ENERGY_I2C,
+    ENERGY_NVMC,            // internal flash program/erase
+    ENERGY_QSPI,            // external flash program/erase
+    ENERGY_RADIO_TX,
+    ENERGY_TIMER,           // TIMER2 and the 1 MHz clock, ADC sample timestamps
+    ENERGY_COUNT,
+};
+
+// per-board current draw (uA) of each subsystem while active
+struct energy_board {
+    const char *name;
+    uint32_t current_ua[ENERGY_COUNT];
+};
+
+//  ========== prototypes ==================================================================
+void app_energy_add(enum energy_sub sub, uint32_t us);
+uint32_t app_energy_start(void);
+void app_energy_stop(enum energy_sub sub, uint32_t start);
+void app_energy_set_datarate(uint8_t dr);
+void app_energy_tx(size_t len);
+uint32_t app_energy_airtime_us(uint8_t dr, size_t len);
+void app_energy_reset(void);
+size_t app_energy_encode(uint8_t *buf, size_t size);
+
+#endif /* APP_ENERGY_H */
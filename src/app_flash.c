@@ -6,94 +6,237 @@
  */
 
 //  ========== includes ====================================================================
-#include "app_adc.h"
+#include "app_power.h"
 #include "app_sht31.h"
+#include "app_ds3231.h"
 #include "app_flash.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_FLASH_SIMULATOR)
+#include <zephyr/drivers/flash/flash_simulator.h>
+#endif
+
+LOG_MODULE_REGISTER(app_flash, CONFIG_APP_FLASH_LOG_LEVEL);
 
 //  ========== globals =====================================================================
-struct flash_header {
-    uint32_t magic;
-    uint32_t head;
-};
+// block being filled in RAM, programmed once full (or on app_flash_flush)
+static uint8_t block_buf[TLM_BLOCK_SIZE] __aligned(4);
+static struct tlm_encoder encoder;
+static bool block_open = false;
+
+// the internal flash is memory-mapped: programmed blocks are read in place
+#if defined(CONFIG_FLASH_SIMULATOR)
+// native_sim: the simulated flash is a RAM buffer, map into it instead
+static uintptr_t flash_map_base(void)
+{
+	size_t size;
+
+	return (uintptr_t)flash_simulator_get_memory(FIXED_PARTITION_DEVICE(storage_partition), &size) +
+	       FIXED_PARTITION_OFFSET(storage_partition);
+}
+#define FLASH_MAP_BASE  flash_map_base()
+#else
+#define FLASH_MAP_BASE  (CONFIG_FLASH_BASE_ADDRESS + FIXED_PARTITION_OFFSET(storage_partition))
+#endif
+BUILD_ASSERT(FLASH_TOTAL_SIZE <= FIXED_PARTITION_SIZE(storage_partition),
+	     "block ring does not fit in storage_partition");
+
+// ring position of the next block to program and its sequence number
+static uint16_t next_block = 0;
+static uint32_t next_seq = 0;
+
+// mutex to serialize access to the block ring
+K_MUTEX_DEFINE(flash_lock);
+
+//  ========== app_flash_map ===============================================================
+// direct pointer to len bytes at offset in the storage partition, NULL if out of bounds
+const void *app_flash_map(off_t offset, size_t len)
+{
+	if (offset < 0 || len > FLASH_TOTAL_SIZE || offset > FLASH_TOTAL_SIZE - len) {
+		return NULL;
+	}
+	return (const void *)(FLASH_MAP_BASE + offset);
+}
+
+//  ========== app_flash_get_block =========================================================
+// pointer to a programmed block, NULL if the slot is blank or does not hold a valid block
+// the block stays valid until the ring wraps onto its sector: callers copying data out
+// can compare the header seq afterwards to detect that
+const struct tlm_block_hdr *app_flash_get_block(uint16_t index)
+{
+	if (index >= FLASH_BLOCK_COUNT) {
+		return NULL;
+	}
+
+	const uint8_t *block = app_flash_map(index * TLM_BLOCK_SIZE, TLM_BLOCK_SIZE);
+	if (!block || tlm_block_check(block) != 0) {
+		return NULL;
+	}
+	return (const struct tlm_block_hdr *)block;
+}
 
 //  ========== app_flash_init ==============================================================
+// scan the block headers to find the newest block and resume the ring after it
 int8_t app_flash_init()
 {
-	const struct flash_area *fa;
-	int8_t  ret = flash_area_open(FIXED_PARTITION_ID(storage_partition), &fa);
-	if (ret != 0) {
-    	printk("Failed to open flash area\n");
-    	return -1;
-	}
-	
-	struct flash_header hdr;
-	flash_area_read(fa, FLASH_HEAD_OFFSET, &hdr, sizeof(hdr));
+	bool found = false;
+	uint32_t newest_seq = 0;
+	uint16_t newest = 0;
+	uint16_t valid = 0;
 
-	if (hdr.magic != MAGIC_KEY) {
-		printk("flash not initialized. initializing now.\n");
+	for (uint16_t i = 0; i < FLASH_BLOCK_COUNT; i++) {
+		const struct tlm_block_hdr *hdr = app_flash_get_block(i);
+		if (!hdr) {
+			continue;
+		}
 
-		// Erase first sector
-		flash_area_erase(fa, FLASH_HEAD_OFFSET, FLASH_SECTOR_SIZE);
+		valid++;
+		if (!found || (int32_t)(hdr->seq - newest_seq) > 0) {
+			found = true;
+			newest_seq = hdr->seq;
+			newest = i;
+		}
+	}
 
-		// Write new header
-		hdr.magic = MAGIC_KEY;
-		hdr.head = 0;
-		flash_area_write(fa, FLASH_HEAD_OFFSET, &hdr, sizeof(hdr));
+	if (!found) {
+		LOG_INF("flash not initialized. starting a new block ring.");
+		next_block = 0;
+		next_seq = 0;
 	} else {
-		printk("flash already initialized. Head: %u\n", hdr.head);
+		next_block = (newest + 1) % FLASH_BLOCK_COUNT;
+		next_seq = newest_seq + 1;
+		LOG_INF("flash already initialized. blocks: %u, next: %u, seq: %u",
+		        valid, next_block, next_seq);
 	}
-	flash_area_close(fa);
 	return 1;
 }
 
-//  ========== app_flash_store =============================================================
-int8_t app_flash_store(const struct vth *data)
+//  ========== flash_program_block =========================================================
+// seal the open block and program it at the next ring position
+static int8_t flash_program_block(void)
 {
-    const struct flash_area *fa;
-    int8_t ret = flash_area_open(FIXED_PARTITION_ID(storage_partition), &fa);
-    if (ret != 0) {
-        printk("failed to open flash area\n");
-        return -1;
-    }
+	const struct flash_area *fa;
+	int8_t ret = flash_area_open(FIXED_PARTITION_ID(storage_partition), &fa);
+	if (ret != 0) {
+		LOG_ERR("failed to open flash area");
+		return -1;
+	}
 
-    // read head from the head sector
-    uint32_t head = 0;
-    flash_area_read(fa, 0, &head, sizeof(head));  // head at offset 0
+	tlm_encoder_finish(&encoder);
 
-    // compute current data offset
-    uint32_t index = head % MAX_RECORDS;
-    off_t data_offset = FLASH_DATA_OFFSET + index * RECORD_SIZE;
+	// erase sector only when writing the first block of a sector
+	if ((next_block % FLASH_BLOCKS_PER_SECTOR) != 0) {
+		const uint32_t *word = app_flash_map(next_block * TLM_BLOCK_SIZE, sizeof(uint32_t));
+		if (*word != 0xFFFFFFFF) {
+			// not blank (interrupted erase or foreign data): skip to the next sector
+			next_block = ROUND_UP(next_block, FLASH_BLOCKS_PER_SECTOR) % FLASH_BLOCK_COUNT;
+		}
+	}
 
-    // erase sector only when writing first record of a sector
-	uint32_t records_per_sector = FLASH_SECTOR_SIZE / RECORD_SIZE;
-	if ((index % records_per_sector) == 0) {
-		off_t sector_offset = data_offset & ~(FLASH_SECTOR_SIZE - 1);
-		ret = flash_area_erase(fa, sector_offset, FLASH_SECTOR_SIZE);
+	off_t data_offset = next_block * TLM_BLOCK_SIZE;
+	if ((next_block % FLASH_BLOCKS_PER_SECTOR) == 0) {
+		uint32_t start = app_energy_start();
+		ret = flash_area_erase(fa, data_offset, FLASH_SECTOR_SIZE);
+		app_energy_stop(ENERGY_NVMC, start);
+		app_metrics_inc(METRIC_FLASH_ERASE);
 		if (ret != 0) {
-			printk("erase failed at offset 0x%x\n", (uint32_t)sector_offset);
+			LOG_ERR("erase failed at offset 0x%x", (uint32_t)data_offset);
 			flash_area_close(fa);
 			return -1;
 		}
 	}
 
-    // write record
-    ret = flash_area_write(fa, data_offset, data, RECORD_SIZE);
-    if (ret != 0) {
-        printk("write failed at offset 0x%x\n", (uint32_t)data_offset);
-        flash_area_close(fa);
-        return -1;
-    }
-
-    // Update head
-    head = (head + 1) % MAX_RECORDS;
-    flash_area_write(fa, 0, &head, sizeof(head));
-    if (ret != 0) {
-		printk("failed to update head\n");
+	// write block
+	uint32_t start = app_energy_start();
+	ret = flash_area_write(fa, data_offset, block_buf, TLM_BLOCK_SIZE);
+	app_energy_stop(ENERGY_NVMC, start);
+	app_metrics_inc(METRIC_FLASH_WRITE);
+	if (ret != 0) {
+		LOG_ERR("write failed at offset 0x%x", (uint32_t)data_offset);
 		flash_area_close(fa);
 		return -1;
 	}
-    flash_area_close(fa);
-    return 0;
+
+	LOG_DBG("block %u programmed (seq %u, %u records)",
+	        next_block, next_seq, tlm_encoder_count(&encoder));
+
+	next_block = (next_block + 1) % FLASH_BLOCK_COUNT;
+	next_seq++;
+	block_open = false;
+	flash_area_close(fa);
+	return 0;
+}
+
+//  ========== app_flash_store =============================================================
+// append a record to the open block, the block is programmed when it is full
+int8_t app_flash_store(const struct vth *data)
+{
+	int8_t ret = 0;
+
+	k_mutex_lock(&flash_lock, K_FOREVER);
+	if (block_open) {
+		int err = tlm_encoder_append(&encoder, data);
+		if (err == 0) {
+			k_mutex_unlock(&flash_lock);
+			return 0;
+		}
+
+		// block full or delta out of range: program it and start a new one
+		ret = flash_program_block();
+	}
+
+	// the record becomes the base of a new block
+	tlm_encoder_start(&encoder, block_buf, next_seq, data);
+	block_open = true;
+	k_mutex_unlock(&flash_lock);
+	return ret;
+}
+
+//  ========== app_flash_flush =============================================================
+// program the open block even if not full (call before a planned shutdown or periodically)
+int8_t app_flash_flush(void)
+{
+	int8_t ret = 0;
+
+	k_mutex_lock(&flash_lock, K_FOREVER);
+	if (block_open) {
+		ret = flash_program_block();
+	}
+	k_mutex_unlock(&flash_lock);
+	return ret;
+}
+
+//  ========== app_flash_find_block ========================================================
+// random access at block granularity: index of the newest block starting at or before ts
+int app_flash_find_block(uint32_t ts)
+{
+	int best = -ENOENT;
+	uint32_t best_ts = 0;
+
+	for (uint16_t i = 0; i < FLASH_BLOCK_COUNT; i++) {
+		const struct tlm_block_hdr *hdr = app_flash_get_block(i);
+		if (!hdr) {
+			continue;
+		}
+		if (hdr->base_ts <= ts && (best < 0 || hdr->base_ts > best_ts)) {
+			best = i;
+			best_ts = hdr->base_ts;
+		}
+	}
+	return best;
+}
+
+//  ========== app_flash_read_block ========================================================
+// decode a programmed block, returns the number of records copied to records
+int app_flash_read_block(uint16_t index, struct vth *records, size_t max)
+{
+	if (index >= FLASH_BLOCK_COUNT || !records) {
+		return -EINVAL;
+	}
+
+	const uint8_t *block = app_flash_map(index * TLM_BLOCK_SIZE, TLM_BLOCK_SIZE);
+	return tlm_block_decode(block, records, max);
 }
 
 //  ========== app_flash_handler ===========================================================
@@ -103,24 +246,26 @@ int8_t app_flash_handler(const struct device *dev)
 
 	// retrieve the sensor device using the device tree API
 	if (!device_is_ready(dev)) {
-        printk("%s: sensor device not ready\n", dev->name);
+        LOG_ERR("%s: sensor device not ready", dev->name);
         return -1;
     }
 
-	// collect sensor data until the maximum number of records is reached
-	// measure and store the battery voltage
-	data.vbat = app_nrf52_get_vbat();
-
-	// measure and store the temperature using the SHT31 sensor
-	data.temp = app_sht31_get_temp(dev);
+	// timestamp of the record in epoch seconds
+	data.ts = (uint32_t)(app_ds3231_get_time() / 1000);
 
-	k_msleep(5000);		// small delay  between reading the temperature and humidity values
+	// battery level cached by the battery job
+	data.vbat = app_power_get_soc();
 
-	// measure and store the humidity using the SHT31 sensor
-	data.hum = app_sht31_get_hum(dev);
+	// temperature and humidity from the last SHT31 conversion, then start the next one
+	struct sht31_sample env = {0};
+	if (app_sht31_get(&env) < 0) {
+		LOG_WRN("no SHT31 sample available yet");
+	}
+	data.temp = env.temp;
+	data.hum = env.hum;
+	(void)app_sht31_trigger();
 
 	// save the collected sensor data into the flash memory
 	int8_t ret = app_flash_store(&data);
     return 1;
 }
-
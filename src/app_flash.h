@@ -14,13 +14,7 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/flash.h>
 #include <zephyr/storage/flash_map.h>
-
-//  ========== globals =====================================================================
-struct vth {
-	int16_t vbat;
-	int16_t temp;
-	int16_t hum;
-};
+#include "app_tlm_codec.h"
 
 //  ========== defines =====================================================================
 #define FLASH_PARTITION_OFFSET  0x000F8000	
@@ -28,16 +22,18 @@ struct vth {
 #define FLASH_SECTOR_COUNT      4			// 4 sectors × 4 KB = 16 KB
 #define FLASH_TOTAL_SIZE        (FLASH_SECTOR_SIZE * FLASH_SECTOR_COUNT)
 
-#define FLASH_HEAD_OFFSET		0x0000                 
-#define FLASH_DATA_OFFSET       0x0100
-
-#define MAX_RECORDS             (0x8000 - FLASH_DATA_OFFSET) / RECORD_SIZE  // = 4064
-#define RECORD_SIZE             8 
-#define MAGIC_KEY				0xDEADBEEF
+// the partition is a ring of fixed-size delta-encoded blocks (see app_tlm_codec.h)
+#define FLASH_BLOCKS_PER_SECTOR (FLASH_SECTOR_SIZE / TLM_BLOCK_SIZE)	// = 16
+#define FLASH_BLOCK_COUNT       (FLASH_TOTAL_SIZE / TLM_BLOCK_SIZE)	// = 64
 
 //  ========== prototypes ==================================================================
 int8_t app_flash_init(void);
 int8_t app_flash_store(const struct vth *data);
+int8_t app_flash_flush(void);
+const void *app_flash_map(off_t offset, size_t len);
+const struct tlm_block_hdr *app_flash_get_block(uint16_t index);
+int app_flash_find_block(uint32_t ts);
+int app_flash_read_block(uint16_t index, struct vth *records, size_t max);
 int8_t app_flash_handler(const struct device *dev);
 
-#endif /* APP_FLASH_H */
\ No newline at end of file
+#endif /* APP_FLASH_H */
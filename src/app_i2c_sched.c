@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_i2c_sched.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include <zephyr/init.h>
+
+//  ========== globals =====================================================================
+// all I2C traffic of the application goes through one bus thread: drivers submit
+// descriptors and get a callback, their own threads never block on the bus
+K_THREAD_STACK_DEFINE(i2c_sched_stack, I2C_SCHED_STACK_SIZE);
+static struct k_work_q i2c_sched_wq;
+static struct k_work_delayable dispatch_work;
+
+// pending transactions sorted by due time
+static sys_slist_t pending = SYS_SLIST_STATIC_INIT(&pending);
+static struct k_spinlock pending_lock;
+
+//  ========== descriptor helpers ==========================================================
+void app_i2c_txn_write(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                       uint8_t *buf, size_t len)
+{
+    txn->spec = spec;
+    txn->cb = NULL;
+    txn->user_data = NULL;
+    txn->done = NULL;
+    txn->msgs[0].buf = buf;
+    txn->msgs[0].len = len;
+    txn->msgs[0].flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+    txn->num_msgs = 1;
+}
+
+void app_i2c_txn_read(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                      uint8_t *buf, size_t len)
+{
+    txn->spec = spec;
+    txn->cb = NULL;
+    txn->user_data = NULL;
+    txn->done = NULL;
+    txn->msgs[0].buf = buf;
+    txn->msgs[0].len = len;
+    txn->msgs[0].flags = I2C_MSG_READ | I2C_MSG_STOP;
+    txn->num_msgs = 1;
+}
+
+void app_i2c_txn_write_read(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                            uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+    txn->spec = spec;
+    txn->cb = NULL;
+    txn->user_data = NULL;
+    txn->done = NULL;
+    txn->msgs[0].buf = wbuf;
+    txn->msgs[0].len = wlen;
+    txn->msgs[0].flags = I2C_MSG_WRITE;
+    txn->msgs[1].buf = rbuf;
+    txn->msgs[1].len = rlen;
+    txn->msgs[1].flags = I2C_MSG_RESTART | I2C_MSG_READ | I2C_MSG_STOP;
+    txn->num_msgs = 2;
+}
+
+//  ========== i2c_sched_dispatch ==========================================================
+// run every transaction already due back to back, then sleep until the next one is due;
+// none runs early, a delayed submit may be waiting on the device (SHT31 conversion)
+static void i2c_sched_dispatch(struct k_work *work)
+{
+    while (1) {
+        struct i2c_txn *txn = NULL;
+        int64_t next_due = -1;
+
+        K_SPINLOCK(&pending_lock) {
+            sys_snode_t *node = sys_slist_peek_head(&pending);
+            if (node) {
+                struct i2c_txn *head = CONTAINER_OF(node, struct i2c_txn, node);
+                if (head->due <= k_uptime_get()) {
+                    sys_slist_get_not_empty(&pending);
+                    txn = head;
+                } else {
+                    next_due = head->due;
+                }
+            }
+        }
+
+        if (!txn) {
+            if (next_due >= 0) {
+                k_work_reschedule_for_queue(&i2c_sched_wq, &dispatch_work,
+                                            K_TIMEOUT_ABS_MS(next_due));
+            }
+            return;
+        }
+
+        uint32_t start = app_energy_start();
+        txn->result = i2c_transfer(txn->spec->bus, txn->msgs, txn->num_msgs, txn->spec->addr);
+        app_energy_stop(ENERGY_I2C, start);
+        if (txn->result < 0) {
+            app_metrics_inc(METRIC_I2C_ERROR);
+        }
+        if (txn->cb) {
+            txn->cb(txn, txn->result);
+        }
+        if (txn->done) {
+            k_sem_give(txn->done);
+        }
+    }
+}
+
+//  ========== i2c_sched_init ==============================================================
+static int i2c_sched_init(void)
+{
+    struct k_work_queue_config cfg = { .name = "i2c_sched" };
+
+    k_work_init_delayable(&dispatch_work, i2c_sched_dispatch);
+    k_work_queue_start(&i2c_sched_wq, i2c_sched_stack, K_THREAD_STACK_SIZEOF(i2c_sched_stack),
+                       I2C_SCHED_PRIORITY, &cfg);
+    return 0;
+}
+SYS_INIT(i2c_sched_init, APPLICATION, 0);
+
+//  ========== app_i2c_submit ==============================================================
+// queue a transaction to run after delay (at the earliest), its callback runs on the bus
+// thread when done
+int app_i2c_submit(struct i2c_txn *txn, k_timeout_t delay)
+{
+    bool first;
+    int64_t due;
+
+    if (!txn || !txn->spec || txn->num_msgs == 0) {
+        return -EINVAL;
+    }
+
+    K_SPINLOCK(&pending_lock) {
+        // insert sorted by due time, after transactions due at the same time
+        sys_snode_t *prev = NULL, *node;
+        txn->due = k_uptime_get() + k_ticks_to_ms_ceil64(delay.ticks);
+        SYS_SLIST_FOR_EACH_NODE(&pending, node) {
+            if (CONTAINER_OF(node, struct i2c_txn, node)->due > txn->due) {
+                break;
+            }
+            prev = node;
+        }
+        sys_slist_insert(&pending, prev, &txn->node);
+        first = (prev == NULL);
+        due = txn->due;
+    }
+
+    // the new transaction is now the earliest one: wake the bus thread when it is due, the
+    // same deadline the dispatcher checks
+    if (first) {
+        k_work_reschedule_for_queue(&i2c_sched_wq, &dispatch_work, K_TIMEOUT_ABS_MS(due));
+    }
+    return 0;
+}
+
+//  ========== app_i2c_transfer_wait =======================================================
+// submit and wait for completion, for the few callers that need the result inline
+int app_i2c_transfer_wait(struct i2c_txn *txn)
+{
+    struct k_sem done;
+
+    k_sem_init(&done, 0, 1);
+    txn->done = &done;
+
+    int ret = app_i2c_submit(txn, K_NO_WAIT);
+    if (ret < 0) {
+        return ret;
+    }
+    k_sem_take(&done, K_FOREVER);
+    return txn->result;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_I2C_SCHED_H
+#define APP_I2C_SCHED_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/sys/slist.h>
+
+//  ========== defines =====================================================================
+#define I2C_SCHED_STACK_SIZE    1024
+#define I2C_SCHED_PRIORITY      4       // below the acquisition, detection and TX threads
+#define I2C_TXN_MAX_MSGS        2
+
+//  ========== globals =====================================================================
+struct i2c_txn;
+
+// completion callback, runs on the bus thread: keep it short, submit follow-ups from it
+typedef void (*i2c_txn_cb_t)(struct i2c_txn *txn, int result);
+
+// transaction descriptor, owned by the device driver until its callback runs
+struct i2c_txn {
+    sys_snode_t node;
+    const struct i2c_dt_spec *spec;     // bus and target address
+    struct i2c_msg msgs[I2C_TXN_MAX_MSGS];
+    uint8_t num_msgs;
+    int64_t due;                        // uptime (ms) the transaction is due, never earlier
+    i2c_txn_cb_t cb;
+    void *user_data;
+    int result;
+    struct k_sem *done;                 // used by app_i2c_transfer_wait
+};
+
+//  ========== prototypes ==================================================================
+void app_i2c_txn_write(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                       uint8_t *buf, size_t len);
+void app_i2c_txn_read(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                      uint8_t *buf, size_t len);
+void app_i2c_txn_write_read(struct i2c_txn *txn, const struct i2c_dt_spec *spec,
+                            uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen);
+int app_i2c_submit(struct i2c_txn *txn, k_timeout_t delay);
+int app_i2c_transfer_wait(struct i2c_txn *txn);
+
+#endif /* APP_I2C_SCHED_H */
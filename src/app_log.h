@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+//  ========== defines =====================================================================
+// log from a hot path at most once per _interval_ms, the messages dropped in between are
+// counted and reported with the next one; the state is per call site, e.g.
+//   APP_LOG_RATELIMIT(LOG_ERR, 1000, "failed to read ADC sequence 0");
+#define APP_LOG_RATELIMIT(_log, _interval_ms, _fmt, ...)                               \
+    do {                                                                                \
+        static int64_t _next_ms;                                                        \
+        static uint32_t _dropped;                                                       \
+        int64_t _now_ms = k_uptime_get();                                               \
+        if (_now_ms >= _next_ms) {                                                      \
+            _log(_fmt " (%u dropped)", ##__VA_ARGS__, _dropped);                        \
+            _dropped = 0;                                                               \
+            _next_ms = _now_ms + (_interval_ms);                                        \
+        } else {                                                                        \
+            _dropped++;                                                                 \
+        }                                                                               \
+    } while (0)
+
+#endif /* APP_LOG_H */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_lorawan.h"
+#include "app_energy.h"
+#include <zephyr/random/random.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+LOG_MODULE_DECLARE(app_lorawan, CONFIG_APP_LORAWAN_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define JOIN_STACK_SIZE         1536
+#define JOIN_PRIORITY           6       // below acquisition, detection and uplinks
+
+#define LORAWAN_EVT_JOINED      BIT(0)
+
+//  ========== globals =====================================================================
+K_THREAD_STACK_DEFINE(join_stack, JOIN_STACK_SIZE);
+struct k_thread join_thread_data;
+
+// LORAWAN_EVT_JOINED while the stack holds a session, the TX thread waits on it
+K_EVENT_DEFINE(lorawan_state);
+
+// given at start and when a restored session turns out to be rejected
+K_SEM_DEFINE(join_request, 0, 1);
+
+static app_lorawan_joined_cb_t joined_cb;
+
+// persisted under LORAWAN_SETTINGS_KEY: whether the stack holds a joined session; the
+// session itself (DevAddr, keys, frame counters, DevNonce) is persisted by the stack
+// (CONFIG_LORAWAN_NVM_SETTINGS)
+struct lorawan_session {
+    uint8_t joined;
+};
+
+static struct lorawan_session session;
+
+// uplinks go confirmed after a restored session until the network acknowledges one
+static bool session_verified = true;
+static uint8_t verify_failures = 0;
+
+//  ========== settings handler ============================================================
+static int session_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    if (strcmp(name, "session") != 0) {
+        return -ENOENT;
+    }
+    if (len != sizeof(session)) {
+        return -EINVAL;
+    }
+    int ret = read_cb(cb_arg, &session, sizeof(session));
+    return ret < 0 ? ret : 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(app_lorawan, LORAWAN_SETTINGS_KEY, NULL, session_set, NULL, NULL);
+
+static int session_save(void)
+{
+    int ret = settings_save_one(LORAWAN_SETTINGS_KEY "/session", &session, sizeof(session));
+    if (ret < 0) {
+        LOG_ERR("failed to save LoRaWAN session: %d", ret);
+    }
+    return ret;
+}
+
+//  ========== lorawan_datarate_changed ====================================================
+static void lorawan_datarate_changed(enum lorawan_datarate dr)
+{
+    uint8_t unused, max_size;
+
+    lorawan_get_payload_sizes(&unused, &max_size);
+    LOG_INF("New Datarate: DR_%d, Max Payload %d", dr, max_size);
+    app_energy_set_datarate(dr);
+}
+
+//  ========== join_once ===================================================================
+// one OTAA join request; the stack picks the DevNonce and keeps it in its own context, the
+// dev_nonce of the configuration is ignored with CONFIG_LORAWAN_NVM_SETTINGS
+static int join_once(void)
+{
+    struct lorawan_join_config join_cfg = {0};
+    uint8_t dev_eui[] = LORAWAN_DEV_EUI;
+    uint8_t join_eui[] = LORAWAN_JOIN_EUI;
+    uint8_t app_key[] = LORAWAN_APP_KEY;
+
+    join_cfg.mode = LORAWAN_ACT_OTAA;
+    join_cfg.dev_eui = dev_eui;
+    join_cfg.otaa.join_eui = join_eui;
+    join_cfg.otaa.app_key = app_key;
+    join_cfg.otaa.nwk_key = app_key;
+
+    LOG_INF("Joining network over OTAA");
+    return lorawan_join(&join_cfg);
+}
+
+//  ========== set_joined ==================================================================
+static void set_joined(void)
+{
+    k_event_post(&lorawan_state, LORAWAN_EVT_JOINED);
+    if (joined_cb) {
+        joined_cb();
+    }
+}
+
+//  ========== app_lorawan_join_thread =====================================================
+// joins in the background, retrying with a randomized exponential backoff, so that boot
+// never waits on the network; acquisition runs and uplinks queue in the meantime
+static void app_lorawan_join_thread(void *arg1, void *arg2, void *arg3)
+{
+    while (1) {
+        k_sem_take(&join_request, K_FOREVER);
+
+        if (session.joined) {
+            // to be confirmed by the first acknowledged uplink, see app_lorawan_uplink_done
+            LOG_INF("LoRaWAN session restored");
+            session_verified = false;
+            verify_failures = 0;
+            set_joined();
+            continue;
+        }
+
+        int64_t start = k_uptime_get();
+        uint32_t backoff_s = LORAWAN_JOIN_BACKOFF_MIN_S;
+        int ret;
+        while ((ret = join_once()) < 0) {
+            // up to a quarter more, so that nodes powered up together spread out
+            uint32_t delay_ms = backoff_s * 1000;
+            delay_ms += sys_rand32_get() % (delay_ms / 4 + 1);
+            LOG_WRN("lorawan_join_network failed: %d, next attempt in %u s", ret,
+                    delay_ms / 1000);
+            k_sleep(K_MSEC(delay_ms));
+            backoff_s = MIN(backoff_s * 2, LORAWAN_JOIN_BACKOFF_MAX_S);
+        }
+
+        LOG_INF("joined in %lld ms", k_uptime_get() - start);
+        session.joined = 1;
+        (void)session_save();
+        session_verified = true;
+        verify_failures = 0;
+        set_joined();
+    }
+}
+
+//  ========== app_lorawan_init ============================================================
+// start the stack and the join thread, which restores the persisted session or joins;
+// returns at once. downlink_cb must stay valid, the stack keeps the pointer; joined, if
+// not NULL, runs on the join thread each time a session becomes usable
+int8_t app_lorawan_init(struct lorawan_downlink_cb *downlink_cb, app_lorawan_joined_cb_t joined)
+{
+    int ret;
+
+    ret = settings_subsys_init();
+    if (ret < 0) {
+        LOG_ERR("settings_subsys_init failed: %d", ret);
+        return 0;
+    }
+    (void)settings_load_subtree(LORAWAN_SETTINGS_KEY);
+
+    // native_sim has no radio, the LoRaWAN stand-in in src/sim takes the frames
+#if DT_NODE_EXISTS(DT_ALIAS(lora0))
+    const struct device *lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0));
+    if (!device_is_ready(lora_dev)) {
+        LOG_ERR("%s: device not ready", lora_dev->name);
+        return 0;
+    }
+#endif
+
+    // restores the stack context from the settings as well
+    ret = lorawan_start();
+    if (ret < 0) {
+        LOG_ERR("lorawan_start failed: %d", ret);
+        return 0;
+    }
+
+    lorawan_register_downlink_callback(downlink_cb);
+    lorawan_register_dr_changed_callback(lorawan_datarate_changed);
+    joined_cb = joined;
+
+    k_thread_create(&join_thread_data, join_stack, K_THREAD_STACK_SIZEOF(join_stack),
+                    app_lorawan_join_thread, NULL, NULL, NULL, JOIN_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&join_thread_data, "lorawan_join");
+    k_sem_give(&join_request);
+    return 1;
+}
+
+//  ========== app_lorawan_wait_joined =====================================================
+// true once a session is usable, false on timeout
+bool app_lorawan_wait_joined(k_timeout_t timeout)
+{
+    return k_event_wait(&lorawan_state, LORAWAN_EVT_JOINED, false, timeout) != 0;
+}
+
+//  ========== app_lorawan_uplink_type =====================================================
+// confirmed until a restored session has been acknowledged by the network
+enum lorawan_message_type app_lorawan_uplink_type(void)
+{
+    return session_verified ? LORAWAN_MSG_UNCONFIRMED : LORAWAN_MSG_CONFIRMED;
+}
+
+//  ========== app_lorawan_uplink_done =====================================================
+// result of an uplink sent with app_lorawan_uplink_type: a restored session the network
+// no longer knows never gets an acknowledgement, it is dropped and the node joins again
+void app_lorawan_uplink_done(int ret)
+{
+    if (session_verified || ret == -EAGAIN) {
+        return;
+    }
+    if (ret == 0) {
+        LOG_INF("restored LoRaWAN session acknowledged");
+        session_verified = true;
+        return;
+    }
+    if (++verify_failures < LORAWAN_VERIFY_ATTEMPTS) {
+        return;
+    }
+
+    // uplinks wait for the join thread from now on
+    LOG_WRN("restored LoRaWAN session rejected, joining again");
+    k_event_clear(&lorawan_state, LORAWAN_EVT_JOINED);
+    session.joined = 0;
+    (void)session_save();
+    k_sem_give(&join_request);
+}
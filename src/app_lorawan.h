@@ -16,6 +16,8 @@
 #include <zephyr/drivers/lora.h>
 #include <zephyr/lorawan/lorawan.h>
 #include <zephyr/random/random.h>
+#include <zephyr/net_buf.h>
+#include "app_uplink_codec.h"
 
 //  ========== defines =====================================================================
 #define LED_TX                  DT_ALIAS(ledtx)     // declared in device tree 
@@ -26,13 +28,36 @@
 
 #define LORAWAN_JOIN_EUI		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
 #define LORAWAN_APP_KEY			{ 0xC7, 0x32, 0x0F, 0x37, 0xFF, 0x62, 0xE0, 0xA8, 0x4E, 0x94, 0xC1, 0x9C, 0x27, 0x2B, 0xFA, 0x4C }
-#define LORAWAN_PORT            2       // application port
-#define MAX_JOIN_ATTEMPTS       10      // limiting join attempts
+#define LORAWAN_PORT            UPLINK_TELEMETRY_PORT           // telemetry frame
+#define LORAWAN_HEALTH_PORT     UPLINK_PORT_HEALTH              // app_metrics_encode
+#define LORAWAN_ENERGY_PORT     UPLINK_PORT_ENERGY              // app_energy_encode
+#define LORAWAN_WAVEFORM_PORT   UPLINK_WAVEFORM_FRAGMENT_PORT   // event window fragments
+#define LORAWAN_TRIGGER_PORT    UPLINK_TRIGGER_PORT             // event onset, sent first
+#define LORAWAN_NOISE_PORT      UPLINK_NOISE_PORT               // noise band levels (app_psd)
+#define LORAWAN_EVENT_PORT      UPLINK_EVENT_PORT               // event class and features
+#define LORAWAN_COMMAND_PORT    10      // downlink commands (app_recorder_command)
+#define LORAWAN_JOIN_BACKOFF_MIN_S  15      // first retry of a failed join
+#define LORAWAN_JOIN_BACKOFF_MAX_S  3600    // then doubling up to once an hour
+#define LORAWAN_SETTINGS_KEY    "app/lw"    // join state (app_lorawan.c)
+#define LORAWAN_VERIFY_ATTEMPTS 3       // unacknowledged uplinks before a restored session
+                                        // is considered rejected
+
+//  ========== globals =====================================================================
+typedef void (*app_lorawan_joined_cb_t)(void);
+
+extern struct k_thread lorawan_thread_data;
+extern struct k_thread join_thread_data;
 
 //  ========== prototypes ==================================================================
-int8_t app_lorawan_init(void);
+int8_t app_lorawan_init(struct lorawan_downlink_cb *downlink_cb, app_lorawan_joined_cb_t joined);
+bool app_lorawan_wait_joined(k_timeout_t timeout);
+enum lorawan_message_type app_lorawan_uplink_type(void);
+void app_lorawan_uplink_done(int ret);
 int app_lorawan_start_tx(void);
-void app_lorawan_trigger_tx(void);
-static void app_lorawan_thread(void *arg1, void *arg2, void *arg3);
+int app_lorawan_send(uint8_t port, uint8_t *data, uint8_t len);
+void app_lorawan_queue(struct net_buf *buf, uint8_t port);
+void app_lorawan_queue_window(struct net_buf *buf);
+uint8_t app_lorawan_trigger_tx(int64_t onset_us, uint16_t ratio_x10, uint16_t sta);
+void app_lorawan_window_tx(uint8_t seq, const uint16_t *samples, int64_t t0_us);
 
 #endif /* APP_LORAWAN_H */
\ No newline at end of file
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_metrics.h"
+#include "app_lorawan.h"
+#include "app_buf.h"
+#include "app_adc.h"
+#include "app_sta_lta.h"
+#include "app_recorder.h"
+#include "app_classifier.h"
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_metrics, CONFIG_APP_METRICS_LOG_LEVEL);
+
+// the health record must go out at EU868 DR0 to DR2
+BUILD_ASSERT(METRICS_HEALTH_SIZE <= 51, "health record larger than the DR0 payload");
+
+//  ========== globals =====================================================================
+// plain atomics: updating a metric never takes a lock, so hot paths and ISRs can count
+static atomic_t counters[METRIC_COUNT];
+
+static const char *const counter_names[METRIC_COUNT] = {
+    [METRIC_ADC_OVERRUN]        = "adc_overrun",
+    [METRIC_ADC_DEADLINE_MISS]  = "adc_deadline_miss",
+    [METRIC_FLASH_WRITE]        = "flash_write",
+    [METRIC_FLASH_ERASE]        = "flash_erase",
+    [METRIC_LORAWAN_TX_OK]      = "lorawan_tx_ok",
+    [METRIC_LORAWAN_TX_FAIL]    = "lorawan_tx_fail",
+    [METRIC_I2C_ERROR]          = "i2c_error",
+    [METRIC_DETECTION]          = "detection",
+    [METRIC_UPLINK_DROP]        = "uplink_drop",
+    [METRIC_ADC_SKIPPED]        = "adc_skipped",
+};
+
+static struct {
+    const char *name;
+    uint8_t shift;
+    atomic_t buckets[METRICS_HIST_BUCKETS];
+} hists[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_SEM_WAIT_US]   = { .name = "sem_wait_us", .shift = 4 },    // 16 us .. 2 ms
+    [METRIC_HIST_TX_MS]         = { .name = "tx_ms", .shift = 7 },          // 128 ms .. 16 s
+};
+
+// thread slots of the health record, in this order whatever the order of the kernel thread
+// list; a slot reads 0 while its thread is not running
+static const struct k_thread *const health_threads[METRICS_MAX_THREADS] = {
+    &adc_thread_data,           // 0 adc
+    &sta_lta_thread_data,       // 1 sta_lta
+    &lorawan_thread_data,       // 2 lorawan_tx
+    &join_thread_data,          // 3 lorawan_join
+    &rec_thread_data,           // 4 recorder
+    &clf_thread_data,           // 5 classify
+};
+
+// one thread's figures, collected by walking the thread list
+struct thread_info {
+    const char *name;
+    size_t stack_size;
+    size_t stack_unused;
+    uint64_t cycles;
+};
+
+//  ========== app_metrics_inc and add =====================================================
+void app_metrics_inc(enum metric_id id)
+{
+    atomic_inc(&counters[id]);
+}
+
+void app_metrics_add(enum metric_id id, uint32_t n)
+{
+    atomic_add(&counters[id], n);
+}
+
+//  ========== app_metrics_hist ============================================================
+void app_metrics_hist(enum metric_hist_id id, uint32_t value)
+{
+    uint32_t bits = value ? 32 - __builtin_clz(value) : 0;
+    uint32_t bucket = bits > hists[id].shift ? bits - hists[id].shift : 0;
+
+    atomic_inc(&hists[id].buckets[MIN(bucket, METRICS_HIST_BUCKETS - 1)]);
+}
+
+//  ========== app_metrics_reset ===========================================================
+void app_metrics_reset(void)
+{
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        atomic_clear(&counters[i]);
+    }
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            atomic_clear(&hists[i].buckets[b]);
+        }
+    }
+}
+
+//  ========== thread statistics ===========================================================
+struct thread_walk {
+    struct thread_info *info;
+    int max;
+    int count;
+};
+
+static void thread_stats(const struct k_thread *cthread, struct thread_info *ti)
+{
+    struct k_thread *thread = (struct k_thread *)cthread;
+    k_thread_runtime_stats_t rt;
+
+    ti->name = k_thread_name_get(thread);
+    ti->stack_size = thread->stack_info.size;
+    if (k_thread_stack_space_get(thread, &ti->stack_unused) != 0) {
+        ti->stack_unused = 0;
+    }
+    ti->cycles = (k_thread_runtime_stats_get(thread, &rt) == 0) ? rt.execution_cycles : 0;
+}
+
+static void thread_collect(const struct k_thread *cthread, void *user_data)
+{
+    struct thread_walk *walk = user_data;
+
+    if (walk->count < walk->max) {
+        thread_stats(cthread, &walk->info[walk->count++]);
+    }
+}
+
+// only threads in the kernel list are looked at, a slot thread never started stays 0
+static void health_collect(const struct k_thread *cthread, void *user_data)
+{
+    struct thread_info *info = user_data;
+
+    for (int i = 0; i < METRICS_MAX_THREADS; i++) {
+        if (health_threads[i] == cthread) {
+            thread_stats(cthread, &info[i]);
+            return;
+        }
+    }
+}
+
+static int thread_list(struct thread_info *info, int max, uint64_t *total)
+{
+    struct thread_walk walk = { .info = info, .max = max, .count = 0 };
+    k_thread_runtime_stats_t all;
+
+    k_thread_foreach(thread_collect, &walk);
+    *total = (k_thread_runtime_stats_all_get(&all) == 0) ? all.execution_cycles : 0;
+    return walk.count;
+}
+
+//  ========== app_metrics_encode ==========================================================
+// compact binary health record, big-endian, METRICS_HEALTH_SIZE bytes:
+//   version u8, uptime (h) u16, counters u16 each, histogram buckets u8 each,
+//   then per thread slot (health_threads): unused stack (16-byte units) u8, CPU share (%) u8
+// values saturate instead of wrapping
+size_t app_metrics_encode(uint8_t *buf, size_t size)
+{
+    struct thread_info info[METRICS_MAX_THREADS] = {0};
+    k_thread_runtime_stats_t all;
+    uint64_t total;
+    size_t pos = 0;
+
+    if (size < METRICS_HEALTH_SIZE) {
+        return 0;
+    }
+
+    buf[pos++] = METRICS_HEALTH_VERSION;
+    sys_put_be16((uint16_t)MIN(k_uptime_get() / 3600000, UINT16_MAX), &buf[pos]);
+    pos += 2;
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        sys_put_be16((uint16_t)MIN((uint32_t)atomic_get(&counters[i]), UINT16_MAX), &buf[pos]);
+        pos += 2;
+    }
+
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            buf[pos++] = (uint8_t)MIN((uint32_t)atomic_get(&hists[i].buckets[b]), UINT8_MAX);
+        }
+    }
+
+    k_thread_foreach(health_collect, info);
+    total = (k_thread_runtime_stats_all_get(&all) == 0) ? all.execution_cycles : 0;
+    for (int i = 0; i < METRICS_MAX_THREADS; i++) {
+        buf[pos++] = (uint8_t)MIN(info[i].stack_unused / 16, UINT8_MAX);
+        buf[pos++] = total ? (uint8_t)(info[i].cycles * 100 / total) : 0;
+    }
+    return pos;
+}
+
+//  ========== app_metrics_send_health =====================================================
+int8_t app_metrics_send_health(void)
+{
+    struct net_buf *buf = app_buf_uplink_alloc(K_NO_WAIT);
+    if (!buf) {
+        LOG_WRN("health uplink dropped, no free buffer");
+        return -ENOMEM;
+    }
+
+    // encode straight into the frame
+    net_buf_add(buf, app_metrics_encode(net_buf_tail(buf), net_buf_tailroom(buf)));
+    app_lorawan_queue(buf, LORAWAN_HEALTH_PORT);
+    return 0;
+}
+
+//  ========== shell commands ==============================================================
+static int cmd_metrics_dump(const struct shell *sh, size_t argc, char **argv)
+{
+    struct thread_info info[16];
+    uint64_t total;
+
+    shell_print(sh, "uptime: %lld s", k_uptime_get() / 1000);
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        shell_print(sh, "%-20s %u", counter_names[i], (uint32_t)atomic_get(&counters[i]));
+    }
+
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        shell_fprintf(sh, SHELL_NORMAL, "%-20s", hists[i].name);
+        for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+            shell_fprintf(sh, SHELL_NORMAL, " <%u:%u", 1u << (hists[i].shift + b),
+                          (uint32_t)atomic_get(&hists[i].buckets[b]));
+        }
+        shell_fprintf(sh, SHELL_NORMAL, " >=%u:%u",
+                      1u << (hists[i].shift + METRICS_HIST_BUCKETS - 2),
+                      (uint32_t)atomic_get(&hists[i].buckets[METRICS_HIST_BUCKETS - 1]));
+        shell_fprintf(sh, SHELL_NORMAL, "\n");
+    }
+
+    int n = thread_list(info, ARRAY_SIZE(info), &total);
+    shell_print(sh, "%-20s %6s %6s %5s", "thread", "stack", "unused", "cpu%");
+    for (int i = 0; i < n; i++) {
+        shell_print(sh, "%-20s %6u %6u %5u", info[i].name ? info[i].name : "?",
+                    (uint32_t)info[i].stack_size, (uint32_t)info[i].stack_unused,
+                    total ? (uint32_t)(info[i].cycles * 100 / total) : 0);
+    }
+    return 0;
+}
+
+static int cmd_metrics_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    app_metrics_reset();
+    shell_print(sh, "metrics cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(metrics_cmds,
+    SHELL_CMD(dump, NULL, "Print counters, histograms and thread statistics", cmd_metrics_dump),
+    SHELL_CMD(reset, NULL, "Clear counters and histograms", cmd_metrics_reset),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(metrics, &metrics_cmds, "Runtime metrics", NULL);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_METRICS_H
+#define APP_METRICS_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//  ========== defines =====================================================================
+#define METRICS_HIST_BUCKETS    8
+#define METRICS_MAX_THREADS     6       // thread slots of the health uplink, see app_metrics.c
+#define METRICS_HEALTH_VERSION  3
+#define METRICS_HEALTH_SIZE     (3 + 2 * METRIC_COUNT + METRICS_HIST_BUCKETS * METRIC_HIST_COUNT + \
+                                 2 * METRICS_MAX_THREADS)
+
+//  ========== globals =====================================================================
+// event counters, any context may update them
+enum metric_id {
+    METRIC_ADC_OVERRUN = 0,     // sample not consumed before the next one was ready
+    METRIC_ADC_DEADLINE_MISS,   // sampling interval exceeded twice the nominal period
+    METRIC_FLASH_WRITE,
+    METRIC_FLASH_ERASE,
+    METRIC_LORAWAN_TX_OK,
+    METRIC_LORAWAN_TX_FAIL,
+    METRIC_I2C_ERROR,
+    METRIC_DETECTION,
+    METRIC_UPLINK_DROP,         // no pool buffer free for an uplink frame or event window
+    METRIC_ADC_SKIPPED,         // sample overwritten in the ring before the detector read it
+    METRIC_COUNT,
+};
+
+// log2 histograms: bucket 0 counts values below 2^shift, bucket i values below
+// 2^(shift + i), the last bucket everything above
+enum metric_hist_id {
+    METRIC_HIST_SEM_WAIT_US = 0,    // ADC data ready -> STA/LTA thread running
+    METRIC_HIST_TX_MS,              // lorawan_send duration
+    METRIC_HIST_COUNT,
+};
+
+//  ========== prototypes ==================================================================
+void app_metrics_inc(enum metric_id id);
+void app_metrics_add(enum metric_id id, uint32_t n);
+void app_metrics_hist(enum metric_hist_id id, uint32_t value);
+void app_metrics_reset(void);
+size_t app_metrics_encode(uint8_t *buf, size_t size);
+int8_t app_metrics_send_health(void);
+
+#endif /* APP_METRICS_H */
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_power.h"
+#include "app_adc.h"
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_power, CONFIG_APP_POWER_LOG_LEVEL);
+
+//  ========== globals =====================================================================
+// battery voltage (mV) to state of charge (%), linear between points; sampled from the
+// former ((v - 2270) / 710) ^ 1.2 curve so the reported levels do not change
+static const struct {
+    int16_t mv;
+    uint8_t soc;
+} soc_lut[] = {
+    { 2270,   0 }, { 2358,   8 }, { 2447,  19 }, { 2536,  31 }, { 2625,  44 },
+    { 2713,  57 }, { 2802,  71 }, { 2891,  85 }, { 2980, 100 },
+};
+
+// tiers in order of decreasing state of charge
+static const struct power_tier tiers[POWER_TIER_COUNT] = {
+    [POWER_TIER_NORMAL]   = { "normal",   40, SAMPLING_RATE_MS,     0,                   true  },
+    [POWER_TIER_SAVING]   = { "saving",   20, SAMPLING_RATE_MS,     15 * 60 * 1000,      true  },
+    [POWER_TIER_LOW]      = { "low",      10, 2 * SAMPLING_RATE_MS, 60 * 60 * 1000,      false },
+    [POWER_TIER_CRITICAL] = { "critical",  0, 5 * SAMPLING_RATE_MS, 6 * 60 * 60 * 1000,  false },
+};
+
+static struct app_job *telemetry_job;
+static uint32_t telemetry_nominal_ms;
+
+// filtered battery voltage (mV << 4), 0 until the first sample
+static int32_t vbat_q4 = 0;
+static uint8_t skipped = 0;
+static atomic_t soc = ATOMIC_INIT(0);
+static atomic_t tier = ATOMIC_INIT(POWER_TIER_NORMAL);
+
+// radio load tracking: samples taken under load or while the battery relaxes are biased low
+static atomic_t load_count = ATOMIC_INIT(0);
+static int64_t load_end_ms = 0;
+
+//  ========== soc_from_mv =================================================================
+static int16_t soc_from_mv(int32_t mv)
+{
+    if (mv <= soc_lut[0].mv) {
+        return 0;
+    }
+
+    for (size_t i = 1; i < ARRAY_SIZE(soc_lut); i++) {
+        if (mv < soc_lut[i].mv) {
+            int32_t dv = soc_lut[i].mv - soc_lut[i - 1].mv;
+            int32_t ds = soc_lut[i].soc - soc_lut[i - 1].soc;
+            return soc_lut[i - 1].soc + (mv - soc_lut[i - 1].mv) * ds / dv;
+        }
+    }
+    return 100;
+}
+
+//  ========== power_apply =================================================================
+// push the settings of a tier to the modules that own them
+static void power_apply(enum power_tier_id id)
+{
+    const struct power_tier *t = &tiers[id];
+    uint32_t period = t->telemetry_period_ms ? t->telemetry_period_ms : telemetry_nominal_ms;
+
+    LOG_INF("power tier %s (soc %d%%)", t->name, (int)atomic_get(&soc));
+    app_adc_set_sampling_rate(t->sampling_rate_ms);
+    if (telemetry_job) {
+        app_sched_set_period(telemetry_job, period);
+    }
+}
+
+//  ========== power_select ================================================================
+// tier for a state of charge: step down as soon as a threshold is crossed, step back up
+// only with POWER_HYSTERESIS margin so a recovering battery does not oscillate
+static enum power_tier_id power_select(enum power_tier_id cur, int16_t level)
+{
+    while (cur < POWER_TIER_CRITICAL && level < tiers[cur].min_soc) {
+        cur++;
+    }
+    while (cur > POWER_TIER_NORMAL && level >= tiers[cur - 1].min_soc + POWER_HYSTERESIS) {
+        cur--;
+    }
+    return cur;
+}
+
+//  ========== app_power_init ==============================================================
+// telemetry is the job whose period follows the tier, its current period is the nominal one
+void app_power_init(struct app_job *telemetry)
+{
+    telemetry_job = telemetry;
+    telemetry_nominal_ms = telemetry ? telemetry->period_ms : 0;
+}
+
+//  ========== app_power_update ============================================================
+// measure the battery, update the filtered state of charge and the operating tier
+int8_t app_power_update(void)
+{
+    int16_t mv = app_nrf52_get_ain1();
+    if (mv < 0) {
+        return mv;
+    }
+
+    // skip samples taken under radio load, unless the load never seems to end
+    bool loaded = atomic_get(&load_count) > 0 || k_uptime_get() < load_end_ms;
+    if (vbat_q4 != 0 && loaded && skipped < POWER_MAX_SKIPPED) {
+        skipped++;
+        return 0;
+    }
+    skipped = 0;
+
+    if (vbat_q4 == 0) {
+        vbat_q4 = (int32_t)mv << 4;
+    } else {
+        vbat_q4 += (((int32_t)mv << 4) - vbat_q4) >> POWER_FILTER_SHIFT;
+    }
+
+    int16_t level = soc_from_mv(vbat_q4 >> 4);
+    atomic_set(&soc, level);
+
+    enum power_tier_id cur = (enum power_tier_id)atomic_get(&tier);
+    enum power_tier_id next = power_select(cur, level);
+    if (next != cur) {
+        atomic_set(&tier, next);
+        power_apply(next);
+    }
+    return 0;
+}
+
+//  ========== getters =====================================================================
+int16_t app_power_get_soc(void)
+{
+    return (int16_t)atomic_get(&soc);
+}
+
+int16_t app_power_get_mv(void)
+{
+    return (int16_t)(vbat_q4 >> 4);
+}
+
+enum power_tier_id app_power_get_tier(void)
+{
+    return (enum power_tier_id)atomic_get(&tier);
+}
+
+bool app_power_waveforms_enabled(void)
+{
+    return tiers[app_power_get_tier()].waveforms;
+}
+
+//  ========== app_power_load_begin and end ================================================
+// bracket a radio transmission so the battery model ignores the voltage sag it causes
+void app_power_load_begin(void)
+{
+    atomic_inc(&load_count);
+}
+
+void app_power_load_end(void)
+{
+    load_end_ms = k_uptime_get() + POWER_RECOVERY_MS;
+    atomic_dec(&load_count);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_POWER_H
+#define APP_POWER_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_sched.h"
+
+//  ========== defines =====================================================================
+#define POWER_FILTER_SHIFT      3       // battery EMA weight 1/8 per accepted sample
+#define POWER_RECOVERY_MS       2000    // battery relaxation time after a radio transmission
+#define POWER_MAX_SKIPPED       5       // accept a sample anyway after this many under load
+#define POWER_HYSTERESIS        5       // % above a tier threshold before stepping back up
+
+//  ========== globals =====================================================================
+// operating tier, from full duty down to survival: selected from the state of charge
+enum power_tier_id {
+    POWER_TIER_NORMAL = 0,
+    POWER_TIER_SAVING,
+    POWER_TIER_LOW,
+    POWER_TIER_CRITICAL,
+    POWER_TIER_COUNT,
+};
+
+struct power_tier {
+    const char *name;
+    uint8_t min_soc;                // % state of charge to stay in this tier
+    uint32_t sampling_rate_ms;      // geophone ADC sampling interval
+    uint32_t telemetry_period_ms;   // 0 -> nominal telemetry period
+    bool waveforms;                 // waveform uplinks on detections
+};
+
+//  ========== prototypes ==================================================================
+void app_power_init(struct app_job *telemetry);
+int8_t app_power_update(void);
+int16_t app_power_get_soc(void);
+int16_t app_power_get_mv(void);
+enum power_tier_id app_power_get_tier(void);
+bool app_power_waveforms_enabled(void);
+void app_power_load_begin(void);
+void app_power_load_end(void);
+
+#endif /* APP_POWER_H */
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_psd.h"
+#include "app_adc.h"
+#include "app_sta_lta.h"
+#include "app_buf.h"
+#include "app_lorawan.h"
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+#include <arm_math.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(app_psd, CONFIG_APP_PSD_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define PSD_STACK_SIZE          1024
+#define PSD_PRIORITY            K_LOWEST_APPLICATION_THREAD_PRIO   // idle slots only
+#define PSD_POLL_SAMPLES        (PSD_HOP / 2)   // a poll never finds more than a hop
+
+// band b holds the bins [PSD_SEGMENT >> (b + 2), PSD_SEGMENT >> (b + 1)), one octave
+#define BAND_LO(b)              (PSD_SEGMENT >> ((b) + 2))
+#define BAND_HI(b)              (PSD_SEGMENT >> ((b) + 1))
+
+BUILD_ASSERT(BAND_LO(PSD_BANDS - 1) >= 2, "the lowest band must stay clear of the DC bin");
+BUILD_ASSERT(PSD_HOP <= ADC_BUFFER_SIZE, "a hop must fit in the ADC ring");
+BUILD_ASSERT(PSD_BANDS == 6, "the noise frame carries six bands");
+
+//  ========== globals =====================================================================
+K_THREAD_STACK_DEFINE(psd_stack, PSD_STACK_SIZE);
+struct k_thread psd_thread_data;
+
+// FFT tables and Hann window, read-only once set up, shared with the classifier
+static arm_rfft_fast_instance_f32 rfft;
+static float32_t window[PSD_SEGMENT];
+static bool psd_ready = false;
+
+// per segment the samples, the spectrum and the bin powers
+static float32_t work[2 * PSD_SEGMENT];
+
+// Z samples not yet used: a segment fills up to PSD_SEGMENT, its second half starts the
+// next one
+static uint16_t samples[PSD_SEGMENT];
+static uint16_t chunk[PSD_HOP];
+static size_t fill = 0;
+
+// sum over the segments of the mean |X|^2 of each band, since the last report
+static float32_t band_sum[PSD_BANDS];
+static uint32_t segments = 0;
+static uint32_t period_ms = SAMPLING_RATE_MS;
+K_MUTEX_DEFINE(psd_lock);
+
+//  ========== app_psd_bands ===============================================================
+// mean |X|^2 of each band of one segment of PSD_SEGMENT samples: mean removal, Hann window,
+// real FFT; work holds 2 * PSD_SEGMENT floats, each calling thread brings its own
+void app_psd_bands(const uint16_t *x, float *work, float band[PSD_BANDS])
+{
+    float32_t *segment = work, *spectrum = work + PSD_SEGMENT;
+    float32_t mean;
+
+    if (!psd_ready) {
+        memset(band, 0, PSD_BANDS * sizeof(band[0]));
+        return;
+    }
+
+    for (size_t i = 0; i < PSD_SEGMENT; i++) {
+        segment[i] = (float32_t)x[i];
+    }
+    arm_mean_f32(segment, PSD_SEGMENT, &mean);
+    arm_offset_f32(segment, -mean, segment, PSD_SEGMENT);
+    arm_mult_f32(segment, window, segment, PSD_SEGMENT);
+
+    // packed output: DC and Nyquist in spectrum[0] and [1], then bins 1..N/2 - 1 as re, im
+    arm_rfft_fast_f32(&rfft, segment, spectrum, 0);
+    arm_cmplx_mag_squared_f32(&spectrum[2], segment, PSD_SEGMENT / 2 - 1);
+
+    for (int b = 0; b < PSD_BANDS; b++) {
+        float32_t sum = 0.0f;
+        for (int k = BAND_LO(b); k < BAND_HI(b); k++) {
+            sum += segment[k - 1];
+        }
+        band[b] = sum / (BAND_HI(b) - BAND_LO(b));
+    }
+}
+
+//  ========== psd_segment =================================================================
+// one Welch segment, added to the running sums
+static void psd_segment(void)
+{
+    float band[PSD_BANDS];
+
+    app_psd_bands(samples, work, band);
+
+    k_mutex_lock(&psd_lock, K_FOREVER);
+    for (int b = 0; b < PSD_BANDS; b++) {
+        band_sum[b] += band[b];
+    }
+    segments++;
+    k_mutex_unlock(&psd_lock);
+}
+
+//  ========== psd_restart =================================================================
+// drop the average, on a report or when the sampling rate changes
+// must be called with psd_lock held
+static void psd_restart(void)
+{
+    memset(band_sum, 0, sizeof(band_sum));
+    segments = 0;
+}
+
+//  ========== app_psd_thread ==============================================================
+// runs below every other application thread: a segment is computed when nothing else has
+// work, at most one per poll, and a poll starved long enough to lose samples starts the
+// segment over
+static void app_psd_thread(void *arg1, void *arg2, void *arg3)
+{
+    uint32_t cursor = app_adc_sample_count();
+
+    while (1) {
+        uint32_t rate_ms = app_adc_get_sampling_rate();
+        k_sleep(K_MSEC(PSD_POLL_SAMPLES * rate_ms));
+
+        // the bands move with the sampling rate, segments of two rates are not averaged
+        if (rate_ms != period_ms) {
+            k_mutex_lock(&psd_lock, K_FOREVER);
+            psd_restart();
+            period_ms = rate_ms;
+            k_mutex_unlock(&psd_lock);
+            fill = 0;
+        }
+
+        uint32_t before = cursor;
+        size_t n = app_adc_get_new(chunk, ARRAY_SIZE(chunk), &cursor);
+        if (cursor - before > n) {
+            fill = 0;
+        }
+
+        for (size_t i = 0; i < n; ) {
+            size_t k = MIN(n - i, PSD_SEGMENT - fill);
+            memcpy(&samples[fill], &chunk[i], k * sizeof(uint16_t));
+            fill += k;
+            i += k;
+
+            if (fill == PSD_SEGMENT) {
+                // background noise only, segments ending during an event are left out
+                if (!app_sta_lta_triggered()) {
+                    psd_segment();
+                }
+                memmove(samples, &samples[PSD_HOP], (PSD_SEGMENT - PSD_HOP) * sizeof(uint16_t));
+                fill = PSD_SEGMENT - PSD_HOP;
+            }
+        }
+    }
+}
+
+//  ========== app_psd_start ===============================================================
+void app_psd_start(void)
+{
+    // periodic Hann window, sum of squares 3N/8
+    for (size_t i = 0; i < PSD_SEGMENT; i++) {
+        window[i] = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * i / PSD_SEGMENT);
+    }
+    if (arm_rfft_fast_init_f32(&rfft, PSD_SEGMENT) != ARM_MATH_SUCCESS) {
+        LOG_ERR("failed to initialize the %u-point FFT", PSD_SEGMENT);
+        return;
+    }
+    psd_ready = true;
+
+    k_thread_create(&psd_thread_data, psd_stack, K_THREAD_STACK_SIZEOF(psd_stack),
+                    app_psd_thread, NULL, NULL, NULL, PSD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&psd_thread_data, "psd");
+}
+
+//  ========== app_psd_report ==============================================================
+// band levels of the segments averaged since the last restart, one-sided PSD
+// 2 |X|^2 / (fs sum(w^2)) in counts^2/Hz; restart starts a new average
+void app_psd_report(struct psd_report *report, bool restart)
+{
+    k_mutex_lock(&psd_lock, K_FOREVER);
+    report->period_ms = (uint16_t)period_ms;
+    report->segments = segments;
+
+    float32_t fs = 1000.0f / period_ms;
+    float32_t scale = 2.0f / (fs * (3.0f * PSD_SEGMENT / 8.0f));
+    for (int b = 0; b < PSD_BANDS; b++) {
+        float32_t psd = segments ? band_sum[b] / segments * scale : 0.0f;
+        report->level[b] = psd > 0.0f ? (int16_t)lroundf(100.0f * log10f(psd))
+                                      : PSD_LEVEL_NONE;
+    }
+    if (restart) {
+        psd_restart();
+    }
+    k_mutex_unlock(&psd_lock);
+}
+
+//  ========== app_psd_send ================================================================
+// queue the noise frame of the average since the last one, then start a new average
+int8_t app_psd_send(void)
+{
+    struct psd_report r;
+
+    struct net_buf *buf = app_buf_uplink_alloc(K_NO_WAIT);
+    if (!buf) {
+        LOG_WRN("noise uplink dropped, no free buffer");
+        return -ENOMEM;
+    }
+
+    app_psd_report(&r, true);
+    struct uplink_noise frame = {
+        .period = r.period_ms,
+        .segments = (uint16_t)MIN(r.segments, UINT16_MAX),
+        .band0 = r.level[0],
+        .band1 = r.level[1],
+        .band2 = r.level[2],
+        .band3 = r.level[3],
+        .band4 = r.level[4],
+        .band5 = r.level[5],
+    };
+
+    int len = uplink_noise_encode(&frame, net_buf_tail(buf), net_buf_tailroom(buf));
+    if (len < 0) {
+        net_buf_unref(buf);
+        return len;
+    }
+    net_buf_add(buf, len);
+    app_lorawan_queue(buf, LORAWAN_NOISE_PORT);
+    return 0;
+}
+
+//  ========== shell commands ==============================================================
+static int cmd_psd_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct psd_report r;
+
+    app_psd_report(&r, false);
+    shell_print(sh, "%u segments at %u ms", r.segments, r.period_ms);
+    for (int b = 0; b < PSD_BANDS; b++) {
+        // band edges in mHz
+        uint32_t lo = BAND_LO(b) * 1000000u / (PSD_SEGMENT * r.period_ms);
+        uint32_t hi = BAND_HI(b) * 1000000u / (PSD_SEGMENT * r.period_ms);
+        int level = r.level[b];
+        shell_print(sh, "%3u.%01u - %3u.%01u Hz: %s%d.%d dB", lo / 1000, lo % 1000 / 100,
+                    hi / 1000, hi % 1000 / 100, level < 0 ? "-" : "", abs(level) / 10,
+                    abs(level) % 10);
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(psd_cmds,
+    SHELL_CMD(show, NULL, "Print the noise band levels averaged since the last report",
+              cmd_psd_show),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(psd, &psd_cmds, "Background noise spectrum", NULL);
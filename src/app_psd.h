@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_PSD_H
+#define APP_PSD_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//  ========== defines =====================================================================
+// Welch estimate of the background noise of the Z component: Hann-windowed segments with
+// 50 % overlap, averaged between two reports and reduced to octave bands below fs/2
+#define PSD_SEGMENT             256     // samples per FFT segment, 2.56 s at 100 Hz
+#define PSD_HOP                 (PSD_SEGMENT / 2)
+#define PSD_BANDS               6       // fs/4..fs/2 down to fs/128..fs/64
+#define PSD_LEVEL_NONE          (-400)  // dB x10, reported when no segment was averaged
+
+//  ========== globals =====================================================================
+// band levels in dB x10 re 1 count^2/Hz, band 0 the highest octave
+struct psd_report {
+    uint16_t period_ms;         // sampling period of the averaged segments
+    uint32_t segments;
+    int16_t level[PSD_BANDS];
+};
+
+//  ========== prototypes ==================================================================
+void app_psd_start(void);
+void app_psd_bands(const uint16_t *x, float *work, float band[PSD_BANDS]);
+void app_psd_report(struct psd_report *report, bool restart);
+int8_t app_psd_send(void);
+
+#endif /* APP_PSD_H */
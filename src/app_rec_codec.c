@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_rec_codec.h"
+#include <errno.h>
+#include <string.h>
+
+//  ========== defines =====================================================================
+// each delta is zigzag mapped to u >= 0 and written as q = u >> k ones, a zero and the k
+// low bits of u; q >= RICE_ESCAPE is written as RICE_ESCAPE ones and u on 16 bits.
+// k follows the running mean of u, so quiet signal costs 2 to 4 bits per sample
+#define RICE_ESCAPE             16
+#define RICE_AVG_SHIFT          4           // mean over ~16 samples
+#define RICE_AVG_INIT           (4 << RICE_AVG_SHIFT)
+
+//  ========== rice helpers ================================================================
+static void rice_init(struct rec_rice *r, uint16_t first)
+{
+    r->avg = RICE_AVG_INIT;
+    r->prev = first;
+}
+
+static uint8_t rice_k(const struct rec_rice *r)
+{
+    uint32_t mean = r->avg >> RICE_AVG_SHIFT;
+    uint8_t k = 0;
+
+    while (k < 15 && (1u << k) <= mean) {
+        k++;
+    }
+    return k;
+}
+
+// deltas are taken modulo 2^16, so that u always fits the 16-bit escape: samples near 0 V
+// read as 0xFFFx, a step across the wrap is a small delta
+static uint32_t zigzag(uint16_t sample, uint16_t prev)
+{
+    int16_t d = (int16_t)(uint16_t)(sample - prev);
+    return d >= 0 ? (uint32_t)d << 1 : ((uint32_t)(-(int32_t)d) << 1) - 1;
+}
+
+static uint16_t unzigzag(uint32_t u, uint16_t prev)
+{
+    int16_t d = (u & 1) ? (int16_t)-(int32_t)((u + 1) >> 1) : (int16_t)(u >> 1);
+    return (uint16_t)(prev + d);
+}
+
+static void rice_update(struct rec_rice *r, uint32_t u, uint16_t sample)
+{
+    r->avg += u - (r->avg >> RICE_AVG_SHIFT);
+    r->prev = sample;
+}
+
+//  ========== rec_encoder_start ===========================================================
+// open a new block in the caller buffer (REC_BLOCK_SIZE bytes, 4-byte aligned)
+void rec_encoder_start(struct rec_encoder *enc, uint8_t *block, uint32_t seq, uint64_t t0_ms,
+                       uint16_t period_ms, uint16_t first)
+{
+    struct rec_block_hdr *hdr = (struct rec_block_hdr *)block;
+
+    memset(block, 0xFF, REC_BLOCK_SIZE);
+    hdr->magic = REC_BLOCK_MAGIC;
+    hdr->version = REC_BLOCK_VERSION;
+    hdr->reserved = 0;
+    hdr->seq = seq;
+    hdr->t0_s = (uint32_t)(t0_ms / 1000);
+    hdr->span_ms = 0;
+    hdr->t0_ms = (uint16_t)(t0_ms % 1000);
+    hdr->period_ms = period_ms;
+    hdr->count = 1;
+    hdr->first = first;
+    hdr->bits = 0;
+    hdr->crc = 0;
+
+    enc->block = block;
+    rice_init(&enc->rice, first);
+    bw_init(&enc->bw, block + REC_HDR_SIZE, REC_PAYLOAD_BITS);
+}
+
+//  ========== rec_encoder_append ==========================================================
+// append one sample, -ENOSPC when the block is full: nothing is written and the caller
+// starts a new block with this sample
+int rec_encoder_append(struct rec_encoder *enc, uint16_t sample)
+{
+    struct rec_block_hdr *hdr = (struct rec_block_hdr *)enc->block;
+    uint32_t u = zigzag(sample, enc->rice.prev);
+    uint8_t k = rice_k(&enc->rice);
+    uint32_t q = u >> k;
+    uint32_t need = q < RICE_ESCAPE ? q + 1 + k : RICE_ESCAPE + 16;
+
+    if (hdr->count == UINT16_MAX || enc->bw.pos + need > enc->bw.cap) {
+        return -ENOSPC;
+    }
+
+    if (q < RICE_ESCAPE) {
+        // at most 15 ones and the stop bit
+        bw_put(&enc->bw, ((1u << q) - 1) << 1, q + 1);
+        if (k > 0) {
+            bw_put(&enc->bw, u & ((1u << k) - 1), k);
+        }
+    } else {
+        bw_put(&enc->bw, (1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+        bw_put(&enc->bw, u, 16);
+    }
+
+    rice_update(&enc->rice, u, sample);
+    hdr->count++;
+    return 0;
+}
+
+//  ========== rec_encoder_finish ==========================================================
+// seal the block: time span, payload length and CRC, the block is then ready to be
+// programmed; span_ms is the measured time from the first to the last sample, it absorbs
+// the drift of the actual sampling interval from the nominal one
+void rec_encoder_finish(struct rec_encoder *enc, uint32_t span_ms)
+{
+    struct rec_block_hdr *hdr = (struct rec_block_hdr *)enc->block;
+
+    hdr->span_ms = span_ms;
+    hdr->bits = (uint16_t)enc->bw.pos;
+    hdr->crc = 0;
+    hdr->crc = tlm_crc16(0xFFFF, enc->block, REC_HDR_SIZE + (enc->bw.pos + 7) / 8);
+}
+
+//  ========== rec_encoder_count ===========================================================
+uint16_t rec_encoder_count(const struct rec_encoder *enc)
+{
+    return ((const struct rec_block_hdr *)enc->block)->count;
+}
+
+//  ========== rec_block_check =============================================================
+// validate a sealed block, returns 0 if magic, version, size and CRC are consistent
+int rec_block_check(const uint8_t *block)
+{
+    struct rec_block_hdr hdr;
+    uint8_t head[REC_HDR_SIZE];
+
+    memcpy(&hdr, block, sizeof(hdr));
+    if (hdr.magic != REC_BLOCK_MAGIC || hdr.version != REC_BLOCK_VERSION) {
+        return -ENOENT;
+    }
+    if (hdr.count == 0 || hdr.bits > REC_PAYLOAD_BITS || hdr.period_ms == 0) {
+        return -EINVAL;
+    }
+
+    memcpy(head, block, REC_HDR_SIZE);
+    ((struct rec_block_hdr *)head)->crc = 0;
+    uint16_t crc = tlm_crc16(0xFFFF, head, REC_HDR_SIZE);
+    crc = tlm_crc16(crc, block + REC_HDR_SIZE, (hdr.bits + 7) / 8);
+    return crc == hdr.crc ? 0 : -EBADMSG;
+}
+
+//  ========== rec_block_t0_ms =============================================================
+uint64_t rec_block_t0_ms(const struct rec_block_hdr *hdr)
+{
+    return (uint64_t)hdr->t0_s * 1000 + hdr->t0_ms;
+}
+
+//  ========== rec_block_sample_ms =========================================================
+// epoch time (ms) of sample index, spread over the measured span when it is known
+uint64_t rec_block_sample_ms(const struct rec_block_hdr *hdr, uint32_t index)
+{
+    if (hdr->span_ms > 0 && hdr->count > 1) {
+        return rec_block_t0_ms(hdr) + (uint64_t)index * hdr->span_ms / (hdr->count - 1);
+    }
+    return rec_block_t0_ms(hdr) + (uint64_t)index * hdr->period_ms;
+}
+
+//  ========== rec_block_index_at ==========================================================
+// index of the first sample at or after t_ms, count if there is none in the block
+uint32_t rec_block_index_at(const struct rec_block_hdr *hdr, uint64_t t_ms)
+{
+    uint64_t t0 = rec_block_t0_ms(hdr);
+    uint64_t i;
+
+    if (t_ms <= t0) {
+        return 0;
+    }
+    if (hdr->span_ms > 0 && hdr->count > 1) {
+        i = ((t_ms - t0) * (hdr->count - 1) + hdr->span_ms - 1) / hdr->span_ms;
+    } else {
+        i = (t_ms - t0 + hdr->period_ms - 1) / hdr->period_ms;
+    }
+    return i < hdr->count ? (uint32_t)i : hdr->count;
+}
+
+//  ========== rec_block_decode ============================================================
+// decode the samples of a checked block from index skip on, at most max of them;
+// returns the number of samples written to out or an error
+int rec_block_decode(const uint8_t *block, size_t skip, uint16_t *out, size_t max)
+{
+    struct rec_block_hdr hdr;
+    struct bit_reader br;
+    struct rec_rice rice;
+    size_t n = 0;
+
+    memcpy(&hdr, block, sizeof(hdr));
+    rice_init(&rice, hdr.first);
+    br_init(&br, block + REC_HDR_SIZE, hdr.bits);
+
+    if (skip == 0 && max > 0) {
+        out[n++] = hdr.first;
+    }
+
+    for (size_t i = 1; i < hdr.count && n < max; i++) {
+        uint8_t k = rice_k(&rice);
+        uint32_t q = 0, bit, low = 0, u;
+        int ret;
+
+        // unary part, up to the escape
+        while (q < RICE_ESCAPE) {
+            if ((ret = br_get(&br, 1, &bit)) < 0) {
+                return ret;
+            }
+            if (bit == 0) {
+                break;
+            }
+            q++;
+        }
+        if (q == RICE_ESCAPE) {
+            if ((ret = br_get(&br, 16, &u)) < 0) {
+                return ret;
+            }
+        } else {
+            if (k > 0 && (ret = br_get(&br, k, &low)) < 0) {
+                return ret;
+            }
+            u = (q << k) | low;
+        }
+
+        uint16_t sample = unzigzag(u, rice.prev);
+        rice_update(&rice, u, sample);
+        if (i >= skip) {
+            out[n++] = sample;
+        }
+    }
+    return (int)n;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_REC_CODEC_H
+#define APP_REC_CODEC_H
+
+// raw ADC blocks of the QSPI recorder (app_recorder.c); plain C like app_tlm_codec.h
+
+//  ========== includes ====================================================================
+#include "app_tlm_codec.h"
+
+//  ========== defines =====================================================================
+#define REC_BLOCK_SIZE          256         // one QSPI NOR program page
+#define REC_BLOCK_MAGIC         0x5EC0
+#define REC_BLOCK_VERSION       1
+#define REC_HDR_SIZE            sizeof(struct rec_block_hdr)
+#define REC_PAYLOAD_BITS        ((REC_BLOCK_SIZE - REC_HDR_SIZE) * 8)
+
+//  ========== globals =====================================================================
+// block header: consecutive samples at a fixed interval, the first one stored in full and
+// the following ones as Rice coded deltas; a block decodes on its own
+struct rec_block_hdr {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  reserved;
+    uint32_t seq;           // block sequence number, monotonic across the ring
+    uint32_t t0_s;          // epoch time of the first sample
+    uint32_t span_ms;       // first to last sample, measured; 0 if unknown
+    uint16_t t0_ms;
+    uint16_t period_ms;     // nominal sampling interval
+    uint16_t count;         // number of samples, first one included
+    uint16_t first;
+    uint16_t bits;          // number of payload bits used by the deltas
+    uint16_t crc;           // CRC-16/CCITT over header (crc = 0) and used payload
+};
+
+// adaptive Rice parameter: running mean of the coded values, same update on both sides
+struct rec_rice {
+    uint32_t avg;           // mean of the zigzag deltas x16
+    uint16_t prev;
+};
+
+// block encoder state, the block itself lives in a caller-supplied buffer
+struct rec_encoder {
+    uint8_t *block;
+    struct bit_writer bw;
+    struct rec_rice rice;
+};
+
+//  ========== prototypes ==================================================================
+void rec_encoder_start(struct rec_encoder *enc, uint8_t *block, uint32_t seq, uint64_t t0_ms,
+                       uint16_t period_ms, uint16_t first);
+int rec_encoder_append(struct rec_encoder *enc, uint16_t sample);
+void rec_encoder_finish(struct rec_encoder *enc, uint32_t span_ms);
+uint16_t rec_encoder_count(const struct rec_encoder *enc);
+
+int rec_block_check(const uint8_t *block);
+uint64_t rec_block_t0_ms(const struct rec_block_hdr *hdr);
+uint64_t rec_block_sample_ms(const struct rec_block_hdr *hdr, uint32_t index);
+uint32_t rec_block_index_at(const struct rec_block_hdr *hdr, uint64_t t_ms);
+int rec_block_decode(const uint8_t *block, size_t skip, uint16_t *out, size_t max);
+
+#endif /* APP_REC_CODEC_H */
@@ -0,0 +1,477 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_recorder.h"
+#include "app_adc.h"
+#include "app_buf.h"
+#include "app_ds3231.h"
+#include "app_lorawan.h"
+#include "app_log.h"
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(app_recorder, CONFIG_APP_RECORDER_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define REC_STACK_SIZE          1024
+#define REC_PRIORITY            10      // after the ADC, detector and TX threads
+#define REC_POLL_MS             500     // well within the ~10 s held by the ADC ring
+#define REC_CHUNK               128     // samples copied out of the ADC ring per call
+
+#define FETCH_STACK_SIZE        1024
+#define FETCH_PRIORITY          11
+#define FETCH_ALLOC_TIMEOUT     K_SECONDS(60)
+#define FETCH_SENT_TIMEOUT      K_HOURS(1)  // one window through the duty cycle
+
+BUILD_ASSERT(REC_REGION_SIZE % SPI_FLASH_SECTOR_SIZE == 0, "ring must hold whole sectors");
+BUILD_ASSERT(REC_POLL_MS * 2 < ADC_BUFFER_SIZE * SAMPLING_RATE_MS,
+             "the ADC ring must not wrap between two polls");
+
+//  ========== globals =====================================================================
+K_THREAD_STACK_DEFINE(rec_stack, REC_STACK_SIZE);
+struct k_thread rec_thread_data;
+K_THREAD_STACK_DEFINE(fetch_stack, FETCH_STACK_SIZE);
+struct k_thread fetch_thread_data;
+
+static const struct device *rec_dev;
+
+// block being filled in RAM, programmed once full, on a discontinuity or on a fetch
+static uint8_t rec_buf[REC_BLOCK_SIZE] __aligned(4);
+static struct rec_encoder encoder;
+static bool block_open = false;
+static uint64_t block_t0_ms;
+static uint64_t block_last_ms;      // time of the newest sample in the block
+
+// ring position of the next block to program and its sequence number
+static uint32_t next_block = 0;
+static uint32_t next_seq = 0;
+
+// serializes the open block and the ring position between recorder and fetch
+K_MUTEX_DEFINE(rec_lock);
+
+// one fetch at a time: a new request while one is running is refused
+struct fetch_req {
+    uint64_t t0_ms;
+    uint64_t t1_ms;
+};
+K_MSGQ_DEFINE(fetch_msgq, sizeof(struct fetch_req), 1, 4);
+K_SEM_DEFINE(fetch_sent, 0, 1);
+
+// blocks are streamed out of the ring with read-ahead: the next block is read while the
+// current one is decoded, fetch_buf holds both
+static struct eeprom_reader fetch_rd;
+static uint8_t fetch_buf[2 * REC_BLOCK_SIZE] __aligned(4);
+
+//  ========== ring helpers ================================================================
+static off_t block_offset(uint32_t index)
+{
+    return REC_REGION_OFFSET + (off_t)index * REC_BLOCK_SIZE;
+}
+
+// header of a programmed block, magic and version only (no CRC), -ENOENT if blank
+static int read_hdr(uint32_t index, struct rec_block_hdr *hdr)
+{
+    int ret = app_eeprom_read(rec_dev, block_offset(index), hdr, sizeof(*hdr));
+    if (ret < 0) {
+        return ret;
+    }
+    if (hdr->magic != REC_BLOCK_MAGIC || hdr->version != REC_BLOCK_VERSION) {
+        return -ENOENT;
+    }
+    return 0;
+}
+
+//  ========== app_recorder_init ===========================================================
+// find the newest block: sectors are erased and filled in order, so the first block of
+// each sector locates the newest sector, then a scan of that sector the newest block
+int8_t app_recorder_init(const struct device *dev)
+{
+    struct rec_block_hdr hdr;
+    bool found = false;
+    uint32_t newest_seq = 0;
+    uint32_t newest = 0;
+
+    rec_dev = dev;
+    for (uint32_t s = 0; s < REC_SECTOR_COUNT; s++) {
+        if (read_hdr(s * REC_BLOCKS_PER_SECTOR, &hdr) < 0) {
+            continue;
+        }
+        if (!found || (int32_t)(hdr.seq - newest_seq) > 0) {
+            found = true;
+            newest_seq = hdr.seq;
+            newest = s * REC_BLOCKS_PER_SECTOR;
+        }
+    }
+
+    if (!found) {
+        LOG_INF("recorder: empty ring, %u blocks", REC_BLOCK_COUNT);
+        next_block = 0;
+        next_seq = 0;
+        return 1;
+    }
+
+    for (uint32_t i = newest + 1; i < newest + REC_BLOCKS_PER_SECTOR; i++) {
+        if (read_hdr(i, &hdr) < 0 || (int32_t)(hdr.seq - newest_seq) <= 0) {
+            break;
+        }
+        newest_seq = hdr.seq;
+        newest = i;
+    }
+    next_block = (newest + 1) % REC_BLOCK_COUNT;
+    next_seq = newest_seq + 1;
+    LOG_INF("recorder: resuming at block %u, seq %u", next_block, next_seq);
+    return 1;
+}
+
+//  ========== rec_program_block ===========================================================
+// seal the open block and program it at the next ring position, rec_lock held
+static int8_t rec_program_block(void)
+{
+    int8_t ret;
+
+    block_open = false;
+    rec_encoder_finish(&encoder, (uint32_t)(block_last_ms - block_t0_ms));
+
+    // a block in the middle of a sector must be blank (interrupted erase or foreign data
+    // otherwise): skip to the next sector
+    if ((next_block % REC_BLOCKS_PER_SECTOR) != 0) {
+        uint32_t word;
+        if (app_eeprom_read(rec_dev, block_offset(next_block), &word, sizeof(word)) < 0 ||
+            word != 0xFFFFFFFF) {
+            next_block = ROUND_UP(next_block, REC_BLOCKS_PER_SECTOR) % REC_BLOCK_COUNT;
+        }
+    }
+
+    // entering a sector: erase it, the oldest 4 KB of the record go
+    if ((next_block % REC_BLOCKS_PER_SECTOR) == 0) {
+        ret = app_eeprom_erase(rec_dev, block_offset(next_block), SPI_FLASH_SECTOR_SIZE);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    ret = app_eeprom_program(rec_dev, block_offset(next_block), rec_buf, REC_BLOCK_SIZE);
+    if (ret < 0) {
+        return ret;
+    }
+
+    LOG_DBG("block %u programmed (seq %u, %u samples)", next_block, next_seq,
+            rec_encoder_count(&encoder));
+    next_block = (next_block + 1) % REC_BLOCK_COUNT;
+    next_seq++;
+    return 0;
+}
+
+//  ========== app_recorder_flush ==========================================================
+// program the open block even if not full, so that a fetch sees the newest samples
+int8_t app_recorder_flush(void)
+{
+    int8_t ret = 0;
+
+    k_mutex_lock(&rec_lock, K_FOREVER);
+    if (block_open) {
+        ret = rec_program_block();
+    }
+    k_mutex_unlock(&rec_lock);
+    return ret;
+}
+
+//  ========== sample_epoch_ms =============================================================
+// wall-clock time of ADC sample number count (app_adc_get_new counting), from its hardware
+// timestamp, or from the current time and the nominal interval when it is not known
+static uint64_t sample_epoch_ms(uint32_t count, uint32_t cursor, uint32_t period_ms)
+{
+    int64_t ts_us = app_adc_sample_ts(count);
+    if (ts_us >= 0) {
+        return (uint64_t)(app_ds3231_uptime_us_to_epoch_us(ts_us) / 1000);
+    }
+    return app_ds3231_get_time() - (uint64_t)(cursor - count) * period_ms;
+}
+
+//  ========== app_recorder_thread =========================================================
+// copy the new ADC samples into the open block; a sampling rate change or samples lost
+// from the ADC ring close the block, since a block holds evenly spaced samples
+static void app_recorder_thread(void *arg1, void *arg2, void *arg3)
+{
+    uint16_t samples[REC_CHUNK];
+    uint32_t cursor = 0;
+
+    while (1) {
+        k_sleep(K_MSEC(REC_POLL_MS));
+
+        size_t n;
+        do {
+            uint32_t before = cursor;
+            n = app_adc_get_new(samples, ARRAY_SIZE(samples), &cursor);
+            if (n == 0) {
+                break;
+            }
+
+            uint32_t first = cursor - n;
+            uint32_t period = app_adc_get_sampling_rate();
+
+            k_mutex_lock(&rec_lock, K_FOREVER);
+            if (block_open && (first != before ||
+                               ((struct rec_block_hdr *)rec_buf)->period_ms != period)) {
+                if (first != before) {
+                    APP_LOG_RATELIMIT(LOG_WRN, 60000, "recorder: %u samples lost",
+                                      first - before);
+                }
+                (void)rec_program_block();
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                if (block_open && rec_encoder_append(&encoder, samples[i]) == 0) {
+                    continue;
+                }
+                if (block_open) {
+                    // full: the block ends on the previous sample
+                    block_last_ms = sample_epoch_ms(first + i - 1, cursor, period);
+                    (void)rec_program_block();
+                }
+                block_t0_ms = sample_epoch_ms(first + i, cursor, period);
+                rec_encoder_start(&encoder, rec_buf, next_seq, block_t0_ms, period, samples[i]);
+                block_open = true;
+            }
+            block_last_ms = sample_epoch_ms(cursor - 1, cursor, period);
+            k_mutex_unlock(&rec_lock);
+        } while (n == ARRAY_SIZE(samples));
+    }
+}
+
+//  ========== find_block ==================================================================
+// binary search of the ring for the newest block starting at or before t_ms; returns its
+// position after the oldest block (0 if the record starts after t_ms), -ENOENT if empty
+static int find_block(uint32_t oldest, uint32_t count, uint64_t t_ms)
+{
+    struct rec_block_hdr hdr;
+    uint32_t lo = 0, hi = count;    // answer in [lo, hi)
+
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t probe = mid;
+
+        // blank blocks (skipped after an interrupted erase): use the next valid one
+        while (probe < hi && read_hdr((oldest + probe) % REC_BLOCK_COUNT, &hdr) < 0) {
+            probe++;
+        }
+        if (probe == hi || rec_block_t0_ms(&hdr) > t_ms) {
+            hi = mid;
+        } else {
+            lo = probe;
+        }
+    }
+    return count > 0 ? (int)lo : -ENOENT;
+}
+
+//  ========== send_window =================================================================
+// queue a fetched window and wait until it is on air, so that a fetch holds one window
+// buffer at most and the detector always finds the other one
+static int send_window(struct net_buf *buf, size_t n)
+{
+    net_buf_add(buf, n * sizeof(uint16_t));
+    app_buf_meta(buf)->done = &fetch_sent;
+    k_sem_reset(&fetch_sent);
+    app_lorawan_queue_window(buf);
+
+    if (k_sem_take(&fetch_sent, FETCH_SENT_TIMEOUT) < 0) {
+        LOG_WRN("fetch: window not sent in time, stopping");
+        return -ETIMEDOUT;
+    }
+    return 0;
+}
+
+//  ========== fetch_blocks ===============================================================
+// send the recorded samples of [t0, t1) as event windows of up to ADC_BUFFER_SIZE samples,
+// a new window at each discontinuity of the record
+static int fetch_blocks(const struct fetch_req *req)
+{
+    const struct rec_block_hdr *hdr;
+    const uint8_t *block;
+    struct net_buf *buf = NULL;
+    uint16_t *samples = NULL;
+    size_t filled = 0;
+    uint64_t expect_ms = 0;
+    uint32_t windows = 0;
+    int ret = 0;
+
+    // the newest samples are still in RAM
+    (void)app_recorder_flush();
+
+    k_mutex_lock(&rec_lock, K_FOREVER);
+    uint32_t head = next_block;
+    k_mutex_unlock(&rec_lock);
+
+    // oldest block once the ring has wrapped: the head itself at a sector start (that
+    // sector is erased only by the next block), the start of the next sector otherwise
+    struct rec_block_hdr probe;
+    uint32_t oldest = ROUND_UP(head, REC_BLOCKS_PER_SECTOR) % REC_BLOCK_COUNT;
+    uint32_t count;
+    if (read_hdr(oldest, &probe) < 0) {
+        oldest = 0;
+        count = head;
+    } else {
+        count = (head + REC_BLOCK_COUNT - oldest) % REC_BLOCK_COUNT;
+        count = count ? count : REC_BLOCK_COUNT;
+    }
+
+    int pos = find_block(oldest, count, req->t0_ms);
+    if (pos < 0) {
+        LOG_WRN("fetch: nothing recorded");
+        return pos;
+    }
+
+    for (uint32_t l = pos; l < count; l++) {
+        uint32_t index = (oldest + l) % REC_BLOCK_COUNT;
+
+        // one stream up to the end of the ring region, another from its start on a wrap
+        if (l == pos || index == 0) {
+            uint32_t run = MIN(count - l, REC_BLOCK_COUNT - index);
+            app_eeprom_reader_init(&fetch_rd, rec_dev, block_offset(index),
+                                   run * REC_BLOCK_SIZE, fetch_buf, REC_BLOCK_SIZE, true);
+        }
+        ssize_t len = app_eeprom_reader_next(&fetch_rd, &block);
+        if (len < 0) {
+            ret = len;
+            break;
+        }
+        if (rec_block_check(block) < 0) {
+            continue;
+        }
+        hdr = (const struct rec_block_hdr *)block;
+        if (rec_block_t0_ms(hdr) >= req->t1_ms) {
+            break;
+        }
+
+        uint32_t i = rec_block_index_at(hdr, req->t0_ms);
+        uint32_t end = rec_block_index_at(hdr, req->t1_ms);
+
+        // the window goes on only if this block follows the previous one without a gap
+        if (buf && i < end) {
+            uint64_t t = rec_block_sample_ms(hdr, i);
+            uint64_t d = t > expect_ms ? t - expect_ms : expect_ms - t;
+            if (d > hdr->period_ms / 2) {
+                if ((ret = send_window(buf, filled)) < 0) {
+                    return ret;
+                }
+                buf = NULL;
+                windows++;
+            }
+        }
+
+        while (i < end) {
+            if (!buf) {
+                buf = app_buf_window_alloc(FETCH_ALLOC_TIMEOUT);
+                if (!buf) {
+                    return -ENOMEM;
+                }
+                uplink_put_be64(rec_block_sample_ms(hdr, i),
+                                net_buf_add(buf, UPLINK_WINDOW_TS_SIZE));
+                samples = net_buf_tail(buf);
+                filled = 0;
+            }
+
+            size_t take = MIN(end - i, ADC_BUFFER_SIZE - filled);
+            int n = rec_block_decode(block, i, samples + filled, take);
+            if (n <= 0) {
+                break;
+            }
+            filled += n;
+            i += n;
+            expect_ms = rec_block_sample_ms(hdr, i);
+
+            if (filled == ADC_BUFFER_SIZE) {
+                if ((ret = send_window(buf, filled)) < 0) {
+                    return ret;
+                }
+                buf = NULL;
+                windows++;
+            }
+        }
+    }
+
+    // on a read error the samples before it still go out
+    if (buf && filled > 0) {
+        int err = send_window(buf, filled);
+        if (err < 0) {
+            return err;
+        }
+        windows++;
+    } else if (buf) {
+        net_buf_unref(buf);
+    }
+    return ret < 0 ? ret : (int)windows;
+}
+
+//  ========== fetch ======================================================================
+static int fetch(const struct fetch_req *req)
+{
+    int ret = fetch_blocks(req);
+
+    // a fetch that stops early leaves a read-ahead in flight into fetch_buf
+    app_eeprom_reader_close(&fetch_rd);
+    return ret;
+}
+
+//  ========== app_fetch_thread ============================================================
+static void app_fetch_thread(void *arg1, void *arg2, void *arg3)
+{
+    struct fetch_req req;
+
+    while (1) {
+        k_msgq_get(&fetch_msgq, &req, K_FOREVER);
+        int ret = fetch(&req);
+        if (ret < 0) {
+            LOG_ERR("fetch failed: %d", ret);
+        } else {
+            LOG_INF("fetch: %d windows sent", ret);
+        }
+    }
+}
+
+//  ========== app_recorder_command ========================================================
+// downlink command (LORAWAN_COMMAND_PORT), called from the LoRaWAN stack: only queues
+int app_recorder_command(const uint8_t *data, uint8_t len)
+{
+    struct fetch_req req;
+
+    if (len < 1 || data[0] != REC_CMD_FETCH) {
+        return -ENOTSUP;
+    }
+    if (len < REC_CMD_FETCH_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    uint32_t t0 = sys_get_be32(data + 1);
+    uint16_t duration = sys_get_be16(data + 5);
+    if (duration == 0 || duration > REC_FETCH_MAX_S) {
+        LOG_WRN("fetch: duration %u s refused", duration);
+        return -EINVAL;
+    }
+
+    req.t0_ms = (uint64_t)t0 * 1000;
+    req.t1_ms = req.t0_ms + (uint64_t)duration * 1000;
+    if (k_msgq_put(&fetch_msgq, &req, K_NO_WAIT) < 0) {
+        LOG_WRN("fetch: already busy");
+        return -EBUSY;
+    }
+    LOG_INF("fetch: %u s from %u queued", duration, t0);
+    return 0;
+}
+
+//  ========== app_recorder_start ==========================================================
+// create the recorder and fetch threads, call after the ADC sampling is started
+void app_recorder_start(void)
+{
+    k_thread_create(&rec_thread_data, rec_stack, K_THREAD_STACK_SIZEOF(rec_stack),
+                    app_recorder_thread, NULL, NULL, NULL, REC_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&rec_thread_data, "recorder");
+
+    k_thread_create(&fetch_thread_data, fetch_stack, K_THREAD_STACK_SIZEOF(fetch_stack),
+                    app_fetch_thread, NULL, NULL, NULL, FETCH_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&fetch_thread_data, "rec_fetch");
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_RECORDER_H
+#define APP_RECORDER_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include "app_eeprom.h"
+#include "app_rec_codec.h"
+
+//  ========== defines =====================================================================
+// continuous ADC record on the QSPI flash, a ring of REC_BLOCK_SIZE blocks after the first
+// sector (kept for app_eeprom_write); ~40 h of quiet signal at 100 Hz on the MX25R64
+#define REC_REGION_OFFSET       SPI_FLASH_SECTOR_SIZE
+#define REC_REGION_SIZE         (SPI_FLASH_SIZE - REC_REGION_OFFSET)
+#define REC_BLOCKS_PER_SECTOR   (SPI_FLASH_SECTOR_SIZE / REC_BLOCK_SIZE)   // = 16
+#define REC_SECTOR_COUNT        (REC_REGION_SIZE / SPI_FLASH_SECTOR_SIZE)
+#define REC_BLOCK_COUNT         (REC_SECTOR_COUNT * REC_BLOCKS_PER_SECTOR)
+
+// downlink commands on LORAWAN_COMMAND_PORT, integers big-endian
+//   0x01 fetch: t0 (uint32, epoch s), duration (uint16, s)
+//        the recorded samples of [t0, t0 + duration) are sent as event windows
+#define REC_CMD_FETCH           0x01
+#define REC_CMD_FETCH_SIZE      7
+#define REC_FETCH_MAX_S         300     // ~30 windows, hours of duty cycle at SF12
+
+//  ========== globals =====================================================================
+extern struct k_thread rec_thread_data;
+
+//  ========== prototypes ==================================================================
+int8_t app_recorder_init(const struct device *dev);
+void app_recorder_start(void);
+int8_t app_recorder_flush(void);
+int app_recorder_command(const uint8_t *data, uint8_t len);
+
+#endif /* APP_RECORDER_H */
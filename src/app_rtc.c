@@ -7,32 +7,31 @@
 
 //  ========== includes ====================================================================
 #include "app_rtc.h"
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_rtc, CONFIG_APP_CLOCK_LOG_LEVEL);
 
 //  ========== globals ====================================================================
 // global variable to track the offset between the system clock and RTC
-static int64_t system_rtc_offset_ms = 0;
-static struct k_mutex offset_mutex;
+static struct app_timebase rtc_timebase = APP_TIMEBASE_INITIALIZER;
 
 //  ========== app_rtc_init ================================================================
 const struct device *app_rtc_init(void)
 {
-    const struct device *rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc0));
+    const struct device *rtc_dev = DEVICE_DT_GET(APP_RTC_NODE);
     if (!device_is_ready(rtc_dev)) {
-        printk("RTC device is not ready\n");
+        LOG_ERR("RTC device is not ready");
         return NULL;
     }
 
     // start the counter
     int ret = counter_start(rtc_dev);
     if (ret < 0) {
-        printk("failed to start RTC: %d\n", ret);
+        LOG_ERR("failed to start RTC: %d", ret);
         return NULL;
     }
 
-    // initialize mute
-    k_mutex_init(&offset_mutex);
-
-    printk("RTC initialized and started successfully\n");
+    LOG_INF("RTC initialized and started successfully");
     return rtc_dev;
 }
 
@@ -41,7 +40,7 @@ const struct device *app_rtc_init(void)
 int8_t app_rtc_sync_uptime(const struct device *rtc_dev)
 {
     if (!rtc_dev) {
-        printk("RTC device is NULL\n");
+        LOG_ERR("RTC device is NULL");
         return -EINVAL;
     }
 
@@ -55,7 +54,7 @@ int8_t app_rtc_sync_uptime(const struct device *rtc_dev)
     // retrieve the current RTC counter value
     int ret = counter_get_value(rtc_dev, &rtc_ticks);
     if (ret < 0) {
-        printk("failed to get RTC counter value, error: %d\n", ret);
+        LOG_ERR("failed to get RTC counter value, error: %d", ret);
         return ret;
     }
 
@@ -67,8 +66,8 @@ int8_t app_rtc_sync_uptime(const struct device *rtc_dev)
     rtc_time_ms = ((int64_t)rtc_ticks * 1000) / frequency;
 
     // debug output
-    printk("RTC ticks: %u, top: %u, freq: %u Hz, time_ms: %lld\n",
-           rtc_ticks, top_value, frequency, rtc_time_ms);
+    LOG_DBG("RTC ticks: %u, top: %u, freq: %u Hz, time_ms: %lld",
+            rtc_ticks, top_value, frequency, rtc_time_ms);
 
     // get the current system uptime in milliseconds
     current_uptime_ms = k_uptime_get();
@@ -78,59 +77,38 @@ int8_t app_rtc_sync_uptime(const struct device *rtc_dev)
 
     // validate the offset (example: restrict offset to ±1 year for sanity)
     if (new_offset_ms < -ONE_YEAR_MS|| new_offset_ms > ONE_YEAR_MS) {
-        printk("offset out of range! calculation error\n");
+        LOG_ERR("offset out of range! calculation error");
         return -EINVAL;
     }
 
-    // safely update the global offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    system_rtc_offset_ms = new_offset_ms;
-    k_mutex_unlock(&offset_mutex);
+    // publish the new offset without blocking readers
+    app_timebase_publish_offset(&rtc_timebase, new_offset_ms);
 
     // debugging output
-    printk("calculated offset (ms): %lld\n", system_rtc_offset_ms);
+    LOG_DBG("calculated offset (ms): %lld", new_offset_ms);
 
     return 0;
 }
 
 //  ========== app_rtc_get_time ==========================================================
-uint64_t app_rtc_get_time(const struct device *rtc_dev)
+// lock-free, safe from the acquisition hot path and from ISR context
+uint64_t app_rtc_get_time(void)
 {
-    int64_t current_uptime_ms = k_uptime_get();
-    int64_t offset_ms;
-
-    // safely read the offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    offset_ms = system_rtc_offset_ms;
-    k_mutex_unlock(&offset_mutex);
-
-    // check for overflow or underflow
-    if (offset_ms > 0 &&
-        current_uptime_ms > UINT64_MAX - offset_ms) {
-        printk("overflow detected in timestamp calculation\n");
-        return UINT64_MAX;
-    }
-    if (offset_ms < 0 &&
-        current_uptime_ms < (uint64_t)(-offset_ms)) {
-        printk("underflow detected in timestamp calculation\n");
-        return 0;
-    }
-    uint64_t timestamp_ms = current_uptime_ms + offset_ms;
-    return timestamp_ms;
+    return app_timebase_now_ms(&rtc_timebase);
 }
 
 //  ========== app_rtc_periodic_sync====================================================
 int8_t app_rtc_periodic_sync(const struct device *rtc_dev)
 {
     if (!rtc_dev) {
-        printk("RTC device is NULL\n");
+        LOG_ERR("RTC device is NULL");
         return -EINVAL;
     }
     
     // call this periodically from a thread or workqueue
     int ret = app_rtc_sync_uptime(rtc_dev);
     if (ret < 0) {
-        printk("periodic sync failed, error: %d", ret);
+        LOG_ERR("periodic sync failed, error: %d", ret);
     }
     return 0;
 }
\ No newline at end of file
@@ -16,15 +16,23 @@
 #include <zephyr/drivers/rtc.h>
 #include <zephyr/drivers/counter.h>
 #include <time.h>
+#include "app_timebase.h"
  
 //  ========== defines =====================================================================
 #define ONE_YEAR_MS                 365LL * 24 * 60 * 60 * 1000
 #define CONFIG_COUNTER_NRF_RTC
+
+// on-chip RTC counter, the native counter on native_sim
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(rtc0), okay)
+#define APP_RTC_NODE                DT_NODELABEL(rtc0)
+#else
+#define APP_RTC_NODE                DT_NODELABEL(counter0)
+#endif
  
 //  ========== prototypes ==================================================================
 const struct device *app_rtc_init(void);
 int8_t  app_rtc_sync_uptime(const struct device *i2c_dev);
-uint64_t app_rtc_get_time();
+uint64_t app_rtc_get_time(void);
 int8_t app_rtc_periodic_sync(const struct device *rtc_dev);
  
 #endif /* APP_RTC_H */
\ No newline at end of file
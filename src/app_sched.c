@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_sched.h"
+#include <zephyr/init.h>
+
+//  ========== globals =====================================================================
+// every periodic job of the application runs on this one work queue, the system sleeps
+// in between: there is no thread per job and no fixed-period polling loop
+K_THREAD_STACK_DEFINE(app_sched_stack, APP_SCHED_STACK_SIZE);
+static struct k_work_q app_sched_wq;
+static struct k_work_delayable dispatch_work;
+
+static sys_slist_t jobs = SYS_SLIST_STATIC_INIT(&jobs);
+static struct k_spinlock jobs_lock;
+
+//  ========== app_sched_next ==============================================================
+// take one job that may run at time now and advance it to its next period, NULL if none
+static struct app_job *app_sched_next(int64_t now)
+{
+    struct app_job *job, *ready = NULL;
+
+    K_SPINLOCK(&jobs_lock) {
+        SYS_SLIST_FOR_EACH_CONTAINER(&jobs, job, node) {
+            if (job->due - job->tolerance_ms > now) {
+                continue;
+            }
+
+            // keep the nominal phase, unless the job fell behind by a whole period
+            job->due += job->period_ms;
+            if (job->due - job->tolerance_ms <= now) {
+                job->due = now + job->period_ms;
+            }
+            ready = job;
+            break;
+        }
+    }
+    return ready;
+}
+
+//  ========== app_sched_dispatch ==========================================================
+// run the jobs that are within their tolerance, then sleep until the latest instant that
+// still meets every deadline: jobs whose window is open by then run in the same wake-up
+static void app_sched_dispatch(struct k_work *work)
+{
+    struct app_job *job;
+    int64_t wake = INT64_MAX;
+
+    while ((job = app_sched_next(k_uptime_get())) != NULL) {
+        job->fn(job);
+        job->runs++;
+    }
+
+    K_SPINLOCK(&jobs_lock) {
+        SYS_SLIST_FOR_EACH_CONTAINER(&jobs, job, node) {
+            wake = MIN(wake, job->due + job->tolerance_ms);
+        }
+    }
+
+    if (wake != INT64_MAX) {
+        k_work_reschedule_for_queue(&app_sched_wq, &dispatch_work, K_TIMEOUT_ABS_MS(wake));
+    }
+}
+
+//  ========== app_sched_init ==============================================================
+static int app_sched_init(void)
+{
+    struct k_work_queue_config cfg = { .name = "app_sched" };
+
+    k_work_init_delayable(&dispatch_work, app_sched_dispatch);
+    k_work_queue_start(&app_sched_wq, app_sched_stack, K_THREAD_STACK_SIZEOF(app_sched_stack),
+                       APP_SCHED_PRIORITY, &cfg);
+    return 0;
+}
+SYS_INIT(app_sched_init, APPLICATION, 0);
+
+//  ========== app_sched_register ==========================================================
+// add a periodic job, its first run is due after first
+int app_sched_register(struct app_job *job, k_timeout_t first)
+{
+    if (!job || !job->fn || job->period_ms == 0 || job->tolerance_ms >= job->period_ms) {
+        return -EINVAL;
+    }
+
+    K_SPINLOCK(&jobs_lock) {
+        job->due = k_uptime_get() + k_ticks_to_ms_ceil64(first.ticks);
+        job->runs = 0;
+        sys_slist_find_and_remove(&jobs, &job->node);
+        sys_slist_append(&jobs, &job->node);
+    }
+
+    // recompute the wake-up time with the new job
+    k_work_reschedule_for_queue(&app_sched_wq, &dispatch_work, K_NO_WAIT);
+    return 0;
+}
+
+//  ========== app_sched_cancel ============================================================
+// remove a job, a run already in progress completes
+void app_sched_cancel(struct app_job *job)
+{
+    K_SPINLOCK(&jobs_lock) {
+        sys_slist_find_and_remove(&jobs, &job->node);
+    }
+}
+
+//  ========== app_sched_set_period ========================================================
+// change the period of a job, the next run moves by the difference
+void app_sched_set_period(struct app_job *job, uint32_t period_ms)
+{
+    if (period_ms <= job->tolerance_ms) {
+        return;
+    }
+
+    K_SPINLOCK(&jobs_lock) {
+        job->due += (int64_t)period_ms - job->period_ms;
+        job->period_ms = period_ms;
+    }
+    k_work_reschedule_for_queue(&app_sched_wq, &dispatch_work, K_NO_WAIT);
+}
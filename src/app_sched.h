@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SCHED_H
+#define APP_SCHED_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <stdint.h>
+
+//  ========== defines =====================================================================
+#define APP_SCHED_STACK_SIZE    2048    // one stack for every periodic job
+#define APP_SCHED_PRIORITY      5       // below the acquisition, detection and bus threads
+
+// static job definition: APP_JOB_DEFINE(sync_job, "sync", sync_fn, 60000, 10000);
+#define APP_JOB_DEFINE(_name, _label, _fn, _period_ms, _tolerance_ms)   \
+    struct app_job _name = {                                            \
+        .name = _label,                                                 \
+        .fn = _fn,                                                      \
+        .period_ms = _period_ms,                                        \
+        .tolerance_ms = _tolerance_ms,                                  \
+    }
+
+//  ========== globals =====================================================================
+struct app_job;
+
+typedef void (*app_job_fn_t)(struct app_job *job);
+
+// periodic job: runs every period_ms, at most tolerance_ms early or late so that jobs
+// due at about the same time share one wake-up
+struct app_job {
+    sys_snode_t node;
+    const char *name;
+    app_job_fn_t fn;
+    uint32_t period_ms;
+    uint32_t tolerance_ms;
+    int64_t due;            // uptime (ms) of the next nominal run
+    uint32_t runs;
+};
+
+//  ========== prototypes ==================================================================
+int app_sched_register(struct app_job *job, k_timeout_t first);
+void app_sched_cancel(struct app_job *job);
+void app_sched_set_period(struct app_job *job, uint32_t period_ms);
+
+#endif /* APP_SCHED_H */
@@ -6,12 +6,15 @@
  */
 
 #include "app_sensors.h"
+#include <stdlib.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(app_sensors, CONFIG_APP_SENSORS_LOG_LEVEL);
 
 //  ========== app_sensors_handler =======================================================
 int8_t app_sensors_handler()
 {
-    int8_t ret;
-    uint8_t byte_payload[BYTE_PAYLOAD] = {0};
+    struct net_buf *buf;
 
     // Cconfiguration of LEDs
     static const struct gpio_dt_spec led_tx = GPIO_DT_SPEC_GET(LED_TX, gpios);
@@ -27,45 +30,60 @@ int8_t app_sensors_handler()
     uint64_t timestamp = app_ds3231_get_time();
     //uint64_t timestamp = app_rtc_get_time();
 
-    // add timestamp to byte payload (big-endian)
-    for (int8_t i = 0; i < 8; i++) {
-        byte_payload[i] = (timestamp >> (56 - i * 8)) & 0xFF;
-    }
-
     // get sensor device
     const struct device *dev = DEVICE_DT_GET_ONE(sensirion_sht3xd);
     if (!device_is_ready(dev)) {
-        printk("sensor device not ready\n");
+        LOG_ERR("sensor device not ready");
         return -ENODEV;
     }
 
-    // collect sensor data and add to byte payload
-    int8_t index = 8; // Start after the timestamp
-    int16_t ain1 = app_nrf52_get_ain1();
-    int16_t temp = app_sht31_get_temp(dev);
-    int16_t hum = app_sht31_get_hum(dev);
-    int16_t velocity = 0;
+    // collect sensor data
+    int16_t ain1 = app_power_get_soc();
 
-    // Convert and append each sensor value to byte payload (big-endian)
-    int16_t sensor_data[] = {ain1, temp, hum, velocity};
-    for (int j = 0; j < sizeof(sensor_data) / sizeof(sensor_data[0]); j++) {
-        byte_payload[index++] = (sensor_data[j] >> 8) & 0xFF;       // high byte
-        byte_payload[index++] = sensor_data[j] & 0xFF;              // low byte
+    // temperature and humidity come from one cached conversion, no measurement wait here
+    struct sht31_sample env = {0};
+    if (app_sht31_get(&env) == 0) {
+        LOG_DBG("SHT31: %d.%02d °C, %d.%02d %%RH (age %lld ms)",
+                env.temp / TEMP_SCALE, abs(env.temp % TEMP_SCALE),
+                env.hum / HUM_SCALE, env.hum % HUM_SCALE, app_sht31_age_ms(&env));
+    } else {
+        LOG_WRN("no SHT31 sample available yet");
     }
+    int16_t temp = env.temp;
+    int16_t hum = env.hum;
 
-    printk("sending battery level, temperature, humidity...\n");
+    // refresh the cache for the next cycle
+    (void)app_sht31_trigger();
+
+    // the frame is built in an uplink buffer and handed to the TX thread as is
+    buf = app_buf_uplink_alloc(K_NO_WAIT);
+    if (!buf) {
+        LOG_WRN("no free uplink buffer");
+        return -ENOMEM;
+    }
+
+    // bit-packed frame generated from the uplink schema (tools/codegen), 9 bytes; there is
+    // no velocity measurement yet so the optional field is left out
+    struct uplink_telemetry tlm = {
+        .time = (uint32_t)(timestamp / 1000),
+        .battery = (uint8_t)ain1,
+        .temperature = temp,
+        .humidity = (uint16_t)hum,
+        .has_velocity = false,
+    };
+    int len = uplink_telemetry_encode(&tlm, net_buf_tail(buf), net_buf_tailroom(buf));
+    if (len < 0) {
+        net_buf_unref(buf);
+        return len;
+    }
+    net_buf_add(buf, len);
+
+    LOG_DBG("queueing battery level, temperature, humidity...");
 
     // blink LEDs when LoRaWAN is activated
     gpio_pin_toggle_dt(&led_tx);
     gpio_pin_toggle_dt(&led_rx);
 
-    ret = lorawan_send(LORAWAN_PORT, byte_payload, index, LORAWAN_MSG_UNCONFIRMED);
-
-    if (ret < 0) {
-        printk("lorawan_send failed: %d\n", ret);
-        return ret == -EAGAIN ? 0 : ret;
-    }
-
-    printk("data sent!\n");
+    app_lorawan_queue(buf, LORAWAN_PORT);
     return 0;
 }
\ No newline at end of file
@@ -14,13 +14,15 @@
 #include "app_lorawan.h"
 #include "app_sht31.h"
 #include "app_rtc.h"
+#include "app_ds3231.h"
+#include "app_power.h"
+#include "app_metrics.h"
+#include "app_buf.h"
 
 //  ========== defines =====================================================================
 /* led control */
 #define LED_TX                  DT_ALIAS(ledtx)     // declared in device tree
 #define LED_RX                  DT_ALIAS(ledrx)
-#define RAW_PAYLOAD             6                   // temperature, humdity, and battery level
-#define BYTE_PAYLOAD            12                   // 6 int16 values => 12 bytes                 
 
 //  ========== prototypes ==================================================================
 int8_t app_sensors_handler();
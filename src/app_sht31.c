@@ -7,57 +7,134 @@
 
 //  ========== includes ====================================================================
 #include "app_sht31.h"
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
 
-//  ========== app_sht31_get_temp ==========================================================
-int16_t app_sht31_get_temp(const struct device *dev)
+LOG_MODULE_REGISTER(app_sht31, CONFIG_APP_SENSORS_LOG_LEVEL);
+
+//  ========== globals =====================================================================
+// the SHT31 is driven directly on the bus: one single-shot conversion returns both values,
+// the start and completion phases are transactions of the I2C bus scheduler, callers
+// never sleep or wait for the bus
+static const struct i2c_dt_spec sht31_i2c = I2C_DT_SPEC_GET(SHT31_NODE);
+
+static struct i2c_txn start_txn;
+static struct i2c_txn read_txn;
+static uint8_t cmd_buf[2] = { SHT31_CMD_SINGLE_HIGH >> 8, SHT31_CMD_SINGLE_HIGH & 0xFF };
+static uint8_t rx_buf[6];
+static atomic_t busy = ATOMIC_INIT(0);
+
+// last completed conversion
+static struct k_spinlock cache_lock;
+static struct sht31_sample cache;
+static bool cache_valid = false;
+
+//  ========== sht31_crc8 ==================================================================
+// CRC-8 of the SHT3x data words (poly 0x31, init 0xFF)
+static uint8_t sht31_crc8(const uint8_t *data, size_t len)
 {
-    struct sensor_value val;
+    uint8_t crc = 0xFF;
 
-    // fetch the latest sample from the sensor
-	int8_t ret = sensor_sample_fetch(dev);
-    if (ret < 0 && ret != -EBADMSG) { 
-	    printk("SHT31 device sample is not up to date. error: %d\n", ret);
-	    return 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
     }
+    return crc;
+}
 
-    // retrieve the ambient temperature from the sensor
-	ret = sensor_channel_get(dev, SENSOR_CHAN_AMBIENT_TEMP, &val);
-    if (ret < 0) {
-        printk("can't read sensor channels. error: %d\n", ret);
-	    return 0;
+//  ========== sht31_read_done =============================================================
+// completion phase: check both words and update the cache
+static void sht31_read_done(struct i2c_txn *txn, int result)
+{
+    struct sht31_sample sample;
+
+    atomic_clear(&busy);
+    if (result < 0) {
+        LOG_ERR("SHT31 measurement read failed. error: %d", result);
+        return;
+    }
+
+    if (sht31_crc8(&rx_buf[0], 2) != rx_buf[2] || sht31_crc8(&rx_buf[3], 2) != rx_buf[5]) {
+        LOG_ERR("SHT31 measurement CRC mismatch");
+        return;
     }
 
-    // convert the raw temperature value to integer format with scaling
-    int32_t temp = (val.val1 * TEMP_SCALE) + ((int64_t)val.val2 * TEMP_SCALE / 1000000);
+    // T = -45 + 175 * raw / 65535, RH = 100 * raw / 65535
+    uint16_t raw_t = sys_get_be16(&rx_buf[0]);
+    uint16_t raw_h = sys_get_be16(&rx_buf[3]);
+    sample.temp = (int16_t)(-45 * TEMP_SCALE + ((int32_t)175 * TEMP_SCALE * raw_t) / 65535);
+    sample.hum = (int16_t)(((int32_t)100 * HUM_SCALE * raw_h) / 65535);
+    sample.timestamp = k_uptime_get();
 
-    // print the temperature value with two decimal places
-    printk("SHT31 temperature: %d.%02d °C\n", temp / TEMP_SCALE, temp % TEMP_SCALE);
-    return (int16_t)temp;
+    K_SPINLOCK(&cache_lock) {
+        cache = sample;
+        cache_valid = true;
+    }
 }
 
-//  ========== app_sht31_get_hum ===========================================================
-int16_t app_sht31_get_hum(const struct device *dev)
+//  ========== sht31_start_done ============================================================
+// start phase done: queue the read for when the conversion is complete
+static void sht31_start_done(struct i2c_txn *txn, int result)
 {
-    struct sensor_value val;
+    if (result < 0) {
+        LOG_ERR("SHT31 measurement start failed. error: %d", result);
+        atomic_clear(&busy);
+        return;
+    }
+
+    app_i2c_txn_read(&read_txn, &sht31_i2c, rx_buf, sizeof(rx_buf));
+    read_txn.cb = sht31_read_done;
+    app_i2c_submit(&read_txn, K_MSEC(SHT31_CONVERSION_MS));
+}
 
-    // fetch the latest sample from the sensor
-	int8_t ret = sensor_sample_fetch(dev);
-    if (ret < 0 && ret != -EBADMSG) { 
-	    printk("SHT31 device sample is not up to date. error: %d\n", ret);
-	    return 0;
+//  ========== app_sht31_init ==============================================================
+// check the bus and start a first conversion so the cache fills up
+int8_t app_sht31_init(const struct device *dev)
+{
+    if (!device_is_ready(dev) || !i2c_is_ready_dt(&sht31_i2c)) {
+        LOG_ERR("%s: sensor device not ready", dev->name);
+        return -ENODEV;
     }
 
-    // retrieve the humidity from the sensor
-	ret = sensor_channel_get(dev, SENSOR_CHAN_HUMIDITY, &val);
+    return app_sht31_trigger();
+}
+
+//  ========== app_sht31_trigger ===========================================================
+// start a conversion in the background, returns immediately
+int8_t app_sht31_trigger(void)
+{
+    if (atomic_set(&busy, 1)) {
+        return -EBUSY;
+    }
+
+    app_i2c_txn_write(&start_txn, &sht31_i2c, cmd_buf, sizeof(cmd_buf));
+    start_txn.cb = sht31_start_done;
+    int8_t ret = app_i2c_submit(&start_txn, K_NO_WAIT);
     if (ret < 0) {
-        printk("can't read sensor channels. error: %d\n", ret);
-	    return 0;
+        atomic_clear(&busy);
     }
+    return ret;
+}
 
-    // convert the raw humicity value to integer format with scaling
-    int32_t hum = (val.val1 * HUM_SCALE) + ((int64_t)val.val2 * HUM_SCALE / 1000000);
+//  ========== app_sht31_get ===============================================================
+// copy the last completed conversion, -ENODATA if none completed yet
+int8_t app_sht31_get(struct sht31_sample *sample)
+{
+    int8_t ret = -ENODATA;
+
+    K_SPINLOCK(&cache_lock) {
+        if (cache_valid) {
+            *sample = cache;
+            ret = 0;
+        }
+    }
+    return ret;
+}
 
-    // print the humifity value with two decimal places
-    printk("SHT31 humidity: %d.%02d %%RH\n", hum / HUM_SCALE, hum % HUM_SCALE);
-    return (int16_t)hum;
-}
\ No newline at end of file
+//  ========== app_sht31_age_ms ============================================================
+int64_t app_sht31_age_ms(const struct sht31_sample *sample)
+{
+    return k_uptime_get() - sample->timestamp;
+}
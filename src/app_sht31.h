@@ -13,14 +13,30 @@
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/i2c.h>
 #include <stdint.h>
+#include "app_i2c_sched.h"
 
 //  ========== defines =====================================================================
 #define TEMP_SCALE  100     // scale for converting to int16_t
 #define HUM_SCALE   100     // scale for converting to int16_t
 
+#define SHT31_NODE              DT_COMPAT_GET_ANY_STATUS_OKAY(sensirion_sht3xd)
+#define SHT31_CMD_SINGLE_HIGH   0x2400  // single shot, high repeatability, no clock stretching
+#define SHT31_CONVERSION_MS     16      // max. 15.5 ms for high repeatability
+
+//  ========== globals =====================================================================
+// one conversion: temperature and humidity come from the same measurement
+struct sht31_sample {
+    int16_t temp;           // °C x TEMP_SCALE
+    int16_t hum;            // %RH x HUM_SCALE
+    int64_t timestamp;      // uptime (ms) of the conversion
+};
+
 //  ========== prototypes ==================================================================
-int16_t app_sht31_get_temp(const struct device *dev);
-int16_t app_sht31_get_hum(const struct device *dev);
+int8_t app_sht31_init(const struct device *dev);
+int8_t app_sht31_trigger(void);
+int8_t app_sht31_get(struct sht31_sample *sample);
+int64_t app_sht31_age_ms(const struct sht31_sample *sample);
 
-#endif /* APP_SHT31_H */
\ No newline at end of file
+#endif /* APP_SHT31_H */
@@ -6,117 +6,558 @@
  */
 
 //  ========== includes ====================================================================
+#include "app_sta_lta.h"
 #include "app_adc.h"
 #include "app_lorawan.h"
+#include "app_classifier.h"
+#include "app_metrics.h"
+#include "app_tlm_codec.h"
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#if defined(CONFIG_APP_BENCH)
+#include <zephyr/timing/timing.h>
+#endif
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(app_sta_lta, CONFIG_APP_STA_LTA_LOG_LEVEL);
 
 //  ========== defines =====================================================================
-// STA and LTA window durations in milliseconds
-#define STA_WINDOW_DURATION_MS      1000     // 1 seconds
-#define LTA_WINDOW_DURATION_MS      10000    // 10 seconds
+// recursive averages, time constants as a power of two samples (10 ms per sample at the
+// nominal rate, the windows stretch when the power policy slows sampling down)
+#define STA_SHIFT                   7       // ~1.3 s
+#define LTA_SHIFT                   10      // ~10 s
+#define DC_SHIFT                    12      // ~41 s, baseline removal
+
+// trigger thresholds with hysteresis, STA/LTA ratio x10
+#define TRIGGER_RATIO_X10           30      // STA/LTA ratio to trigger event
+#define RESET_RATIO_X10             15      // STA/LTA ratio to reset trigger
+
+#define STA_LTA_STACK_SIZE          1024
+#define STA_LTA_PRIORITY            2
+
+// untimed samples before the bench measures: 4 LTA windows, the LTA within 2 % of steady
+// state on the noise
+#define BENCH_SETTLE_SAMPLES        (4u << LTA_SHIFT)
+
+// checkpoint once per STA window; a restored detector needs one STA window to refill the
+// STA, the LTA and baseline come from the checkpoint
+#define CHECKPOINT_MAGIC            0x57A17A02
+#define CHECKPOINT_SAMPLES          (1u << STA_SHIFT)
+#define CHECKPOINT_SETTINGS_KEY     "app/det"
+#define CHECKPOINT_DC_MAX           (200 << 8)  // baseline moved further: not restored
 
-// derived buffer sizes
-#define STA_WINDOW_SIZE (STA_WINDOW_DURATION_MS / SAMPLING_RATE_MS)
-#define LTA_WINDOW_SIZE (LTA_WINDOW_DURATION_MS / SAMPLING_RATE_MS)
+// sample that starts or ends an event, see sta_lta_detect
+#define STA_LTA_EDGE_NONE           0
+#define STA_LTA_EDGE_START          1
+#define STA_LTA_EDGE_END            2
 
-// trigger thresholds with hysteresis
-#define TRIGGER_THRESHOLD           1.0f //0.8f    // 5.0f // STA/LTA ratio to trigger event
-#define RESET_THRESHOLD             0.6f    // 2.5f // STA/LTA ratio to reset trigger
+#if defined(CONFIG_APP_STA_LTA_MODE_Z)
+#define STA_LTA_MODE                STA_LTA_MODE_Z
+#elif defined(CONFIG_APP_STA_LTA_MODE_ANY)
+#define STA_LTA_MODE                STA_LTA_MODE_ANY
+#else
+#define STA_LTA_MODE                STA_LTA_MODE_VECTOR
+#endif
 
 //  ========== globals =====================================================================
-// define a thread stack with a size of 1024 bytes for the STA/LTA thread.
-K_THREAD_STACK_DEFINE(sta_lta_stack, 1024);
+K_THREAD_STACK_DEFINE(sta_lta_stack, STA_LTA_STACK_SIZE);
 
 // declare a thread data structure to manage the STA/LTA thread.
 struct k_thread sta_lta_thread_data;
 
-// buffer to hold the Short-Term Average (STA) and Long-Term Average (LTA) samples.
-static uint16_t sta_buffer[STA_WINDOW_SIZE];
-static uint16_t lta_buffer[LTA_WINDOW_SIZE];
+// detector state: a few words instead of copies of the STA and LTA windows
+static struct sta_lta_state det;
+
+// new samples and their characteristic function, one contiguous array per component,
+// and the vector magnitude; static, the detector stack is small
+static struct adc_soa_block block;
+static int32_t cf[ADC_COMPONENTS][ADC_BLOCK_SIZE];
+static int32_t mag[ADC_BLOCK_SIZE];
+
+// event in progress: features for the classifier, window taken or not, and whether the
+// classifier holds it (else the window went out unclassified)
+static struct clf_event event;
+static bool event_open = false;
+static bool event_captured = false;
+static bool event_classified = false;
+
+static const char *const mode_names[] = { "Z", "vector", "any" };
+static const char *const comp_names[] = { "Z", "N", "E" };
+
+// not cleared at boot: survives watchdog, fault and software resets, not a power loss
+static __noinit struct sta_lta_checkpoint retained[2];
+
+// checkpoint to start from, from retained RAM or else from the settings
+static struct sta_lta_checkpoint restore;
+static bool restore_valid = false;
+static bool restore_retained = false;
+static uint32_t checkpoint_seq;     // newest checkpoint written
+static uint32_t saved_seq;          // newest checkpoint copied to the settings
+
+//  ========== checkpoint helpers ==========================================================
+static uint16_t checkpoint_crc(const struct sta_lta_checkpoint *ck)
+{
+    return tlm_crc16(0xFFFF, (const uint8_t *)ck, offsetof(struct sta_lta_checkpoint, crc));
+}
+
+static bool checkpoint_valid(const struct sta_lta_checkpoint *ck)
+{
+    return ck->magic == CHECKPOINT_MAGIC && ck->crc == checkpoint_crc(ck);
+}
+
+// copy of the newest valid retained slot, false if none; a slot torn by a reset or by
+// the writer fails the CRC
+static bool checkpoint_newest(struct sta_lta_checkpoint *out)
+{
+    struct sta_lta_checkpoint a = retained[0], b = retained[1];
+    bool va = checkpoint_valid(&a), vb = checkpoint_valid(&b);
 
-//  ========== calculate_sta ===============================================================
-// function to calculate the Short-Term Average (STA) of a given buffer
-static float calculate_sta(const uint16_t *buffer, size_t size)
+    if (!va && !vb) {
+        return false;
+    }
+    *out = (va && (!vb || (int32_t)(a.seq - b.seq) > 0)) ? a : b;
+    return true;
+}
+
+// written by the detector thread only, into the older slot
+static void checkpoint_write(const struct sta_lta_state *s)
 {
-    float sum = 0.0;
-    for (size_t i = 0; i < size; i++) {
-        sum += (float)buffer[i];
+    struct sta_lta_checkpoint *ck = &retained[++checkpoint_seq & 1];
+
+    ck->magic = CHECKPOINT_MAGIC;
+    ck->seq = checkpoint_seq;
+    memcpy(ck->dc, s->dc, sizeof(ck->dc));
+    memcpy(ck->ch, s->ch, sizeof(ck->ch));
+    ck->mode = s->mode;
+    ck->triggered = s->triggered;
+    ck->crc = checkpoint_crc(ck);
+}
+
+//  ========== settings handler ============================================================
+static int checkpoint_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    struct sta_lta_checkpoint ck;
+
+    if (strcmp(name, "ckpt") != 0) {
+        return -ENOENT;
     }
-    //printk("STA sum: %.2f\n", sum/size);
-    return sum / size;
+    if (len != sizeof(ck) || read_cb(cb_arg, &ck, sizeof(ck)) != sizeof(ck)) {
+        return -EINVAL;
+    }
+    if (checkpoint_valid(&ck)) {
+        restore = ck;
+        restore_valid = true;
+        saved_seq = ck.seq;
+    }
+    return 0;
 }
 
-//  ========== calculate_lad ===============================================================
-// function to calculate the Long-Term Average (LTA) of a given buffer
-static float calculate_lta(const uint16_t *buffer, size_t size)
+SETTINGS_STATIC_HANDLER_DEFINE(app_sta_lta, CHECKPOINT_SETTINGS_KEY, NULL, checkpoint_set, NULL,
+                               NULL);
+
+//  ========== sta_lta_reset ===============================================================
+// the baselines start at the first sample of each component
+static void sta_lta_reset(struct sta_lta_state *s, uint8_t mode, const struct adc_soa_block *b)
 {
-    float sum = 0.0;
-    for (size_t i = 0; i < size; i++) {
-        sum += (float)buffer[i];
+    memset(s, 0, sizeof(*s));
+    for (int c = 0; c < ADC_COMPONENTS; c++) {
+        s->dc[c] = (int32_t)b->c[c][0] << 8;
     }
-    //printk("LTA sum: %.2f\n", sum/size);
-    return sum / size;
+    s->mode = mode;
+    s->warmup = 1u << LTA_SHIFT;
+}
+
+//  ========== sta_lta_restore =============================================================
+// start from a checkpoint: the LTA and the event state go on, the STA restarts at the LTA
+// and detection resumes after one STA window instead of a whole LTA
+static void sta_lta_restore(struct sta_lta_state *s, const struct sta_lta_checkpoint *ck,
+                            const struct adc_soa_block *b, bool fresh)
+{
+    sta_lta_reset(s, ck->mode, b);
+    for (int c = 0; c < ADC_COMPONENTS; c++) {
+        int32_t x = (int32_t)b->c[c][0] << 8;
+
+        s->ch[c].lta = ck->ch[c].lta;
+        s->ch[c].sta = ck->ch[c].lta;
+
+        // the baseline is kept unless the signal moved away from it while the node was down
+        if (ck->dc[c] - x < CHECKPOINT_DC_MAX && x - ck->dc[c] < CHECKPOINT_DC_MAX) {
+            s->dc[c] = ck->dc[c];
+        }
+    }
+    s->warmup = CHECKPOINT_SAMPLES;
+
+    // an event in progress only carries over a reset that kept the RAM
+    s->triggered = fresh && ck->triggered;
+}
+
+//  ========== cf_run ======================================================================
+// characteristic function of one component: rectified signal around its baseline, over a
+// contiguous run of samples
+static void cf_run(int32_t *dc, int32_t *out, const uint16_t *in, size_t n)
+{
+    int32_t d = *dc;
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t x = (int32_t)in[i] << 8;
+        d += (x - d) >> DC_SHIFT;
+        out[i] = x > d ? x - d : d - x;
+    }
+    *dc = d;
+}
+
+//  ========== magnitude3 ==================================================================
+// Euclidean norm of three non-negative values without square root or FPU,
+// max + (10 mid + 9 min) / 32, at most 8 % below the exact norm
+static inline int32_t magnitude3(int32_t a, int32_t b, int32_t c)
+{
+    int32_t hi = MAX(a, b), lo = MIN(a, b);
+    int32_t max = MAX(hi, c), min = MIN(lo, c);
+    int32_t mid = a + b + c - max - min;
+
+    return max + ((10 * mid + 9 * min) >> 5);
+}
+
+//  ========== input_name ==================================================================
+static const char *input_name(const struct sta_lta_state *s, int c)
+{
+    return s->mode == STA_LTA_MODE_ANY ? comp_names[c] : mode_names[s->mode];
+}
+
+//  ========== sta_lta_cf ==================================================================
+// stage 1 for n new samples of every component: one tight loop over each array, then the
+// vector magnitude. Stage 2 runs once per sample on the magnitude, so the cost grows by
+// much less than the number of components
+static void sta_lta_cf(struct sta_lta_state *s, const struct adc_soa_block *b, size_t n)
+{
+    int comps = s->mode == STA_LTA_MODE_Z ? 1 : ADC_COMPONENTS;
+
+    for (int c = 0; c < comps; c++) {
+        cf_run(&s->dc[c], cf[c], b->c[c], n);
+    }
+    if (s->mode == STA_LTA_MODE_VECTOR) {
+        for (size_t i = 0; i < n; i++) {
+            mag[i] = magnitude3(cf[0][i], cf[1][i], cf[2][i]);
+        }
+    }
+}
+
+//  ========== event_track =================================================================
+// one more sample of the event in progress, for the classifier
+static void event_track(const struct sta_lta_state *s, struct clf_event *ev, int inputs,
+                        size_t i)
+{
+    for (int c = 0; c < ev->components; c++) {
+        ev->energy[c] += cf[c][i];
+    }
+    for (int c = 0; c < inputs; c++) {
+        uint32_t ratio = s->ch[c].sta * 10 / MAX(s->ch[c].lta, 1);
+        if (ratio > ev->peak_ratio_x10) {
+            ev->peak_ratio_x10 = ratio;
+            ev->peak_sta = s->ch[c].sta >> 8;
+            ev->peak_offset = ev->duration;
+        }
+    }
+    ev->duration++;
+}
+
+//  ========== sta_lta_detect ==============================================================
+// stage 2 from sample i of the block: STA/LTA and trigger logic, per sample. Stops after
+// a sample that starts or ends an event (*edge) and returns the index of the next sample;
+// the event, if ev is not NULL, is tracked into *ev
+static size_t sta_lta_detect(struct sta_lta_state *s, size_t i, size_t n, int *edge,
+                             struct clf_event *ev)
+{
+    int inputs = s->mode == STA_LTA_MODE_ANY ? ADC_COMPONENTS : 1;
+    const int32_t *in[ADC_COMPONENTS] = { s->mode == STA_LTA_MODE_VECTOR ? mag : cf[0],
+                                          cf[1], cf[2] };
+
+    *edge = STA_LTA_EDGE_NONE;
+    for (; i < n; i++) {
+        bool above = false, below = true;
+
+        for (int c = 0; c < inputs; c++) {
+            struct sta_lta_chan *ch = &s->ch[c];
+            ch->sta += (in[c][i] - ch->sta) >> STA_SHIFT;
+
+            // the LTA is frozen during an event so that the event does not raise its own
+            // reference
+            if (!s->triggered) {
+                ch->lta += (in[c][i] - ch->lta) >> LTA_SHIFT;
+            }
+
+            int32_t lta = MAX(ch->lta, 1);
+            above |= ch->sta * 10 > lta * TRIGGER_RATIO_X10;
+            below &= ch->sta * 10 < lta * RESET_RATIO_X10;
+        }
+
+        if (s->warmup > 0) {
+            s->warmup--;
+            continue;
+        }
+
+        // any input starts an event, all of them must be quiet again to end it
+        if (!s->triggered && above) {
+            s->triggered = true;
+            if (ev) {
+                memset(ev, 0, sizeof(*ev));
+                ev->components = s->mode == STA_LTA_MODE_Z ? 1 : ADC_COMPONENTS;
+                event_track(s, ev, inputs, i);
+            }
+
+            int best = 0;
+            uint32_t best_ratio = 0;
+            for (int c = 0; c < inputs; c++) {
+                uint32_t ratio = s->ch[c].sta * 10 / MAX(s->ch[c].lta, 1);
+                if (ratio > best_ratio) {
+                    best = c;
+                    best_ratio = ratio;
+                }
+            }
+            LOG_INF(">>> EVENT START (%s, STA %d, LTA %d)", input_name(s, best),
+                    s->ch[best].sta >> 8, s->ch[best].lta >> 8);
+            *edge = STA_LTA_EDGE_START;
+            return i + 1;
+        }
+        if (s->triggered && below) {
+            s->triggered = false;
+            LOG_INF("<<< EVENT END (STA %d, LTA %d)", s->ch[0].sta >> 8, s->ch[0].lta >> 8);
+            *edge = STA_LTA_EDGE_END;
+            return i + 1;
+        }
+        if (s->triggered && ev) {
+            event_track(s, ev, inputs, i);
+        }
+    }
+    return n;
+}
+
+//  ========== event_capture ===============================================================
+// hand the event window to the classifier, or send it at once when the classifier is
+// still busy with the previous event: an event is never lost for want of a decision
+static void event_capture(void)
+{
+    event_classified = app_classifier_capture();
+    if (!event_classified) {
+        app_lorawan_window_tx(event.seq, NULL, -1);
+    }
+    event_captured = true;
 }
 
 //  ========== sta_lta_thread ==============================================================
-// thread function to monitor and analyze data using the STA/LTA algorithm
+// thread function to monitor the new samples with the STA/LTA algorithm
 static void app_sta_lta_thread(void *arg1, void *arg2, void *arg3)
 {
-    static bool event_triggered = false;
+    uint32_t cursor = 0;
+    uint32_t since_checkpoint = 0;
+    bool started = false;
+
     while (1) {
         // wait for a semaphore indicating that new ADC data is available
         k_sem_take(&data_ready_sem, K_FOREVER);
+        app_metrics_hist(METRIC_HIST_SEM_WAIT_US,
+                         k_cyc_to_us_floor32(k_cycle_get_32() - data_ready_cycles));
+
+        // usually one sample; after a hold-up, one block at a time from the oldest sample
+        // not yet read until caught up
+        size_t n;
+        while ((n = app_adc_get_new_soa(&block, &cursor)) > 0) {
+            if (!started) {
+                // a checkpoint of another detector mode is not restored
+                if (restore_valid && restore.mode == STA_LTA_MODE) {
+                    sta_lta_restore(&det, &restore, &block, restore_retained);
+                    checkpoint_seq = restore.seq;
+                    LOG_INF("detector restored (LTA %d)", det.ch[0].lta >> 8);
+                } else {
+                    sta_lta_reset(&det, STA_LTA_MODE, &block);
+                }
+                LOG_INF("detector on %s", mode_names[det.mode]);
+                started = true;
+            }
+
+            sta_lta_cf(&det, &block, n);
+            for (size_t i = 0; i < n; ) {
+                int edge;
+
+                i = sta_lta_detect(&det, i, n, &edge, &event);
+                if (edge == STA_LTA_EDGE_START) {
+                    app_metrics_inc(METRIC_DETECTION);
+
+                    // onset: the triggering sample, the cursor counts samples up to block[n]
+                    event.onset = cursor - n + i - 1;
+                    event.seq = app_lorawan_trigger_tx(
+                        app_adc_sample_ts(event.onset),
+                        (uint16_t)MIN(event.peak_ratio_x10, UINT16_MAX),
+                        (uint16_t)MIN(event.peak_sta, UINT16_MAX));
+                    event_open = true;
+                    event_captured = false;
+                } else if (edge == STA_LTA_EDGE_END && event_open) {
+                    if (!event_captured) {
+                        event_capture();
+                    }
+                    if (event_classified) {
+                        app_classifier_submit(&event);
+                    }
+                    event_open = false;
+                }
+            }
+
+            // a long event: the window is taken before the ADC ring loses its onset
+            if (event_open && !event_captured && event.duration >= CLF_CAPTURE_AGE) {
+                event_capture();
+            }
+
+            // only a trusted state is worth restoring
+            since_checkpoint += n;
+            if (since_checkpoint >= CHECKPOINT_SAMPLES && det.warmup == 0) {
+                checkpoint_write(&det);
+                since_checkpoint = 0;
+            }
+        }
+    }
+}
+
+#if defined(CONFIG_APP_BENCH)
+//  ========== app_sta_lta_bench ===========================================================
+// measure the average cost per sample of each detector mode with the cycle counter, on
+// blocks of synthetic noise; must run before app_sta_lta_start, it uses the same buffers.
+// The detector first settles untimed on the noise, so that the quiet-background path is
+// timed, with the LTA updated and no event
+void app_sta_lta_bench(uint32_t samples)
+{
+    struct sta_lta_state s;
+    uint32_t seed = 1;
+
+    if (samples == 0) {
+        return;
+    }
+
+    timing_init();
+    timing_start();
+    for (uint8_t mode = STA_LTA_MODE_Z; mode <= STA_LTA_MODE_ANY; mode++) {
+        uint64_t cycles = 0;
+        uint32_t done = 0;
+        uint32_t edges = 0;
+
+        for (uint32_t t = 0; t < BENCH_SETTLE_SAMPLES + samples; t += ADC_BLOCK_SIZE) {
+            // +-64 counts around mid scale
+            for (int c = 0; c < ADC_COMPONENTS; c++) {
+                for (int i = 0; i < ADC_BLOCK_SIZE; i++) {
+                    seed = seed * 1664525u + 1013904223u;
+                    block.c[c][i] = 2048 + (seed >> 25) - 64;
+                }
+            }
+            if (t == 0) {
+                sta_lta_reset(&s, mode, &block);
+            }
+
+            timing_t start = timing_counter_get();
+            sta_lta_cf(&s, &block, ADC_BLOCK_SIZE);
+            for (size_t i = 0; i < ADC_BLOCK_SIZE; ) {
+                int edge;
+                i = sta_lta_detect(&s, i, ADC_BLOCK_SIZE, &edge, NULL);
+                edges += edge != STA_LTA_EDGE_NONE;
+            }
+            timing_t end = timing_counter_get();
 
-        // printk("sta/lta: get adc buffer\n");
-
-        int sta_offset = (ring_head - STA_WINDOW_SIZE + ADC_BUFFER_SIZE) % ADC_BUFFER_SIZE;
-        int lta_offset = (ring_head - LTA_WINDOW_SIZE + ADC_BUFFER_SIZE) % ADC_BUFFER_SIZE;
-        
-        // retrieve the most recent data for the STA and LTA buffers
-        app_adc_get_buffer(sta_buffer, STA_WINDOW_SIZE, sta_offset);
-        app_adc_get_buffer(lta_buffer, LTA_WINDOW_SIZE, lta_offset);
-
-        // calculate the STA and LTA values
-        float sta = calculate_sta(sta_buffer, STA_WINDOW_SIZE);
-        float lta = calculate_lta(lta_buffer, LTA_WINDOW_SIZE);
-
-        // validate values before calculating ratio
-        // check if LTA is zero
-        if (lta == 0) {
-            printk("Error: LTA is zero. Buffer might not be initialized properly.\n");
-            // debug the buffer
-            for (size_t i = 0; i < LTA_WINDOW_SIZE; i++) {
-                printk("lta_buffer[%zu] = %d\n", i, lta_buffer[i]);
+            if (t >= BENCH_SETTLE_SAMPLES) {
+                cycles += timing_cycles_get(&start, &end);
+                done += ADC_BLOCK_SIZE;
             }
-            return 0;
         }
-        
-        float ratio = sta/lta;
-        printk("STA: %.2f, LTA: %.2f, ratio: %.2f\n", sta, lta, ratio);
-
-        // check if the STA/LTA ratio exceeds the defined threshold
-        if (ratio > TRIGGER_THRESHOLD) {
-            printk(">>> EVENT START (ratio = %.2f)\n", ratio);
-            app_lorawan_trigger_tx();
+
+        printk("sta/lta %s: %u samples, %u cycles/sample, %u ns/sample\n", mode_names[mode],
+               done, (uint32_t)(cycles / done), (uint32_t)(timing_cycles_to_ns(cycles) / done));
+        if (edges > 0) {
+            printk("sta/lta %s: %u trigger edges on the noise, not the quiet path\n",
+                   mode_names[mode], edges);
         }
+    }
+    timing_stop();
+}
+#endif
+
+//  ========== app_sta_lta_save ============================================================
+// copy the newest retained checkpoint to the settings, for resets that lose the RAM;
+// from a periodic job, flash wear is one small record per call at most
+int8_t app_sta_lta_save(void)
+{
+    struct sta_lta_checkpoint ck;
+
+    if (!checkpoint_newest(&ck) || ck.seq == saved_seq) {
+        return 0;
+    }
 
-        // check if the STA/LTA ratio exceeds the defined threshold
-        // trigger event with hysteresis
-        // if (!event_triggered && ratio > TRIGGER_THRESHOLD) {
-        //     event_triggered = true;
-        //     printk(">>> EVENT START (ratio = %.2f)\n", ratio);
-        //     app_lorawan_trigger_tx();
-        // }
-        // else if (event_triggered && ratio < RESET_THRESHOLD) {
-        //     event_triggered = false;
-        //     printk("<<< EVENT END (ratio = %.2f)\n", ratio);
-        // }
+    int ret = settings_save_one(CHECKPOINT_SETTINGS_KEY "/ckpt", &ck, sizeof(ck));
+    if (ret < 0) {
+        LOG_ERR("failed to save detector checkpoint: %d", ret);
+        return ret;
     }
+    saved_seq = ck.seq;
+    return 0;
+}
+
+//  ========== app_sta_lta_triggered =======================================================
+// true during an event, for consumers that want the background signal only
+bool app_sta_lta_triggered(void)
+{
+    return det.triggered;
 }
 
 //  ========== sta_lta_start ===============================================================
-// create and initialize the thread with the specified stack and priority
+// create and initialize the thread with the specified stack and priority, from the
+// retained checkpoint if the reset kept the RAM, else from the one in the settings
 void app_sta_lta_start(void)
 {
+    if (checkpoint_newest(&restore)) {
+        restore_valid = true;
+        restore_retained = true;
+    } else if (settings_subsys_init() == 0) {
+        (void)settings_load_subtree(CHECKPOINT_SETTINGS_KEY);
+    }
+
     k_thread_create(&sta_lta_thread_data, sta_lta_stack, K_THREAD_STACK_SIZEOF(sta_lta_stack),
-                    app_sta_lta_thread, NULL, NULL, NULL, 2, 0, K_NO_WAIT);
-}
\ No newline at end of file
+                    app_sta_lta_thread, NULL, NULL, NULL, STA_LTA_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&sta_lta_thread_data, "sta_lta");
+}
+
+//  ========== shell commands ==============================================================
+// CPU time of the sampling and detector threads per acquired sample since boot, from the
+// thread runtime statistics; at 32 kHz on the nRF52 the cycle counter of these statistics
+// is coarse, the averages over many samples are what counts
+static int cmd_detector_budget(const struct shell *sh, size_t argc, char **argv)
+{
+    struct k_thread *threads[] = { &adc_thread_data, &sta_lta_thread_data };
+    uint32_t samples = app_adc_sample_count();
+
+    if (samples == 0) {
+        shell_error(sh, "no samples yet");
+        return -ENODATA;
+    }
+
+    shell_print(sh, "mode: %s, %u samples", mode_names[STA_LTA_MODE], samples);
+    shell_print(sh, "%-10s %10s %10s %10s", "thread", "ns/sample", "% 100 Hz", "% 250 Hz");
+    for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+        k_thread_runtime_stats_t stats;
+
+        if (k_thread_runtime_stats_get(threads[i], &stats) != 0) {
+            continue;
+        }
+
+        // CPU share at a rate r: ns per sample * r / 1e9, shown with two decimals
+        uint32_t ns = (uint32_t)(k_cyc_to_ns_floor64(stats.execution_cycles) / samples);
+        uint32_t at100 = (uint32_t)((uint64_t)ns * 100 / 100000);
+        uint32_t at250 = (uint32_t)((uint64_t)ns * 250 / 100000);
+        shell_print(sh, "%-10s %10u %7u.%02u %7u.%02u", k_thread_name_get(threads[i]), ns,
+                    at100 / 100, at100 % 100, at250 / 100, at250 % 100);
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(detector_cmds,
+    SHELL_CMD(budget, NULL, "Print the CPU time per sample of acquisition and detection",
+              cmd_detector_budget),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(detector, &detector_cmds, "STA/LTA detector", NULL);
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_STA_LTA_H
+#define APP_STA_LTA_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_adc.h"
+
+//  ========== globals =====================================================================
+// detector input, chosen with CONFIG_APP_STA_LTA_MODE_*
+enum sta_lta_mode {
+    STA_LTA_MODE_Z = 0,         // vertical component only
+    STA_LTA_MODE_VECTOR,        // magnitude of the three rectified components
+    STA_LTA_MODE_ANY,           // one STA/LTA per component, any of them triggers
+};
+
+// one recursive STA/LTA pair, averages of the characteristic function in Q8 ADC counts
+struct sta_lta_chan {
+    int32_t sta;
+    int32_t lta;
+};
+
+// recursive STA/LTA detector state: a baseline per geophone component, one STA/LTA pair
+// per detector input (ch[0] only, except in STA_LTA_MODE_ANY)
+struct sta_lta_state {
+    int32_t dc[ADC_COMPONENTS];     // slow baseline of each component
+    struct sta_lta_chan ch[ADC_COMPONENTS];
+    uint32_t warmup;                // samples left before the LTA is trusted
+    uint8_t mode;
+    bool triggered;
+};
+
+// checkpoint of the detector state, in retained RAM (two slots, written alternately) and
+// copied to the settings for resets that lose the RAM
+struct sta_lta_checkpoint {
+    uint32_t magic;
+    uint32_t seq;
+    int32_t dc[ADC_COMPONENTS];
+    struct sta_lta_chan ch[ADC_COMPONENTS];
+    uint8_t mode;           // a checkpoint of another mode is not restored
+    uint8_t triggered;
+    uint16_t crc;           // CRC-16/CCITT of the fields above
+};
+
+extern struct k_thread sta_lta_thread_data;
+
+//  ========== prototypes ==================================================================
+void app_sta_lta_start(void);
+int8_t app_sta_lta_save(void);
+#if defined(CONFIG_APP_BENCH)
+void app_sta_lta_bench(uint32_t samples);
+#endif
+bool app_sta_lta_triggered(void);
+
+#endif /* APP_STA_LTA_H */
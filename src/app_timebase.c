@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_timebase.h"
+#include <zephyr/sys/barrier.h>
+#if defined(CONFIG_APP_BENCH)
+#include <zephyr/timing/timing.h>
+#endif
+
+//  ========== app_timebase_publish ========================================================
+// update the model, called by the sync threads and the clock discipline
+// interrupts are masked for the few instructions of the update, so on this single core
+// an ISR reader never observes an update in progress and never has to spin
+void app_timebase_publish(struct app_timebase *tb, int64_t ref_ticks, int64_t ref_epoch_us,
+                          uint32_t scale_q24)
+{
+    unsigned int key = irq_lock();
+
+    atomic_inc(&tb->seq);
+    barrier_dmem_fence_full();
+    tb->ref_ticks = ref_ticks;
+    tb->ref_epoch_us = ref_epoch_us;
+    tb->scale_q24 = scale_q24;
+    barrier_dmem_fence_full();
+    atomic_inc(&tb->seq);
+
+    irq_unlock(key);
+}
+
+//  ========== app_timebase_publish_offset =================================================
+// plain offset to k_uptime at the nominal tick rate (no frequency correction)
+void app_timebase_publish_offset(struct app_timebase *tb, int64_t offset_ms)
+{
+    int64_t now = k_uptime_ticks();
+
+    app_timebase_publish(tb, now, k_ticks_to_us_floor64(now) + offset_ms * 1000,
+                         TIMEBASE_NOMINAL_SCALE_Q24);
+}
+
+//  ========== app_timebase_ticks_to_us ====================================================
+// wall-clock time of a kernel tick count, wait-free for ISRs, a preempted thread reader
+// retries at most once per update
+int64_t app_timebase_ticks_to_us(const struct app_timebase *tb, int64_t ticks)
+{
+    atomic_val_t seq;
+    int64_t ref_ticks, ref_epoch_us;
+    uint32_t scale;
+
+    do {
+        seq = atomic_get(&tb->seq);
+        barrier_dmem_fence_full();
+        ref_ticks = tb->ref_ticks;
+        ref_epoch_us = tb->ref_epoch_us;
+        scale = tb->scale_q24;
+        barrier_dmem_fence_full();
+    } while ((seq & 1) || seq != atomic_get(&tb->seq));
+
+    // split the product so long intervals between updates cannot overflow
+    int64_t delta = ticks - ref_ticks;
+    uint64_t mag = delta < 0 ? -delta : delta;
+    uint64_t us = (mag >> 24) * scale + (((mag & 0xFFFFFF) * scale) >> 24);
+
+    return delta < 0 ? ref_epoch_us - (int64_t)us : ref_epoch_us + (int64_t)us;
+}
+
+//  ========== app_timebase_uptime_us_to_epoch_us ==========================================
+// same for an uptime in microseconds (e.g. a hardware-captured sample instant): the sub-tick
+// remainder is added at the nominal rate, the frequency error on it is negligible
+int64_t app_timebase_uptime_us_to_epoch_us(const struct app_timebase *tb, int64_t uptime_us)
+{
+    int64_t ticks = k_us_to_ticks_floor64(uptime_us);
+
+    return app_timebase_ticks_to_us(tb, ticks) + (uptime_us - k_ticks_to_us_floor64(ticks));
+}
+
+//  ========== app_timebase_now_us =========================================================
+// current wall-clock time in microseconds, interpolated between reference updates
+uint64_t app_timebase_now_us(const struct app_timebase *tb)
+{
+    int64_t us = app_timebase_ticks_to_us(tb, k_uptime_ticks());
+
+    return us < 0 ? 0 : (uint64_t)us;
+}
+
+//  ========== app_timebase_now_ms =========================================================
+// current wall-clock time in milliseconds
+uint64_t app_timebase_now_ms(const struct app_timebase *tb)
+{
+    return app_timebase_now_us(tb) / 1000;
+}
+
+#if defined(CONFIG_APP_BENCH)
+//  ========== app_timebase_bench ==========================================================
+// measure the average cost of a timestamp read with the cycle counter
+void app_timebase_bench(const char *name, uint64_t (*get_time)(void), uint32_t iterations)
+{
+    volatile uint64_t sink;
+    timing_t start, end;
+    uint64_t cycles;
+
+    if (iterations == 0) {
+        return;
+    }
+
+    timing_init();
+    timing_start();
+    start = timing_counter_get();
+    for (uint32_t i = 0; i < iterations; i++) {
+        sink = get_time();
+    }
+    end = timing_counter_get();
+    timing_stop();
+    (void)sink;
+
+    cycles = timing_cycles_get(&start, &end);
+    printk("%s: %u reads, %u cycles/read, %u ns/read\n", name, iterations,
+           (uint32_t)(cycles / iterations),
+           (uint32_t)(timing_cycles_to_ns(cycles) / iterations));
+}
+#endif
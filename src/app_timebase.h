@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_TIMEBASE_H
+#define APP_TIMEBASE_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <stdint.h>
+
+//  ========== defines =====================================================================
+// nominal length of a kernel tick in microseconds, Q8.24 fixed point
+#define TIMEBASE_NOMINAL_SCALE_Q24  ((uint32_t)((1000000ULL << 24) / CONFIG_SYS_CLOCK_TICKS_PER_SECOND))
+
+//  ========== globals =====================================================================
+// linear model mapping kernel ticks to wall-clock time:
+//   epoch_us = ref_epoch_us + (ticks - ref_ticks) * scale_q24 / 2^24
+// published through a sequence lock: readers never block and can run from the
+// acquisition hot path or from an ISR
+struct app_timebase {
+    atomic_t seq;               // odd while an update is in progress
+    int64_t ref_ticks;
+    int64_t ref_epoch_us;
+    uint32_t scale_q24;         // microseconds per tick, disciplined against the reference
+};
+
+#define APP_TIMEBASE_INITIALIZER    { .seq = ATOMIC_INIT(0), .ref_ticks = 0, \
+                                      .ref_epoch_us = 0, .scale_q24 = TIMEBASE_NOMINAL_SCALE_Q24 }
+
+//  ========== prototypes ==================================================================
+void app_timebase_publish(struct app_timebase *tb, int64_t ref_ticks, int64_t ref_epoch_us,
+                          uint32_t scale_q24);
+void app_timebase_publish_offset(struct app_timebase *tb, int64_t offset_ms);
+int64_t app_timebase_ticks_to_us(const struct app_timebase *tb, int64_t ticks);
+int64_t app_timebase_uptime_us_to_epoch_us(const struct app_timebase *tb, int64_t uptime_us);
+uint64_t app_timebase_now_us(const struct app_timebase *tb);
+uint64_t app_timebase_now_ms(const struct app_timebase *tb);
+#if defined(CONFIG_APP_BENCH)
+void app_timebase_bench(const char *name, uint64_t (*get_time)(void), uint32_t iterations);
+#endif
+
+#endif /* APP_TIMEBASE_H */
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_tlm_codec.h"
+#include <errno.h>
+#include <string.h>
+
+//  ========== defines =====================================================================
+// every delta is written with a prefix code, sized for slowly changing values:
+//   0              -> delta is zero
+//   10  + 4 bits   -> delta in [-8, 7]
+//   110 + 8 bits   -> delta in [-128, 127]
+//   111 + 16 bits  -> delta in [-32768, 32767]
+#define TLM_FIELDS              4           // delta-of-delta time, vbat, temp, hum
+
+//  ========== bw_init =====================================================================
+void bw_init(struct bit_writer *bw, uint8_t *buf, uint32_t cap_bits)
+{
+    bw->buf = buf;
+    bw->cap = cap_bits;
+    bw->pos = 0;
+}
+
+//  ========== bw_put ======================================================================
+// append the nbits least significant bits of val, most significant bit first
+int bw_put(struct bit_writer *bw, uint32_t val, uint8_t nbits)
+{
+    if (nbits > 32 || bw->pos + nbits > bw->cap) {
+        return -ENOSPC;
+    }
+
+    while (nbits > 0) {
+        uint32_t byte = bw->pos >> 3;
+        uint8_t used = bw->pos & 7;
+        uint8_t room = 8 - used;
+        uint8_t take = nbits < room ? nbits : room;
+        uint8_t chunk = (val >> (nbits - take)) & ((1u << take) - 1);
+
+        if (used == 0) {
+            bw->buf[byte] = 0;
+        }
+        bw->buf[byte] |= chunk << (room - take);
+        bw->pos += take;
+        nbits -= take;
+    }
+    return 0;
+}
+
+//  ========== br_init =====================================================================
+void br_init(struct bit_reader *br, const uint8_t *buf, uint32_t len_bits)
+{
+    br->buf = buf;
+    br->len = len_bits;
+    br->pos = 0;
+}
+
+//  ========== br_get ======================================================================
+int br_get(struct bit_reader *br, uint8_t nbits, uint32_t *val)
+{
+    uint32_t out = 0;
+
+    if (nbits > 32 || br->pos + nbits > br->len) {
+        return -EINVAL;
+    }
+
+    while (nbits > 0) {
+        uint8_t used = br->pos & 7;
+        uint8_t room = 8 - used;
+        uint8_t take = nbits < room ? nbits : room;
+        uint8_t chunk = (br->buf[br->pos >> 3] >> (room - take)) & ((1u << take) - 1);
+
+        out = (out << take) | chunk;
+        br->pos += take;
+        nbits -= take;
+    }
+    *val = out;
+    return 0;
+}
+
+//  ========== br_get_signed ===============================================================
+// read a two's complement value of nbits and sign-extend it
+int br_get_signed(struct bit_reader *br, uint8_t nbits, int32_t *val)
+{
+    uint32_t raw;
+    int ret = br_get(br, nbits, &raw);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (nbits < 32 && (raw & (1u << (nbits - 1)))) {
+        raw |= ~((1u << nbits) - 1);
+    }
+    *val = (int32_t)raw;
+    return 0;
+}
+
+//  ========== tlm_crc16 ===================================================================
+// CRC-16/CCITT (poly 0x1021), same result as Zephyr crc16_ccitt()
+uint16_t tlm_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+//  ========== delta helpers ===============================================================
+// number of bits needed to store a delta, 0 if it does not fit the code
+static uint8_t delta_bits(int32_t d)
+{
+    if (d == 0) {
+        return 1;
+    }
+    if (d >= -8 && d <= 7) {
+        return 2 + 4;
+    }
+    if (d >= -128 && d <= 127) {
+        return 3 + 8;
+    }
+    if (d >= -32768 && d <= 32767) {
+        return 3 + 16;
+    }
+    return 0;
+}
+
+static void delta_put(struct bit_writer *bw, int32_t d)
+{
+    if (d == 0) {
+        bw_put(bw, 0x0, 1);
+    } else if (d >= -8 && d <= 7) {
+        bw_put(bw, 0x2, 2);
+        bw_put(bw, (uint32_t)d, 4);
+    } else if (d >= -128 && d <= 127) {
+        bw_put(bw, 0x6, 3);
+        bw_put(bw, (uint32_t)d, 8);
+    } else {
+        bw_put(bw, 0x7, 3);
+        bw_put(bw, (uint32_t)d, 16);
+    }
+}
+
+static int delta_get(struct bit_reader *br, int32_t *d)
+{
+    uint32_t bit;
+    uint8_t width = 16;
+    int ret;
+
+    if ((ret = br_get(br, 1, &bit)) < 0) {
+        return ret;
+    }
+    if (bit == 0) {
+        *d = 0;
+        return 0;
+    }
+    if ((ret = br_get(br, 1, &bit)) < 0) {
+        return ret;
+    }
+    if (bit == 0) {
+        width = 4;
+    } else {
+        if ((ret = br_get(br, 1, &bit)) < 0) {
+            return ret;
+        }
+        width = (bit == 0) ? 8 : 16;
+    }
+    return br_get_signed(br, width, d);
+}
+
+//  ========== tlm_encoder_start ===========================================================
+// open a new block in the caller buffer (TLM_BLOCK_SIZE bytes, 4-byte aligned)
+void tlm_encoder_start(struct tlm_encoder *enc, uint8_t *block, uint32_t seq, const struct vth *base)
+{
+    struct tlm_block_hdr *hdr = (struct tlm_block_hdr *)block;
+
+    memset(block, 0, TLM_BLOCK_SIZE);
+    hdr->magic = TLM_BLOCK_MAGIC;
+    hdr->version = TLM_BLOCK_VERSION;
+    hdr->seq = seq;
+    hdr->base_ts = base->ts;
+    hdr->base_vbat = base->vbat;
+    hdr->base_temp = base->temp;
+    hdr->base_hum = base->hum;
+    hdr->count = 1;
+
+    enc->block = block;
+    enc->prev = *base;
+    enc->prev_dt = 0;
+    bw_init(&enc->bw, block + TLM_HDR_SIZE, TLM_PAYLOAD_BITS);
+}
+
+//  ========== tlm_encoder_append ==========================================================
+// append one record as deltas to the previous one
+// returns -ENOSPC when the block is full and -ERANGE when a delta cannot be coded:
+// in both cases nothing is written and the caller starts a new block with this record
+int tlm_encoder_append(struct tlm_encoder *enc, const struct vth *rec)
+{
+    struct tlm_block_hdr *hdr = (struct tlm_block_hdr *)enc->block;
+    int32_t dt = (int32_t)(rec->ts - enc->prev.ts);
+    int32_t d[TLM_FIELDS] = {
+        dt - enc->prev_dt,
+        rec->vbat - enc->prev.vbat,
+        rec->temp - enc->prev.temp,
+        rec->hum - enc->prev.hum,
+    };
+    uint32_t need = 0;
+
+    // timestamps must not go backwards inside a block
+    if (rec->ts < enc->prev.ts) {
+        return -ERANGE;
+    }
+
+    for (int i = 0; i < TLM_FIELDS; i++) {
+        uint8_t bits = delta_bits(d[i]);
+        if (bits == 0) {
+            return -ERANGE;
+        }
+        need += bits;
+    }
+
+    if (hdr->count == UINT16_MAX || enc->bw.pos + need > enc->bw.cap) {
+        return -ENOSPC;
+    }
+
+    for (int i = 0; i < TLM_FIELDS; i++) {
+        delta_put(&enc->bw, d[i]);
+    }
+
+    hdr->count++;
+    enc->prev = *rec;
+    enc->prev_dt = dt;
+    return 0;
+}
+
+//  ========== tlm_encoder_finish ==========================================================
+// seal the block: payload length and CRC, the block is then ready to be programmed
+void tlm_encoder_finish(struct tlm_encoder *enc)
+{
+    struct tlm_block_hdr *hdr = (struct tlm_block_hdr *)enc->block;
+    uint16_t crc;
+
+    hdr->bits = (uint16_t)enc->bw.pos;
+    hdr->crc = 0;
+    crc = tlm_crc16(0xFFFF, enc->block, TLM_HDR_SIZE + (enc->bw.pos + 7) / 8);
+    hdr->crc = crc;
+}
+
+//  ========== tlm_encoder_count ===========================================================
+uint16_t tlm_encoder_count(const struct tlm_encoder *enc)
+{
+    return ((const struct tlm_block_hdr *)enc->block)->count;
+}
+
+//  ========== tlm_block_check =============================================================
+// validate a sealed block, returns 0 if magic, version, size and CRC are consistent
+int tlm_block_check(const uint8_t *block)
+{
+    struct tlm_block_hdr hdr;
+    uint16_t crc;
+
+    memcpy(&hdr, block, sizeof(hdr));
+    if (hdr.magic != TLM_BLOCK_MAGIC || hdr.version != TLM_BLOCK_VERSION) {
+        return -ENOENT;
+    }
+    if (hdr.count == 0 || hdr.bits > TLM_PAYLOAD_BITS) {
+        return -EINVAL;
+    }
+
+    crc = tlm_crc16(0xFFFF, block, offsetof(struct tlm_block_hdr, crc));
+    crc = tlm_crc16(crc, (const uint8_t *)"\0\0", sizeof(hdr.crc));
+    crc = tlm_crc16(crc, block + offsetof(struct tlm_block_hdr, crc) + sizeof(hdr.crc),
+                    TLM_HDR_SIZE - offsetof(struct tlm_block_hdr, crc) - sizeof(hdr.crc) +
+                    (hdr.bits + 7) / 8);
+    return crc == hdr.crc ? 0 : -EBADMSG;
+}
+
+//  ========== tlm_block_used ==============================================================
+// number of meaningful bytes of a sealed block (header and used payload)
+size_t tlm_block_used(const uint8_t *block)
+{
+    struct tlm_block_hdr hdr;
+
+    memcpy(&hdr, block, sizeof(hdr));
+    return TLM_HDR_SIZE + (hdr.bits + 7) / 8;
+}
+
+//  ========== tlm_block_decode ============================================================
+// decode up to max records of a sealed block, returns the number of records or an error
+int tlm_block_decode(const uint8_t *block, struct vth *out, size_t max)
+{
+    struct tlm_block_hdr hdr;
+    struct bit_reader br;
+    struct vth cur;
+    int32_t dt = 0;
+    size_t n = 0;
+    int ret = tlm_block_check(block);
+
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(&hdr, block, sizeof(hdr));
+
+    cur.ts = hdr.base_ts;
+    cur.vbat = hdr.base_vbat;
+    cur.temp = hdr.base_temp;
+    cur.hum = hdr.base_hum;
+    br_init(&br, block + TLM_HDR_SIZE, hdr.bits);
+
+    while (n < max && n < hdr.count) {
+        if (n > 0) {
+            int32_t d[TLM_FIELDS];
+            for (int i = 0; i < TLM_FIELDS; i++) {
+                if ((ret = delta_get(&br, &d[i])) < 0) {
+                    return ret;
+                }
+            }
+            dt += d[0];
+            cur.ts += dt;
+            cur.vbat += d[1];
+            cur.temp += d[2];
+            cur.hum += d[3];
+        }
+        out[n++] = cur;
+    }
+    return (int)n;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_TLM_CODEC_H
+#define APP_TLM_CODEC_H
+
+// this codec is plain C (no Zephyr dependency) so host tools can build it as well
+
+//  ========== includes ====================================================================
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//  ========== defines =====================================================================
+#define TLM_BLOCK_SIZE          256         // 16 blocks per 4 KB flash sector
+#define TLM_BLOCK_MAGIC         0x7E1E
+#define TLM_BLOCK_VERSION       1
+#define TLM_HDR_SIZE            sizeof(struct tlm_block_hdr)
+#define TLM_PAYLOAD_BITS        ((TLM_BLOCK_SIZE - TLM_HDR_SIZE) * 8)
+
+//  ========== globals =====================================================================
+// one telemetry record: timestamp (epoch seconds), battery, temperature and humidity
+struct vth {
+    uint32_t ts;
+    int16_t vbat;
+    int16_t temp;
+    int16_t hum;
+};
+
+// block header: the base record is stored in full, the following records as deltas
+struct tlm_block_hdr {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  reserved;
+    uint32_t seq;           // block sequence number, monotonic across the ring
+    uint32_t base_ts;
+    int16_t  base_vbat;
+    int16_t  base_temp;
+    int16_t  base_hum;
+    uint16_t count;         // number of records in the block, base record included
+    uint16_t bits;          // number of payload bits used by the delta entries
+    uint16_t crc;           // CRC-16/CCITT over header (crc = 0) and used payload
+};
+
+// bit stream helpers, MSB first
+struct bit_writer {
+    uint8_t *buf;
+    uint32_t cap;           // capacity in bits
+    uint32_t pos;           // write position in bits
+};
+
+struct bit_reader {
+    const uint8_t *buf;
+    uint32_t len;           // length in bits
+    uint32_t pos;           // read position in bits
+};
+
+// block encoder state, the block itself lives in a caller-supplied buffer
+struct tlm_encoder {
+    uint8_t *block;
+    struct bit_writer bw;
+    struct vth prev;
+    int32_t prev_dt;
+};
+
+//  ========== prototypes ==================================================================
+void bw_init(struct bit_writer *bw, uint8_t *buf, uint32_t cap_bits);
+int bw_put(struct bit_writer *bw, uint32_t val, uint8_t nbits);
+void br_init(struct bit_reader *br, const uint8_t *buf, uint32_t len_bits);
+int br_get(struct bit_reader *br, uint8_t nbits, uint32_t *val);
+int br_get_signed(struct bit_reader *br, uint8_t nbits, int32_t *val);
+
+uint16_t tlm_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+void tlm_encoder_start(struct tlm_encoder *enc, uint8_t *block, uint32_t seq, const struct vth *base);
+int tlm_encoder_append(struct tlm_encoder *enc, const struct vth *rec);
+void tlm_encoder_finish(struct tlm_encoder *enc);
+uint16_t tlm_encoder_count(const struct tlm_encoder *enc);
+
+int tlm_block_check(const uint8_t *block);
+size_t tlm_block_used(const uint8_t *block);
+int tlm_block_decode(const uint8_t *block, struct vth *out, size_t max);
+
+#endif /* APP_TLM_CODEC_H */
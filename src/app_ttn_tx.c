@@ -9,63 +9,223 @@
 #include "app_lorawan.h"
 #include "app_adc.h"
 #include "app_rtc.h"
+#include "app_ds3231.h"
+#include "app_power.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include "app_buf.h"
+#include "app_log.h"
+#include <string.h>
+
+LOG_MODULE_REGISTER(app_lorawan, CONFIG_APP_LORAWAN_LOG_LEVEL);
 
 //  ========== defines =====================================================================
-#define TIMESTAMP_SIZE 8
-#define ADC_BUFFER_OFFSET TIMESTAMP_SIZE
+#define TX_STACK_SIZE           1024    // frames live in pool buffers, not on this stack
+#define TX_PRIORITY             3
+#define FRAG_RETRIES            5       // per fragment, duty cycle or busy MAC
+#define FRAG_RETRY_DELAY        K_SECONDS(10)
 
 //  ========== globals =====================================================================
-// define a stack for the LoRaWAN thread with a size of 1024 bytes
-K_THREAD_STACK_DEFINE(lorawan_stack, 1024);
+K_THREAD_STACK_DEFINE(lorawan_stack, TX_STACK_SIZE);
 
 // declare a thread structure to manage the LoRaWAN thread's data
 struct k_thread lorawan_thread_data;
 
-//  ========== serialize_uint64_to_bytes ===================================================
-static void serialize_uint64_to_bytes(uint64_t value, uint8_t *buffer)
+// uplink frames and event windows waiting for the radio, in submission order
+K_FIFO_DEFINE(uplink_fifo);
+
+// sequence number of the event windows, lets the ingest side group fragments and the
+// gateway match a trigger frame with its window; shared by the detector and the recorder
+static atomic_t window_seq;
+
+//  ========== app_lorawan_send ============================================================
+// every uplink goes through here: battery load window, TX metrics, energy ledger and
+// the check of a restored session; waits while the node is not joined
+int app_lorawan_send(uint8_t port, uint8_t *data, uint8_t len)
 {
-    for (int i = 0; i < 8; i++) {
-        buffer[i] = (value >> (56 - 8 * i)) & 0xFF;
+    (void)app_lorawan_wait_joined(K_FOREVER);
+
+    int64_t start = k_uptime_get();
+
+    app_power_load_begin();
+    int ret = lorawan_send(port, data, len, app_lorawan_uplink_type());
+    app_power_load_end();
+    app_metrics_hist(METRIC_HIST_TX_MS, (uint32_t)(k_uptime_get() - start));
+    app_lorawan_uplink_done(ret);
+
+    if (ret < 0) {
+        app_metrics_inc(METRIC_LORAWAN_TX_FAIL);
+        return ret;
     }
+    app_metrics_inc(METRIC_LORAWAN_TX_OK);
+    app_energy_tx(len);
+    return 0;
 }
 
-//  ========== app_lorawan_thread ==========================================================
-// LoRaWAN thread function: handles ADC data acquisition and sends it over LoRaWAN
-static void app_lorawan_thread(void *arg1, void *arg2, void *arg3) 
+//  ========== app_lorawan_queue ===========================================================
+// hand a filled pool buffer to the TX thread, which owns it from now on
+void app_lorawan_queue(struct net_buf *buf, uint8_t port)
+{
+    app_buf_meta(buf)->port = port;
+    k_fifo_put(&uplink_fifo, buf);
+}
+
+//  ========== app_lorawan_queue_window ====================================================
+// queue a filled event window (app_buf_window_alloc) under the next sequence number
+void app_lorawan_queue_window(struct net_buf *buf)
 {
-    // allocate a buffer for ADC data with additional space for the timestamp
-    uint8_t data[ADC_BUFFER_SIZE * sizeof(uint16_t) + 8];
+    app_buf_meta(buf)->seq = (uint8_t)atomic_inc(&window_seq);
+    app_lorawan_queue(buf, LORAWAN_WAVEFORM_PORT);
+}
 
-    // initialize DS3231 RTC device via I2C (Pins: SDA -> P0.09, SCL -> P0.0)
-    const struct device *rtc = DEVICE_DT_GET_ONE(maxim_ds3231);
+//  ========== send_fragments ==============================================================
+// send an event window as payload-sized fragments, in place: the header of fragment i is
+// written over the tail of fragment i - 1, already sent, and over the reserved headroom
+// for the first one, so the samples are never copied
+static int send_fragments(struct net_buf *buf, uint8_t port, uint8_t seq)
+{
+    uint8_t max_next, max_payload;
 
+    lorawan_get_payload_sizes(&max_next, &max_payload);
+    if (max_next <= UPLINK_FRAG_HDR_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    size_t frag = max_next - UPLINK_FRAG_HDR_SIZE;
+    size_t count = DIV_ROUND_UP(buf->len, frag);
+    if (count > UINT8_MAX + 1) {
+        return -EMSGSIZE;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *hdr = buf->data + i * frag - UPLINK_FRAG_HDR_SIZE;
+        size_t len = MIN(frag, buf->len - i * frag);
+        int ret;
+
+        struct uplink_waveform_fragment h = { .seq = seq, .index = (uint8_t)i, .count = count };
+        (void)uplink_waveform_fragment_encode(&h, hdr, UPLINK_FRAG_HDR_SIZE);
+
+        for (int attempt = 0; ; attempt++) {
+            ret = app_lorawan_send(port, hdr, len + UPLINK_FRAG_HDR_SIZE);
+            if (ret != -EAGAIN || attempt == FRAG_RETRIES) {
+                break;
+            }
+            k_sleep(FRAG_RETRY_DELAY);
+        }
+        if (ret < 0) {
+            LOG_ERR("fragment %zu/%zu of window %u failed: %d", i, count, seq, ret);
+            return ret;
+        }
+    }
+    LOG_DBG("window %u sent in %zu fragments", seq, count);
+    return 0;
+}
+
+//  ========== app_lorawan_thread ==========================================================
+// LoRaWAN thread function: the only user of the radio, sends queued buffers in order;
+// started at boot, what is queued before the join goes out once joined
+static void app_lorawan_thread(void *arg1, void *arg2, void *arg3)
+{
     while (1) {
-        // retrieve the current timestamp
-        uint64_t timestamp = app_rtc_get_time();
-        //uint64_t timestamp = app_ds3231_get_time();
-        
-        // serialize timestamp into the data buffer
-        serialize_uint64_to_bytes(timestamp, data);
-
-        // suspend the thread, effectively pausing it until explicitly resumed
-        k_thread_suspend(k_current_get());
-        printk("sending timestamp and velocity...\n");
-
-        // acquire ADC data into the buffer
-        app_adc_get_buffer((uint16_t *)&data[ADC_BUFFER_OFFSET], ADC_BUFFER_SIZE, 0);
-
-        // transmit the data over LoRaWAN
-        lorawan_send(LORAWAN_PORT, data, sizeof(data), LORAWAN_MSG_UNCONFIRMED);
-        printk("data sent to LoRaWAN\n");
+        struct net_buf *buf = k_fifo_get(&uplink_fifo, K_FOREVER);
+        struct uplink_meta *meta = app_buf_meta(buf);
+        int ret;
+
+        if (meta->fragmented) {
+            ret = send_fragments(buf, meta->port, meta->seq);
+        } else {
+            ret = app_lorawan_send(meta->port, buf->data, buf->len);
+        }
+        if (ret < 0) {
+            LOG_ERR("lorawan_send failed on port %u: %d", meta->port, ret);
+        }
+        if (meta->done) {
+            k_sem_give(meta->done);
+        }
+
+        // back to its pool
+        net_buf_unref(buf);
     }
 }
 
+//  ========== queue_trigger ===============================================================
+// trigger frame: onset time and detector state in 11 bytes, queued ahead of the window so
+// the gateway can associate the event across nodes without waiting for the fragments
+static void queue_trigger(uint8_t seq, int64_t onset_us, uint16_t ratio_x10, uint16_t sta)
+{
+    struct net_buf *buf = app_buf_uplink_alloc(K_NO_WAIT);
+    if (!buf) {
+        APP_LOG_RATELIMIT(LOG_WRN, 10000, "no free uplink buffer, trigger dropped");
+        return;
+    }
+
+    // wall-clock time (ms) of the onset, current time if the sample is not timestamped
+    uint64_t onset_ms = onset_us < 0 ? app_ds3231_get_time() :
+                        (uint64_t)(app_ds3231_uptime_us_to_epoch_us(onset_us) / 1000);
+
+    struct uplink_trigger trg = {
+        .seq = seq,
+        .time = (uint32_t)(onset_ms / 1000),
+        .ms = (uint16_t)(onset_ms % 1000),
+        .timed = onset_us >= 0,
+        .ratio = ratio_x10,
+        .sta = sta,
+    };
+    int len = uplink_trigger_encode(&trg, net_buf_tail(buf), net_buf_tailroom(buf));
+    if (len < 0) {
+        net_buf_unref(buf);
+        return;
+    }
+    net_buf_add(buf, len);
+    app_lorawan_queue(buf, LORAWAN_TRIGGER_PORT);
+}
+
 //  ========== app_lorawan_trigger_tx ======================================================
-// function to trigger the LoRaWAN thread to resume execution.
-void app_lorawan_trigger_tx(void)
+// called on event detection with the uptime (us) of the triggering sample, -1 if unknown:
+// queues the trigger frame and returns the sequence number reserved for the event window
+uint8_t app_lorawan_trigger_tx(int64_t onset_us, uint16_t ratio_x10, uint16_t sta)
+{
+    uint8_t seq = (uint8_t)atomic_inc(&window_seq);
+
+    // a few bytes per event, sent whatever the power policy
+    queue_trigger(seq, onset_us, ratio_x10, sta);
+    return seq;
+}
+
+//  ========== app_lorawan_window_tx =======================================================
+// queue the event window of a trigger: ADC_BUFFER_SIZE samples with the uptime (us) of the
+// first, -1 if unknown, or the current ADC ring when samples is NULL
+void app_lorawan_window_tx(uint8_t seq, const uint16_t *samples, int64_t t0_us)
 {
-    // resume the suspended LoRaWAN thread, allowing it to execute.
-    k_thread_resume(&lorawan_thread_data);
+    // waveform uplinks are the first thing dropped when the battery runs low
+    if (!app_power_waveforms_enabled()) {
+        return;
+    }
+
+    // the caller must not block: drop the window when both are still in flight
+    struct net_buf *buf = app_buf_window_alloc(K_NO_WAIT);
+    if (!buf) {
+        APP_LOG_RATELIMIT(LOG_WRN, 10000, "no free window buffer, event dropped");
+        return;
+    }
+
+    uint8_t *ts = net_buf_add(buf, UPLINK_WINDOW_TS_SIZE);
+    uint16_t *dest = net_buf_add(buf, ADC_BUFFER_SIZE * sizeof(uint16_t));
+
+    if (samples) {
+        memcpy(dest, samples, ADC_BUFFER_SIZE * sizeof(uint16_t));
+    } else {
+        // acquire ADC data into the buffer with the hardware timestamp of its first sample
+        t0_us = app_adc_get_buffer_ts(dest, ADC_BUFFER_SIZE, 0);
+    }
+
+    // wall-clock time (ms) of the window start, current time if it is not known
+    uint64_t timestamp = t0_us < 0 ? app_ds3231_get_time() :
+                         (uint64_t)(app_ds3231_uptime_us_to_epoch_us(t0_us) / 1000);
+    uplink_put_be64(timestamp, ts);
+
+    app_buf_meta(buf)->seq = seq;
+    app_lorawan_queue(buf, LORAWAN_WAVEFORM_PORT);
 }
 
 //  ========== app_lorawan_start ===========================================================
@@ -74,5 +234,7 @@ int app_lorawan_start_tx(void)
 {
     // create the LoRaWAN thread with the defined stack and function
     k_thread_create(&lorawan_thread_data, lorawan_stack, K_THREAD_STACK_SIZEOF(lorawan_stack),
-                    app_lorawan_thread, NULL, NULL, NULL, 3, 0, K_NO_WAIT);
-}
\ No newline at end of file
+                    app_lorawan_thread, NULL, NULL, NULL, TX_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&lorawan_thread_data, "lorawan_tx");
+    return 0;
+}
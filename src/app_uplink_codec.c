@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_uplink_codec.h"
+#include <errno.h>
+
+//  ========== byte order helpers ==========================================================
+void uplink_put_be64(uint64_t value, uint8_t *buf)
+{
+    for (int i = 0; i < 8; i++) {
+        buf[i] = (value >> (56 - 8 * i)) & 0xFF;
+    }
+}
+
+uint64_t uplink_get_be64(const uint8_t *buf)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+//  ========== uplink_window_decode ========================================================
+// split a reassembled window into its start time and up to max samples,
+// returns the number of samples or an error
+int uplink_window_decode(const uint8_t *buf, size_t len, uint64_t *ts_ms, uint16_t *samples,
+                         size_t max)
+{
+    if (len < UPLINK_WINDOW_TS_SIZE || (len - UPLINK_WINDOW_TS_SIZE) % 2 != 0) {
+        return -EMSGSIZE;
+    }
+
+    size_t n = (len - UPLINK_WINDOW_TS_SIZE) / 2;
+    const uint8_t *p = buf + UPLINK_WINDOW_TS_SIZE;
+
+    *ts_ms = uplink_get_be64(buf);
+    n = n < max ? n : max;
+    for (size_t i = 0; i < n; i++) {
+        samples[i] = (uint16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+    }
+    return (int)n;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_UPLINK_CODEC_H
+#define APP_UPLINK_CODEC_H
+
+// uplink frame helpers, plain C shared with the host tools (tools/ingest); the bit-packed
+// frames themselves are generated from tools/codegen/uplink_schema.json (uplink_schema.h)
+
+//  ========== includes ====================================================================
+#include <stdint.h>
+#include <stddef.h>
+#include "uplink_schema.h"
+
+//  ========== defines =====================================================================
+// application ports of the records that are not in the schema (they carry their own
+// version byte)
+#define UPLINK_PORT_HEALTH      3       // app_metrics_encode
+#define UPLINK_PORT_ENERGY      4       // app_energy_encode
+
+// every waveform fragment is a schema header then a slice of the window:
+// window start time (epoch ms, big-endian) followed by the samples (uint16, little-endian)
+#define UPLINK_FRAG_HDR_SIZE    UPLINK_WAVEFORM_FRAGMENT_MAX_SIZE
+#define UPLINK_WINDOW_TS_SIZE   8
+
+//  ========== prototypes ==================================================================
+void uplink_put_be64(uint64_t value, uint8_t *buf);
+uint64_t uplink_get_be64(const uint8_t *buf);
+
+int uplink_window_decode(const uint8_t *buf, size_t len, uint64_t *ts_ms, uint16_t *samples,
+                         size_t max);
+
+#endif /* APP_UPLINK_CODEC_H */
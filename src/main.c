@@ -11,13 +11,29 @@
 #include "app_adc.h"
 #include "app_eeprom.h"
 #include "app_rtc.h"
+#include "app_sched.h"
+#include "app_power.h"
+#include "app_metrics.h"
+#include "app_energy.h"
+#include "app_buf.h"
+#include "app_sta_lta.h"
+#include "app_recorder.h"
+#include "app_psd.h"
+#include "app_classifier.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(main, CONFIG_APP_LORAWAN_LOG_LEVEL);
 
 //  ========== defines =====================================================================
-#define STACK_SIZE			2048
-#define PRIORITY_RTC		2
-#define PRIORITY_LORAWAN	3
+#define CLOCK_SYNC_PERIOD_MS	(60 * 1000)
+#define BATTERY_PERIOD_MS		(60 * 1000)
+#define TELEMETRY_PERIOD_MS		(60 * 1000)		// 1 min -> test
+#define FLASH_LOG_PERIOD_MS		(60 * 1000)
+#define FLASH_FLUSH_PERIOD_MS	(60 * 60 * 1000)
+#define HEALTH_PERIOD_MS		(6 * 60 * 60 * 1000)
+#define DETECTOR_SAVE_PERIOD_MS	(10 * 60 * 1000)	// detector checkpoint to flash
 
 //  ========== globals =====================================================================
 // define GPIO specifications for the LEDs used to indicate transmission (TX) and reception (RX)
@@ -28,137 +44,193 @@ static void dl_callback(uint8_t port, bool data_pending,
 			int16_t rssi, int8_t snr,
 			uint8_t len, const uint8_t *hex_data)
 {
-	printk("Port %d, Pending %d, RSSI %ddB, SNR %ddBm\n", port, data_pending, rssi, snr);
+	LOG_DBG("Port %d, Pending %d, RSSI %ddB, SNR %ddBm", port, data_pending, rssi, snr);
+
+	if (port == LORAWAN_COMMAND_PORT && len > 0) {
+		(void)app_recorder_command(hex_data, len);
+	}
 }
 
-// thread to have a periodic sync
-bool rtc_thread_flag = true;
-void rtc_thread_func(void)
+// kept by the LoRaWAN stack, so not on the stack of main
+static struct lorawan_downlink_cb downlink_cb = {
+	.port = LW_RECV_PORT_ANY,
+	.cb = dl_callback
+};
+
+// periodic jobs, all run from the app_sched work queue: jobs due within each other's
+// tolerance share one wake-up
+static void clock_sync_job(struct app_job *job)
 {
-	printk("periodic sync thread started\n");
+	(void)app_ds3231_periodic_sync(DS3231_I2C_BUS);
+}
 
-	const struct device *rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc0));
-	const struct device *ds3231_dev = DEVICE_DT_GET_ONE(maxim_ds3231);
+static void battery_job(struct app_job *job)
+{
+	(void)app_power_update();
+}
 
-	while (rtc_thread_flag == true) {
-        printk("performing periodic action\n");
-        //(void)app_rtc_periodic_sync(rtc_dev);
-		(void)app_ds3231_periodic_sync(ds3231_dev);
-        k_sleep(K_SECONDS(60));		
-	}
+static void telemetry_job(struct app_job *job)
+{
+	// send battery level, temperature and humidity
+	(void)app_sensors_handler();
+}
+
+static void flash_log_job(struct app_job *job)
+{
+	(void)app_flash_handler(DEVICE_DT_GET(SHT31_NODE));
+}
+
+static void flash_flush_job(struct app_job *job)
+{
+	(void)app_flash_flush();
 }
-K_THREAD_DEFINE(rtc_thread_id, STACK_SIZE, rtc_thread_func, NULL, NULL, NULL, PRIORITY_RTC, 0, 0);
 
-// thread to send environment value when no activity
-bool lorawan_thread_flag = true;
-void lorawan_thread_func(void)
+static void detector_save_job(struct app_job *job)
 {
-	printk("LoRaWAN thread started\n");
-    while (lorawan_thread_flag == true) {
-        printk("performing periodic action\n");
-		// perform your task: get battery level, temperature and humidity
-        (void)app_sensors_handler();	
-        k_sleep(K_SECONDS(60));		// sleep for 1 min -> test
-    }
+	// the retained RAM copy does not survive a power loss
+	(void)app_sta_lta_save();
 }
-K_THREAD_DEFINE(lorawan_thread_id, STACK_SIZE, lorawan_thread_func, NULL, NULL, NULL, PRIORITY_LORAWAN, 0, 0);
 
-static void lorwan_datarate_changed(enum lorawan_datarate dr)
+static void health_job(struct app_job *job)
 {
-	uint8_t unused, max_size;
+	struct net_buf *buf;
+
+	// counters, latency histograms and thread statistics (see app_metrics_encode)
+	(void)app_metrics_send_health();
+
+	// charge per subsystem and airtime per data rate (see app_energy_encode)
+	buf = app_buf_uplink_alloc(K_NO_WAIT);
+	if (buf) {
+		net_buf_add(buf, app_energy_encode(net_buf_tail(buf), net_buf_tailroom(buf)));
+		app_lorawan_queue(buf, LORAWAN_ENERGY_PORT);
+	}
+
+	// background noise band levels averaged since the last health report (see app_psd.c)
+	(void)app_psd_send();
+}
+
+static APP_JOB_DEFINE(clock_sync, "clock sync", clock_sync_job, CLOCK_SYNC_PERIOD_MS, 10000);
+static APP_JOB_DEFINE(battery, "battery", battery_job, BATTERY_PERIOD_MS, 30000);
+static APP_JOB_DEFINE(telemetry, "telemetry", telemetry_job, TELEMETRY_PERIOD_MS, 10000);
+static APP_JOB_DEFINE(flash_log, "flash log", flash_log_job, FLASH_LOG_PERIOD_MS, 10000);
+static APP_JOB_DEFINE(flash_flush, "flash flush", flash_flush_job, FLASH_FLUSH_PERIOD_MS, 600000);
+static APP_JOB_DEFINE(health, "health", health_job, HEALTH_PERIOD_MS, 600000);
+static APP_JOB_DEFINE(detector_save, "detector save", detector_save_job, DETECTOR_SAVE_PERIOD_MS,
+		      60000);
+
+// RTC, DS3231 and SHT31 share the I2C bus: brought up in order on the system work queue
+// while main brings up the flash devices
+K_SEM_DEFINE(i2c_boot_done, 0, 1);
+
+static void i2c_boot(struct k_work *work)
+{
+	// initialize DS3231 RTC device via I2C (Pins: SDA -> P0.09, SCL -> P0.0)
+	if (!app_rtc_init()) {
+		LOG_ERR("failed to initialize RTC device");
+	}
+
+	// start the DS3231 clock discipline on its 1 Hz square-wave output
+	if (!app_ds3231_init()) {
+		LOG_ERR("failed to initialize DS3231 device");
+	}
+
+	// initialize the SHT31 and start its first conversion
+	if (app_sht31_init(DEVICE_DT_GET(SHT31_NODE)) < 0) {
+		LOG_ERR("failed to initialize SHT31 device");
+	}
+	k_sem_give(&i2c_boot_done);
+}
 
-	lorawan_get_payload_sizes(&unused, &max_size);
-	printk("New Datarate: DR_%d, Max Payload %d\n", dr, max_size);
+static K_WORK_DEFINE(i2c_boot_work, i2c_boot);
+
+// run by the LoRaWAN join thread once the session is usable, again after a rejoin
+static void lorawan_joined(void)
+{
+	app_sched_register(&telemetry, K_NO_WAIT);
+	app_sched_register(&health, K_MINUTES(10));
 }
 
 //  ========== main ========================================================================
+// parallel boot: acquisition and detection first, then the network join in the background,
+// the I2C devices on the system work queue and the flash devices here; events detected
+// before the join wait in the uplink queue
 int8_t main(void)
 {
-	const struct device *dev;
 	int8_t ret;
 
-	printk("Initializtion of all Hardware Devices\n");
+	LOG_INF("Initializtion of all Hardware Devices");
 
 	// initialize ADC device
 	ret = app_nrf52_adc_init();
 	if (ret != 1) {
-		printk("failed to initialize ADC device\n");
+		LOG_ERR("failed to initialize ADC device");
 		return 0;
 	}
 
+#if defined(CONFIG_APP_BENCH)
+	// measure the detector cost per sample of each mode, before the detector thread that
+	// shares its buffers
+	app_sta_lta_bench(CONFIG_APP_BENCH_STA_LTA_SAMPLES);
+#endif
+
+	// start the ADC sampling and STA/LTA threads, nothing else is needed to detect; the
+	// detector resumes from its checkpoint after a reset
+	app_adc_sampling_start();
+	app_sta_lta_start();
+	LOG_INF("acquisition running %lld ms after reset", k_uptime_get());
+
+	// noise spectrum for the health reports, in idle time only
+	app_psd_start();
+
+	// classifies closed events and holds back the windows of the classes not of interest;
+	// after app_psd_start, it shares its FFT
+	app_classifier_start();
+
+	// the uplink thread holds the queued frames until the network is joined
+	app_lorawan_start_tx();
+
+	// start LoRaWAN: restores the persisted session or joins over OTAA, in the background
+	ret = app_lorawan_init(&downlink_cb, lorawan_joined);
+	if (ret != 1) {
+		LOG_ERR("failed to initialize LoRaWAN");
+	}
+
+	k_work_submit(&i2c_boot_work);
+
 	// initialize partition flash memory
 	ret = app_flash_init();
 	if (ret != 1) {
-		printk("failed to initialize internal Flash device\n");
-		return 0;
+		LOG_ERR("failed to initialize internal Flash device");
 	}
 
-	// initialize the EEPROM device
+	// initialize the EEPROM device, then locate the head of the raw-data ring
 	const struct device *eeprom_dev = DEVICE_DT_GET(SPI_FLASH_DEVICE);
 	ret = app_eeprom_init(eeprom_dev);
 	if (ret != 1) {
-		printk("failed to initialize QSPI flash device\n");
-		return 0;
-	}
-
-	// initialize DS3231 RTC device via I2C (Pins: SDA -> P0.09, SCL -> P0.0)
-	const struct device *rtc_dev = app_rtc_init();
-    if (!rtc_dev) {
-        printk("failed to initialize RTC device\n");
-        return 0;
-    }
-
-	// initialize LoRaWAN protocol and register the device
-	const struct device *lora_dev;
-	struct lorawan_join_config join_cfg;
-	uint8_t dev_eui[] = LORAWAN_DEV_EUI;
-	uint8_t join_eui[] = LORAWAN_JOIN_EUI;
-	uint8_t app_key[] = LORAWAN_APP_KEY;
-
-	struct lorawan_downlink_cb downlink_cb = {
-		.port = LW_RECV_PORT_ANY,
-		.cb = dl_callback
-	};
-
-	lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0));
-	if (!device_is_ready(lora_dev)) {
-		printk("%s: device not ready\n", lora_dev->name);
-		return 0;
-	}
-
-	ret = lorawan_start();
-	if (ret < 0) {
-		printk("lorawan_start failed: %d", ret);
-		return 0;
+		LOG_ERR("failed to initialize QSPI flash device");
+	} else if (app_recorder_init(eeprom_dev) != 1) {
+		LOG_ERR("failed to initialize raw-data recorder");
+	} else {
+		app_recorder_start();
 	}
 
-	lorawan_register_downlink_callback(&downlink_cb);
-	lorawan_register_dr_changed_callback(lorwan_datarate_changed);
-
-	join_cfg.mode = LORAWAN_ACT_OTAA;
-	join_cfg.dev_eui = dev_eui;
-	join_cfg.otaa.join_eui = join_eui;
-	join_cfg.otaa.app_key = app_key;
-	join_cfg.otaa.nwk_key = app_key;
-	join_cfg.otaa.dev_nonce = 0u;
+	// the battery model adapts the telemetry period to the state of charge
+	app_power_init(&telemetry);
 
-	printk("Joining network over OTAA\n");
-	ret = lorawan_join(&join_cfg);
-	if (ret < 0) {
-		printk("lorawan_join_network failed: %d\n", ret);
-		return 0;
-	}
+	// periodic jobs that do not depend on LoRaWAN, the clock and SHT31 must be up
+	k_sem_take(&i2c_boot_done, K_FOREVER);
+	app_sched_register(&battery, K_NO_WAIT);
+	app_sched_register(&clock_sync, K_SECONDS(60));
+	app_sched_register(&flash_log, K_SECONDS(60));
+	app_sched_register(&flash_flush, K_HOURS(1));
+	app_sched_register(&detector_save, K_MINUTES(1));
 
-	printk("Geophone Measurement and Process Information\n");
+#if defined(CONFIG_APP_BENCH)
+	// measure the cost of a timestamp read
+	app_timebase_bench("ds3231 get_time", app_ds3231_get_time,
+			   CONFIG_APP_BENCH_TIMEBASE_ITERATIONS);
+#endif
 
-	// enable environmental sensor and battery level thread
-	lorawan_thread_flag = false;
-
-	// enable periodic rtc sync thread
-	rtc_thread_flag = true;
-
-	// start ADC sampling and STA/LTA threads
-	app_adc_sampling_start();
-  app_sta_lta_start();
+	LOG_INF("boot completed in %lld ms", k_uptime_get());
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT maxim_ds3231
+
+//  ========== includes ====================================================================
+#include "sim.h"
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/sys/timeutil.h>
+#include <string.h>
+#include <time.h>
+
+//  ========== defines =====================================================================
+#define DS3231_EMUL_REGS        0x13
+#define DS3231_EMUL_CONTROL     0x0E
+#define DS3231_EMUL_INTCN       BIT(2)      // 1: interrupt output, 0: square wave on SQW
+
+//  ========== globals =====================================================================
+// register file; the time registers follow uptime from epoch_base, the SQW pin is toggled
+// every 500 ms so its active (low) edge falls on the emulated second boundaries
+struct ds3231_emul_data {
+    uint8_t regs[DS3231_EMUL_REGS];
+    uint8_t ptr;
+    int64_t epoch_base;         // epoch seconds at uptime 0
+    struct k_timer sqw_timer;
+    bool sqw_low;
+};
+
+static const struct gpio_dt_spec sqw_gpio = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), ds3231_sqw_gpios);
+
+//  ========== bcd helpers =================================================================
+static uint8_t bin2bcd(uint8_t val)
+{
+    return ((val / 10) << 4) | (val % 10);
+}
+
+static uint8_t bcd2bin(uint8_t val)
+{
+    return (val >> 4) * 10 + (val & 0x0F);
+}
+
+//  ========== time registers ==============================================================
+static void ds3231_emul_load_time(struct ds3231_emul_data *data)
+{
+    time_t now = (time_t)(data->epoch_base + k_uptime_get() / 1000);
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    data->regs[0] = bin2bcd(tm.tm_sec);
+    data->regs[1] = bin2bcd(tm.tm_min);
+    data->regs[2] = bin2bcd(tm.tm_hour);
+    data->regs[3] = tm.tm_wday + 1;
+    data->regs[4] = bin2bcd(tm.tm_mday);
+    data->regs[5] = bin2bcd(tm.tm_mon + 1);
+    data->regs[6] = bin2bcd(tm.tm_year - 100);
+}
+
+static void ds3231_emul_store_time(struct ds3231_emul_data *data)
+{
+    struct tm tm = {
+        .tm_sec = bcd2bin(data->regs[0] & 0x7F),
+        .tm_min = bcd2bin(data->regs[1] & 0x7F),
+        .tm_hour = bcd2bin(data->regs[2] & 0x3F),
+        .tm_mday = bcd2bin(data->regs[4] & 0x3F),
+        .tm_mon = bcd2bin(data->regs[5] & 0x1F) - 1,
+        .tm_year = bcd2bin(data->regs[6]) + 100,
+    };
+
+    data->epoch_base = timeutil_timegm64(&tm) - k_uptime_get() / 1000;
+}
+
+//  ========== square wave =================================================================
+static void ds3231_emul_sqw(struct k_timer *timer)
+{
+    struct ds3231_emul_data *data = CONTAINER_OF(timer, struct ds3231_emul_data, sqw_timer);
+
+    data->sqw_low = !data->sqw_low;
+    gpio_emul_input_set(sqw_gpio.port, sqw_gpio.pin, data->sqw_low ? 0 : 1);
+}
+
+static void ds3231_emul_control(struct ds3231_emul_data *data)
+{
+    if (data->regs[DS3231_EMUL_CONTROL] & DS3231_EMUL_INTCN) {
+        k_timer_stop(&data->sqw_timer);
+        return;
+    }
+
+    // first active edge on the next whole second
+    data->sqw_low = false;
+    gpio_emul_input_set(sqw_gpio.port, sqw_gpio.pin, 1);
+    k_timer_start(&data->sqw_timer, K_MSEC(1000 - k_uptime_get() % 1000), K_MSEC(500));
+}
+
+//  ========== ds3231_emul_transfer ========================================================
+// the first byte written after a START or repeated START is the register pointer, the
+// pointer auto-increments and wraps like on the device
+static int ds3231_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+                                int addr)
+{
+    struct ds3231_emul_data *data = target->data;
+    bool time_written = false;
+    bool control_written = false;
+
+    ds3231_emul_load_time(data);
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+        size_t j = 0;
+
+        if ((msg->flags & I2C_MSG_RW_MASK) == I2C_MSG_READ) {
+            for (; j < msg->len; j++) {
+                msg->buf[j] = data->regs[data->ptr];
+                data->ptr = (data->ptr + 1) % DS3231_EMUL_REGS;
+            }
+            continue;
+        }
+
+        if ((i == 0 || (msg->flags & I2C_MSG_RESTART)) && msg->len > 0) {
+            data->ptr = msg->buf[j++] % DS3231_EMUL_REGS;
+        }
+        for (; j < msg->len; j++) {
+            data->regs[data->ptr] = msg->buf[j];
+            time_written |= data->ptr <= 6;
+            control_written |= data->ptr == DS3231_EMUL_CONTROL;
+            data->ptr = (data->ptr + 1) % DS3231_EMUL_REGS;
+        }
+    }
+
+    if (time_written) {
+        ds3231_emul_store_time(data);
+    }
+    if (control_written) {
+        ds3231_emul_control(data);
+    }
+    return 0;
+}
+
+static const struct i2c_emul_api ds3231_emul_api = {
+    .transfer = ds3231_emul_transfer,
+};
+
+//  ========== ds3231_emul_init ============================================================
+static int ds3231_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct ds3231_emul_data *data = target->data;
+
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[DS3231_EMUL_CONTROL] = 0x1C;     // power-on value: INTCN set, SQW off
+    data->epoch_base = SIM_DS3231_EPOCH;
+    k_timer_init(&data->sqw_timer, ds3231_emul_sqw, NULL);
+    return 0;
+}
+
+// the emulator binds to the device of the node: with the counter driver off (native_sim.conf)
+// the node gets an empty device, the application talks to the DS3231 over raw I2C anyway
+#if !defined(CONFIG_COUNTER_MAXIM_DS3231)
+#define DS3231_EMUL_DEVICE(n)                                                   \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,               \
+                          CONFIG_COUNTER_INIT_PRIORITY, NULL);
+#else
+#define DS3231_EMUL_DEVICE(n)
+#endif
+
+#define DS3231_EMUL(n)                                                          \
+    DS3231_EMUL_DEVICE(n)                                                       \
+    static struct ds3231_emul_data ds3231_emul_data_##n;                        \
+    EMUL_DT_INST_DEFINE(n, ds3231_emul_init, &ds3231_emul_data_##n, NULL,       \
+                        &ds3231_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(DS3231_EMUL)
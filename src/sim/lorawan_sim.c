@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "sim.h"
+#include "../app_energy.h"
+#include <zephyr/lorawan/lorawan.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(lorawan_sim, CONFIG_APP_LORAWAN_LOG_LEVEL);
+
+//  ========== globals =====================================================================
+// LoRaWAN stand-in for native_sim (CONFIG_LORAWAN=n): the join succeeds at once, uplinks
+// are checked against the EU868 payload limit of the current data rate and the 1 % duty
+// cycle, take their time on air, then are kept in a small log for inspection
+static const uint8_t max_payload[ENERGY_DR_COUNT] = { 51, 51, 51, 115, 222, 222 };
+
+static K_MUTEX_DEFINE(sim_lock);
+static uint8_t datarate = SIM_LORAWAN_DR;
+static int64_t next_tx_ms = 0;
+static struct sim_frame frames[SIM_LORAWAN_LOG];
+static uint32_t frame_count = 0;
+static struct sim_lorawan_stats stats;
+static lorawan_dr_changed_cb_t dr_changed_cb;
+
+//  ========== lorawan_start ===============================================================
+int lorawan_start(void)
+{
+    return 0;
+}
+
+//  ========== lorawan_join ================================================================
+int lorawan_join(const struct lorawan_join_config *config)
+{
+    LOG_INF("sim: joined (DR%d)", datarate);
+    if (dr_changed_cb) {
+        dr_changed_cb((enum lorawan_datarate)datarate);
+    }
+    return 0;
+}
+
+//  ========== lorawan_set_datarate ========================================================
+int lorawan_set_datarate(enum lorawan_datarate dr)
+{
+    if (dr >= ENERGY_DR_COUNT) {
+        return -EINVAL;
+    }
+
+    datarate = dr;
+    if (dr_changed_cb) {
+        dr_changed_cb(dr);
+    }
+    return 0;
+}
+
+//  ========== lorawan_get_payload_sizes ===================================================
+void lorawan_get_payload_sizes(uint8_t *max_next_payload_size, uint8_t *max_payload_size)
+{
+    *max_next_payload_size = max_payload[datarate];
+    *max_payload_size = max_payload[datarate];
+}
+
+//  ========== callbacks ===================================================================
+void lorawan_register_downlink_callback(struct lorawan_downlink_cb *cb)
+{
+    // no downlinks in the simulation
+}
+
+void lorawan_register_dr_changed_callback(lorawan_dr_changed_cb_t cb)
+{
+    dr_changed_cb = cb;
+}
+
+//  ========== lorawan_send ================================================================
+int lorawan_send(uint8_t port, uint8_t *data, uint8_t len, enum lorawan_message_type type)
+{
+    struct sim_frame *frame;
+    uint32_t airtime;
+
+    k_mutex_lock(&sim_lock, K_FOREVER);
+    if (len > max_payload[datarate]) {
+        stats.too_large++;
+        k_mutex_unlock(&sim_lock);
+        LOG_ERR("sim: %u byte frame over the DR%d limit (%u)", len, datarate,
+                max_payload[datarate]);
+        return -EMSGSIZE;
+    }
+
+    if (k_uptime_get() < next_tx_ms) {
+        stats.duty_cycle++;
+        k_mutex_unlock(&sim_lock);
+        return -EAGAIN;
+    }
+
+    airtime = app_energy_airtime_us(datarate, len);
+    next_tx_ms = k_uptime_get() + (int64_t)airtime * SIM_LORAWAN_DUTY_CYCLE / 1000;
+
+    frame = &frames[frame_count++ % SIM_LORAWAN_LOG];
+    frame->uptime_ms = k_uptime_get();
+    frame->port = port;
+    frame->dr = datarate;
+    frame->len = len;
+    frame->airtime_us = airtime;
+    memcpy(frame->data, data, len);
+    stats.sent++;
+    stats.airtime_us += airtime;
+    k_mutex_unlock(&sim_lock);
+
+    LOG_DBG("sim: uplink port %u, %u bytes, DR%d, %u ms on air", port, len, datarate,
+            airtime / 1000);
+
+    // the caller blocks for the transmission like with the real stack
+    k_sleep(K_USEC(airtime));
+    return 0;
+}
+
+//  ========== sim_lorawan_get_stats =======================================================
+void sim_lorawan_get_stats(struct sim_lorawan_stats *out)
+{
+    k_mutex_lock(&sim_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&sim_lock);
+}
+
+//  ========== sim_lorawan_get_frame =======================================================
+// copy a logged uplink, age 0 is the newest; -ENOENT if not (or no longer) in the log
+int sim_lorawan_get_frame(uint32_t age, struct sim_frame *frame)
+{
+    int ret = -ENOENT;
+
+    k_mutex_lock(&sim_lock, K_FOREVER);
+    if (age < frame_count && age < SIM_LORAWAN_LOG) {
+        *frame = frames[(frame_count - 1 - age) % SIM_LORAWAN_LOG];
+        ret = 0;
+    }
+    k_mutex_unlock(&sim_lock);
+    return ret;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT sensirion_sht3xd
+
+//  ========== includes ====================================================================
+#include "sim.h"
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+//  ========== defines =====================================================================
+#define SHT31_EMUL_CMD_FETCH    0xE000      // periodic mode fetch (SHT3xD driver)
+#define SHT31_EMUL_CMD_STATUS   0xF32D
+
+//  ========== globals =====================================================================
+// every measurement command makes a sample available, a read without one is NACKed
+struct sht31_emul_data {
+    uint8_t out[6];
+    uint8_t out_len;
+};
+
+static atomic_t sim_temp = ATOMIC_INIT(SIM_SHT31_TEMP);
+static atomic_t sim_hum = ATOMIC_INIT(SIM_SHT31_HUM);
+
+//  ========== sht31_emul_crc8 =============================================================
+static uint8_t sht31_emul_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void sht31_emul_word(uint8_t *out, uint16_t word)
+{
+    sys_put_be16(word, out);
+    out[2] = sht31_emul_crc8(out, 2);
+}
+
+//  ========== sim_sht31_set ===============================================================
+// values returned by the following measurements (°C x 100, %RH x 100)
+void sim_sht31_set(int16_t temp, int16_t hum)
+{
+    atomic_set(&sim_temp, temp);
+    atomic_set(&sim_hum, hum);
+}
+
+//  ========== sht31_emul_transfer =========================================================
+static int sht31_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+                               int addr)
+{
+    struct sht31_emul_data *data = target->data;
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if ((msg->flags & I2C_MSG_RW_MASK) == I2C_MSG_READ) {
+            if (data->out_len < msg->len) {
+                return -EIO;
+            }
+            memcpy(msg->buf, data->out, msg->len);
+            data->out_len = 0;
+            continue;
+        }
+
+        if (msg->len < 2) {
+            continue;
+        }
+
+        uint16_t cmd = sys_get_be16(msg->buf);
+        if (cmd == SHT31_EMUL_CMD_STATUS) {
+            sht31_emul_word(data->out, 0x0000);
+            data->out_len = 3;
+        } else if ((cmd >> 8) == 0x24 || (cmd >> 8) == 0x2C || cmd == SHT31_EMUL_CMD_FETCH) {
+            // single shot (with or without clock stretching) or periodic fetch
+            int32_t temp = atomic_get(&sim_temp);
+            int32_t hum = atomic_get(&sim_hum);
+            sht31_emul_word(&data->out[0], (uint16_t)(((temp + 4500) * 65535) / 17500));
+            sht31_emul_word(&data->out[3], (uint16_t)((hum * 65535) / 10000));
+            data->out_len = 6;
+        }
+    }
+    return 0;
+}
+
+static const struct i2c_emul_api sht31_emul_api = {
+    .transfer = sht31_emul_transfer,
+};
+
+//  ========== sht31_emul_init =============================================================
+static int sht31_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct sht31_emul_data *data = target->data;
+
+    data->out_len = 0;
+    return 0;
+}
+
+#define SHT31_EMUL(n)                                                           \
+    static struct sht31_emul_data sht31_emul_data_##n;                          \
+    EMUL_DT_INST_DEFINE(n, sht31_emul_init, &sht31_emul_data_##n, NULL,         \
+                        &sht31_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(SHT31_EMUL)
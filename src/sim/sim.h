@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+// native_sim stand-ins for the board peripherals, built only for native_sim
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+//  ========== defines =====================================================================
+#define SIM_BATTERY_MV          2800        // constant battery voltage on AIN1
+#define SIM_DS3231_EPOCH        1767225600  // DS3231 time at boot: 2026-01-01 00:00:00 UTC
+#define SIM_SHT31_TEMP          2150        // °C x 100
+#define SIM_SHT31_HUM           4500        // %RH x 100
+#define SIM_LORAWAN_DR          5           // data rate after join (EU868 DR5, SF7)
+#define SIM_LORAWAN_DUTY_CYCLE  100         // 1 % duty cycle: off time = 99 x airtime
+#define SIM_LORAWAN_LOG         16          // frames kept for inspection
+
+//  ========== globals =====================================================================
+// one uplink accepted by the LoRaWAN stand-in
+struct sim_frame {
+    int64_t uptime_ms;
+    uint8_t port;
+    uint8_t dr;
+    uint8_t len;
+    uint32_t airtime_us;
+    uint8_t data[222];
+};
+
+struct sim_lorawan_stats {
+    uint32_t sent;
+    uint32_t too_large;         // rejected: payload over the data rate limit
+    uint32_t duty_cycle;        // rejected: duty cycle off time not elapsed
+    uint64_t airtime_us;
+};
+
+//  ========== prototypes ==================================================================
+void sim_battery_set(uint32_t mv);
+void sim_sht31_set(int16_t temp, int16_t hum);
+void sim_lorawan_get_stats(struct sim_lorawan_stats *stats);
+int sim_lorawan_get_frame(uint32_t age, struct sim_frame *frame);
+
+#endif /* SIM_H */
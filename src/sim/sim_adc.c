@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "sim.h"
+#include <zephyr/init.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <string.h>
+
+//  ========== globals =====================================================================
+// waveform file embedded at build time (SIM_WAVEFORM in CMakeLists.txt), NUL terminated
+static const char waveform[] = {
+#include "sim_waveform.inc"
+    0
+};
+
+static const struct device *const adc_dev = DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(DT_PATH(zephyr_user)));
+static size_t pos = 0;
+
+// last Z samples, newest first, the horizontal components are derived from them
+static uint32_t z_hist[4];
+static bool z_primed = false;
+
+//  ========== waveform_next ===============================================================
+// next sample of the text file: one integer per line, '#' comments, loops at the end
+static int waveform_next(uint32_t *mv)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        while (waveform[pos] != '\0') {
+            if (waveform[pos] == '#') {
+                while (waveform[pos] != '\0' && waveform[pos] != '\n') {
+                    pos++;
+                }
+                continue;
+            }
+            if (waveform[pos] >= '0' && waveform[pos] <= '9') {
+                uint32_t v = 0;
+                while (waveform[pos] >= '0' && waveform[pos] <= '9') {
+                    v = v * 10 + (waveform[pos++] - '0');
+                }
+                *mv = v;
+                return 0;
+            }
+            pos++;
+        }
+        pos = 0;
+    }
+    return -ENODATA;
+}
+
+//  ========== geophone_value ==============================================================
+// called by the ADC emulator for every conversion of the geophone Z channel
+static int geophone_value(const struct device *dev, unsigned int chan, void *data,
+                          uint32_t *result)
+{
+    int ret = waveform_next(result);
+
+    if (ret == 0) {
+        // the first sample fills the history, no step on N and E at start
+        if (!z_primed) {
+            for (size_t i = 0; i < ARRAY_SIZE(z_hist); i++) {
+                z_hist[i] = *result;
+            }
+            z_primed = true;
+        }
+        memmove(&z_hist[1], &z_hist[0], sizeof(z_hist) - sizeof(z_hist[0]));
+        z_hist[0] = *result;
+    }
+    return ret;
+}
+
+//  ========== geophone_n_value and geophone_e_value =======================================
+// N and E follow Z in the same scan: N is Z three samples late, E the mean of the last
+// two Z samples, so that the three components differ but share the events of the file
+static int geophone_n_value(const struct device *dev, unsigned int chan, void *data,
+                            uint32_t *result)
+{
+    *result = z_hist[3];
+    return 0;
+}
+
+static int geophone_e_value(const struct device *dev, unsigned int chan, void *data,
+                            uint32_t *result)
+{
+    *result = (z_hist[0] + z_hist[1]) / 2;
+    return 0;
+}
+
+//  ========== sim_battery_set =============================================================
+void sim_battery_set(uint32_t mv)
+{
+    adc_emul_const_value_set(adc_dev, 1, mv);
+}
+
+//  ========== sim_adc_init ================================================================
+static int sim_adc_init(void)
+{
+    if (!device_is_ready(adc_dev)) {
+        return -ENODEV;
+    }
+
+    adc_emul_value_func_set(adc_dev, 0, geophone_value, NULL);
+    adc_emul_value_func_set(adc_dev, 2, geophone_n_value, NULL);
+    adc_emul_value_func_set(adc_dev, 3, geophone_e_value, NULL);
+    sim_battery_set(SIM_BATTERY_MV);
+    return 0;
+}
+SYS_INIT(sim_adc_init, APPLICATION, 0);
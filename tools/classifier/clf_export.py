@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+#
+# Event classifier export: writes src/app_classifier_model.h, the int8 decision-tree
+# ensemble run on each closed event by src/app_classifier.c, either from a model file
+#   --model FILE   trees as JSON (see default_model.json); "placeholder": true marks a model
+#                  not trained on field data, the node then sends every window
+# or by training a small random forest on labelled events
+#   --train FILE   events.csv of sixsens-ingest with the label column filled in by an
+#                  analyst (rockfall, creep, anthropogenic, weather or 0..3)
+# The features are the int8 values of the event frames, so a model trained on what the
+# nodes sent runs unchanged on the nodes. --save writes the trained trees as JSON.
+
+import argparse
+import csv
+import json
+import math
+import os
+import random
+import sys
+import textwrap
+
+FEATURES = ["duration", "peak_ratio", "peak_sta", "rise", "hv", "freq"] + \
+           [f"onset{b}" for b in range(6)] + [f"coda{b}" for b in range(6)]
+CLASSES = ["rockfall", "creep", "anthropogenic", "weather"]
+VOTE_MAX = 127
+
+# flash of one node and one vote row, see struct clf_node
+NODE_SIZE = 6
+LEAF_SIZE = len(CLASSES)
+
+
+#  ========== training ====================================================================
+def gini(counts, n):
+    return 1.0 - sum((c / n) ** 2 for c in counts) if n else 0.0
+
+
+def best_split(rows, labels, idx, features, min_leaf):
+    """best (feature, threshold) by Gini impurity, x <= threshold going left"""
+    n = len(idx)
+    parent = [0] * len(CLASSES)
+    for i in idx:
+        parent[labels[i]] += 1
+    best = None
+    best_score = gini(parent, n)
+    for f in features:
+        order = sorted(idx, key=lambda i: rows[i][f])
+        left = [0] * len(CLASSES)
+        for k in range(n - 1):
+            left[labels[order[k]]] += 1
+            v, nxt = rows[order[k]][f], rows[order[k + 1]][f]
+            if v == nxt or k + 1 < min_leaf or n - k - 1 < min_leaf:
+                continue
+            right = [p - l for p, l in zip(parent, left)]
+            score = ((k + 1) * gini(left, k + 1) + (n - k - 1) * gini(right, n - k - 1)) / n
+            if score < best_score - 1e-12:
+                best_score, best = score, (f, v)
+    return best
+
+
+def leaf(labels, idx):
+    counts = [0] * len(CLASSES)
+    for i in idx:
+        counts[labels[i]] += 1
+    return {"votes": [round(VOTE_MAX * c / len(idx)) for c in counts]}
+
+
+def grow(rows, labels, idx, depth, args, rng):
+    if depth == args.depth or len(idx) < 2 * args.min_leaf or len({labels[i] for i in idx}) == 1:
+        return leaf(labels, idx)
+    features = rng.sample(range(len(FEATURES)), args.max_features)
+    split = best_split(rows, labels, idx, features, args.min_leaf)
+    if split is None:
+        return leaf(labels, idx)
+    f, t = split
+    left = [i for i in idx if rows[i][f] <= t]
+    right = [i for i in idx if rows[i][f] > t]
+    return {"feature": FEATURES[f], "threshold": t,
+            "left": grow(rows, labels, left, depth + 1, args, rng),
+            "right": grow(rows, labels, right, depth + 1, args, rng)}
+
+
+def predict(tree, row):
+    while "votes" not in tree:
+        tree = tree["left"] if row[FEATURES.index(tree["feature"])] <= tree["threshold"] \
+            else tree["right"]
+    return tree["votes"]
+
+
+def load_events(path):
+    rows, labels = [], []
+    with open(path, newline="") as f:
+        for r in csv.DictReader(f):
+            label = (r.get("label") or "").strip().lower()
+            if not label:
+                continue
+            if label.isdigit():
+                label = int(label)
+            elif label in CLASSES:
+                label = CLASSES.index(label)
+            else:
+                sys.exit(f"{path}: unknown label {label!r}")
+            rows.append([int(r[name]) for name in FEATURES])
+            labels.append(label)
+    if not rows:
+        sys.exit(f"{path}: no labelled event")
+    return rows, labels
+
+
+def train(args):
+    rows, labels = load_events(args.train)
+    rng = random.Random(args.seed)
+    n = len(rows)
+    trees, oob = [], [[0] * len(CLASSES) for _ in range(n)]
+    for _ in range(args.trees):
+        sample = [rng.randrange(n) for _ in range(n)]
+        trees.append(grow(rows, labels, sample, 0, args, rng))
+        for i in set(range(n)) - set(sample):
+            oob[i] = [a + b for a, b in zip(oob[i], predict(trees[-1], rows[i]))]
+
+    scored = [i for i in range(n) if any(oob[i])]
+    if scored:
+        right = sum(1 for i in scored if oob[i].index(max(oob[i])) == labels[i])
+        print(f"out-of-bag accuracy {right / len(scored):.1%} on {len(scored)} events",
+              file=sys.stderr)
+    counts = ", ".join(f"{sum(1 for l in labels if l == c)} {name}"
+                       for c, name in enumerate(CLASSES))
+    return {"id": args.id, "trees": trees,
+            "comment": f"random forest trained on {os.path.basename(args.train)}: {counts}"}
+
+
+#  ========== export ======================================================================
+def flatten(model):
+    """nodes as (feature, threshold, left, right), leaves as vote rows, one root per tree"""
+    nodes, leaves, roots = [], [], []
+
+    def walk(tree):
+        i = len(nodes)
+        nodes.append(None)
+        if "votes" in tree:
+            votes = tree["votes"]
+            if len(votes) != len(CLASSES) or not all(-128 <= v <= VOTE_MAX for v in votes):
+                sys.exit(f"bad leaf votes {votes}")
+            nodes[i] = (-1, 0, len(leaves), 0)
+            leaves.append(votes)
+        else:
+            t = int(tree["threshold"])
+            if tree["feature"] not in FEATURES or not -128 <= t <= 127:
+                sys.exit(f"bad split {tree['feature']} <= {t}")
+            left = walk(tree["left"])
+            right = walk(tree["right"])
+            nodes[i] = (FEATURES.index(tree["feature"]), t, left, right)
+        return i
+
+    for tree in model["trees"]:
+        roots.append(walk(tree))
+    if len(nodes) > 0xFFFF:
+        sys.exit("more than 65535 nodes")
+    return nodes, leaves, roots
+
+
+def header(model, nodes, leaves, roots, source):
+    out = ["/*",
+           " * Copyright (c) 2025",
+           " * Regis Rousseau",
+           " * Univ Lyon, INSA Lyon, Inria, CITI, EA3720",
+           " * SPDX-License-Identifier: Apache-2.0",
+           " */",
+           "",
+           f"// generated by tools/classifier/clf_export.py from {source}, do not edit",
+           *textwrap.wrap(model.get("comment", ""), 89, initial_indent="// ",
+                          subsequent_indent="// "),
+           "",
+           "#ifndef APP_CLASSIFIER_MODEL_H",
+           "#define APP_CLASSIFIER_MODEL_H",
+           "",
+           f"#define CLF_MODEL_ID            {model['id']}",
+           f"#define CLF_MODEL_FEATURES      {len(FEATURES)}",
+           f"#define CLF_MODEL_CLASSES       {len(CLASSES)}",
+           f"#define CLF_MODEL_TREES         {len(roots)}",
+           f"#define CLF_MODEL_PLACEHOLDER   {int(bool(model.get('placeholder', False)))}"
+           "       // 1: not trained, no window held back",
+           "",
+           "// feature, threshold, left, right; a leaf has feature -1 and its vote row in left",
+           "static const struct clf_node clf_nodes[] = {"]
+    for i, (f, t, l, r) in enumerate(nodes):
+        line = f"    {{ {f}, {t}, {l}, {r} }},"
+        note = f"tree {roots.index(i)}" if i in roots else ""
+        if f >= 0:
+            note = f"{note}, {FEATURES[f]}" if note else FEATURES[f]
+        out.append(f"{line:<32}// {note}" if note else line)
+    out += ["};", "",
+            "static const uint16_t clf_roots[CLF_MODEL_TREES] = {",
+            "    " + ", ".join(str(r) for r in roots) + ",",
+            "};", "",
+            "// " + ", ".join(CLASSES),
+            "static const int8_t clf_leaves[][CLF_MODEL_CLASSES] = {"]
+    for votes in leaves:
+        out.append("    { " + ", ".join(str(v) for v in votes) + " },")
+    out += ["};", "", "#endif /* APP_CLASSIFIER_MODEL_H */", ""]
+    return "\n".join(out)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description="event classifier export")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("--model", help="model file (JSON), default_model.json by default")
+    source.add_argument("--train", help="labelled events.csv to train a random forest on")
+    parser.add_argument("--out", default=os.path.join(here, "..", "..", "src",
+                                                      "app_classifier_model.h"))
+    parser.add_argument("--save", help="write the trained model as JSON")
+    parser.add_argument("--id", type=int, default=2, help="model id sent in the event frames")
+    parser.add_argument("--trees", type=int, default=16)
+    parser.add_argument("--depth", type=int, default=5)
+    parser.add_argument("--min-leaf", type=int, default=3, help="events per leaf at least")
+    parser.add_argument("--max-features", type=int, default=round(math.sqrt(len(FEATURES))),
+                        help="features tried per split")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if args.train:
+        model = train(args)
+        src = os.path.basename(args.train)
+        if args.save:
+            with open(args.save, "w") as f:
+                json.dump(model, f, indent=1)
+                f.write("\n")
+    else:
+        path = args.model or f"{here}/default_model.json"
+        with open(path) as f:
+            model = json.load(f)
+        src = os.path.basename(path)
+    if not 0 <= int(model["id"]) <= 255:
+        sys.exit("model id must fit a byte")
+
+    nodes, leaves, roots = flatten(model)
+    with open(args.out, "w") as f:
+        f.write(header(model, nodes, leaves, roots, src))
+    print(f"{os.path.normpath(args.out)}: {len(roots)} trees, {len(nodes)} nodes, "
+          f"{len(nodes) * NODE_SIZE + len(leaves) * LEAF_SIZE + 2 * len(roots)} bytes of flash",
+          file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
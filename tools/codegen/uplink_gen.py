@@ -0,0 +1,329 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+#
+# Uplink codec generator: reads uplink_schema.json and writes
+#   --c-out DIR   uplink_schema.h / uplink_schema.c, encoders and decoders in plain C on
+#                 top of the bit stream helpers of app_tlm_codec.h (firmware and host tools)
+#   --js FILE     the TTN payload decoder (payload_decoder.js)
+# --js-check FILE fails when FILE is not what --js would write, the firmware build uses it
+# so the checked-in JavaScript decoder cannot drift from the schema.
+
+import argparse
+import json
+import os
+import sys
+
+HDR_BITS = 8        # message type (4 bits), version (4 bits)
+
+
+class Field:
+    def __init__(self, msg, d):
+        self.name = d["name"]
+        self.min = int(d["min"])
+        self.max = int(d["max"])
+        self.step = int(d.get("step", 1))
+        self.scale = d.get("scale")
+        self.unit = d.get("unit", "")
+        self.format = d.get("format")
+        self.optional = bool(d.get("optional", False))
+        self.comment = d.get("comment", "")
+        if self.max <= self.min or self.step < 1:
+            sys.exit(f"{msg}.{self.name}: bad range or step")
+        self.wire_max = -(-(self.max - self.min) // self.step)
+        self.bits = max(1, self.wire_max.bit_length())
+        if self.bits > 32:
+            sys.exit(f"{msg}.{self.name}: more than 32 bits")
+
+    @property
+    def ctype(self):
+        for t, lo, hi in (("uint8_t", 0, 0xFF), ("int8_t", -0x80, 0x7F),
+                          ("uint16_t", 0, 0xFFFF), ("int16_t", -0x8000, 0x7FFF),
+                          ("uint32_t", 0, 0xFFFFFFFF), ("int32_t", -0x80000000, 0x7FFFFFFF)):
+            if self.min >= lo and self.max <= hi:
+                return t
+        return "int64_t"
+
+
+class Message:
+    def __init__(self, d):
+        self.name = d["name"]
+        self.type = int(d["type"])
+        self.version = int(d["version"])
+        self.port = int(d["port"])
+        self.payload = d.get("payload")
+        self.fields = [Field(self.name, f) for f in d["fields"]]
+        if not 0 < self.type < 16 or not 0 < self.version < 16:
+            sys.exit(f"{self.name}: type and version must fit 4 bits")
+        self.optional = [f for f in self.fields if f.optional]
+        self.max_bits = HDR_BITS + len(self.optional) + sum(f.bits for f in self.fields)
+        self.min_bits = self.max_bits - sum(f.bits for f in self.optional)
+
+    @property
+    def upper(self):
+        return self.name.upper()
+
+
+def load(path):
+    with open(path) as f:
+        schema = json.load(f)
+    msgs = [Message(m) for m in schema["messages"]]
+    if len({m.type for m in msgs}) != len(msgs):
+        sys.exit("message types must be unique")
+    return msgs
+
+
+def banner(name):
+    return f"//  ========== {name} ".ljust(92, "=")
+
+
+#  ========== C ===========================================================================
+C_LICENSE = """/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// generated by tools/codegen/uplink_gen.py from uplink_schema.json, do not edit
+"""
+
+
+def define(name, value, comment=None):
+    line = f"#define {name:<36} {value}"
+    return f"{line:<48}// {comment}" if comment else line
+
+
+def c_header(msgs):
+    out = [C_LICENSE, "#ifndef UPLINK_SCHEMA_H", "#define UPLINK_SCHEMA_H", "",
+           banner("includes"), "#include <stdint.h>", "#include <stddef.h>",
+           "#include <stdbool.h>", "", banner("defines"),
+           define("UPLINK_HDR_SIZE", HDR_BITS // 8, "message type (4 bits), version (4 bits)")]
+    for m in msgs:
+        out += ["",
+                define(f"UPLINK_{m.upper}_TYPE", m.type),
+                define(f"UPLINK_{m.upper}_VERSION", m.version),
+                define(f"UPLINK_{m.upper}_PORT", m.port),
+                define(f"UPLINK_{m.upper}_MAX_SIZE", (m.max_bits + 7) // 8,
+                       "all optional fields present"),
+                define(f"UPLINK_{m.upper}_MIN_SIZE", (m.min_bits + 7) // 8)]
+    out += ["", banner("globals")]
+    for m in msgs:
+        if m.payload:
+            out.append(f"// followed by the {m.payload}")
+        out.append(f"struct uplink_{m.name} {{")
+        for f in m.fields:
+            decl = f"    {f.ctype} {f.name};"
+            out.append(f"{decl:<28}// {f.comment}" if f.comment else decl)
+        for f in m.optional:
+            out.append(f"    bool has_{f.name};")
+        out += ["};", ""]
+    out.append(banner("prototypes"))
+    out.append("int uplink_header_decode(const uint8_t *buf, size_t len, uint8_t *type, "
+               "uint8_t *version);")
+    for m in msgs:
+        out.append(f"int uplink_{m.name}_encode(const struct uplink_{m.name} *m, uint8_t *buf, "
+                   "size_t size);")
+        out.append(f"int uplink_{m.name}_decode(const uint8_t *buf, size_t len, "
+                   f"struct uplink_{m.name} *m);")
+    out += ["", "#endif /* UPLINK_SCHEMA_H */", ""]
+    return "\n".join(out)
+
+
+def c_source(msgs):
+    out = [C_LICENSE, banner("includes"), '#include "uplink_schema.h"',
+           '#include "app_tlm_codec.h"', "#include <errno.h>", "",
+           banner("helpers"),
+           "// clamp to the declared range and quantize",
+           "static uint32_t quantize(int64_t v, int64_t min, int64_t max, uint32_t step)",
+           "{",
+           "    v = v < min ? min : (v > max ? max : v);",
+           "    return (uint32_t)((v - min + step / 2) / step);",
+           "}",
+           "",
+           "//  ========== uplink_header_decode ".ljust(92, "="),
+           "int uplink_header_decode(const uint8_t *buf, size_t len, uint8_t *type, "
+           "uint8_t *version)",
+           "{",
+           "    if (len < UPLINK_HDR_SIZE) {",
+           "        return -EMSGSIZE;",
+           "    }",
+           "    *type = buf[0] >> 4;",
+           "    *version = buf[0] & 0x0F;",
+           "    return 0;",
+           "}"]
+
+    for m in msgs:
+        out += ["", banner(f"uplink_{m.name}_encode"),
+                "// returns the frame length in bytes, -ENOSPC if size is too small",
+                f"int uplink_{m.name}_encode(const struct uplink_{m.name} *m, uint8_t *buf, "
+                "size_t size)",
+                "{",
+                "    struct bit_writer bw;",
+                "",
+                "    bw_init(&bw, buf, size * 8);",
+                f"    if (bw_put(&bw, (UPLINK_{m.upper}_TYPE << 4) | "
+                f"UPLINK_{m.upper}_VERSION, {HDR_BITS}) < 0) {{",
+                "        return -ENOSPC;",
+                "    }"]
+        for f in m.optional:
+            out += [f"    if (bw_put(&bw, m->has_{f.name} ? 1 : 0, 1) < 0) {{",
+                    "        return -ENOSPC;", "    }"]
+        for f in m.fields:
+            put = (f"bw_put(&bw, quantize(m->{f.name}, {f.min}LL, {f.max}LL, {f.step}), "
+                   f"{f.bits})")
+            ind = "    "
+            if f.optional:
+                out.append(f"    if (m->has_{f.name}) {{")
+                ind = "        "
+            out += [f"{ind}if ({put} < 0) {{", f"{ind}    return -ENOSPC;", f"{ind}}}"]
+            if f.optional:
+                out.append("    }")
+        out += ["    return (int)((bw.pos + 7) / 8);", "}"]
+
+        out += ["", banner(f"uplink_{m.name}_decode"),
+                "// returns the number of bytes used by the fields, -ENOTSUP for another "
+                "message type",
+                "// or version, -EMSGSIZE if the frame is short and -EBADMSG on an out of range "
+                "value",
+                f"int uplink_{m.name}_decode(const uint8_t *buf, size_t len, "
+                f"struct uplink_{m.name} *m)",
+                "{",
+                "    struct bit_reader br;",
+                "    uint32_t v;",
+                "",
+                f"    if (len < UPLINK_HDR_SIZE || buf[0] != ((UPLINK_{m.upper}_TYPE << 4) | "
+                f"UPLINK_{m.upper}_VERSION)) {{",
+                "        return -ENOTSUP;",
+                "    }",
+                "    br_init(&br, buf + UPLINK_HDR_SIZE, (len - UPLINK_HDR_SIZE) * 8);"]
+        for f in m.optional:
+            out += ["    if (br_get(&br, 1, &v) < 0) {", "        return -EMSGSIZE;", "    }",
+                    f"    m->has_{f.name} = v != 0;"]
+        for f in m.fields:
+            ind = "    "
+            if f.optional:
+                out += [f"    m->{f.name} = 0;", f"    if (m->has_{f.name}) {{"]
+                ind = "        "
+            out += [f"{ind}if (br_get(&br, {f.bits}, &v) < 0) {{",
+                    f"{ind}    return -EMSGSIZE;", f"{ind}}}"]
+            if f.wire_max < (1 << f.bits) - 1:
+                out += [f"{ind}if (v > {f.wire_max}u) {{", f"{ind}    return -EBADMSG;",
+                        f"{ind}}}"]
+            value = f"v * {f.step}LL" if f.step != 1 else "(int64_t)v"
+            out.append(f"{ind}m->{f.name} = ({f.ctype})({f.min}LL + {value});")
+            if f.optional:
+                out.append("    }")
+        out += ["    return (int)(UPLINK_HDR_SIZE + (br.pos + 7) / 8);", "}"]
+    out.append("")
+    return "\n".join(out)
+
+
+#  ========== JavaScript ==================================================================
+JS_HEAD = """// TTN uplink decoder
+// generated by tools/codegen/uplink_gen.py from tools/codegen/uplink_schema.json,
+// do not edit: change the schema and run
+//   python3 tools/codegen/uplink_gen.py --js payload_decoder.js
+
+// bit reader, MSB first; arithmetic instead of bitwise operators, which work on 32 bits
+function readBits(bytes, state, n) {
+    var value = 0;
+    for (var i = 0; i < n; i++) {
+        var bit = (bytes[state.pos >> 3] >> (7 - (state.pos & 7))) & 1;
+        value = value * 2 + bit;
+        state.pos++;
+    }
+    return value;
+}
+"""
+
+
+def js_number(x):
+    return repr(x) if isinstance(x, float) else str(x)
+
+
+def js_decoder(msgs):
+    out = [JS_HEAD]
+    for m in msgs:
+        out += [f"function decode_{m.name}(bytes) {{",
+                f"    if (bytes.length * 8 < {m.min_bits}) {{",
+                f"        return {{ errors: [\"{m.name} frame too short\"] }};",
+                "    }",
+                "    var header = bytes[0];",
+                f"    if (header !== {(m.type << 4) | m.version}) {{",
+                f"        return {{ errors: [\"unsupported {m.name} type/version \" + header] }};",
+                "    }",
+                f"    var state = {{ pos: {HDR_BITS} }};",
+                "    var data = {};"]
+        for f in m.optional:
+            out.append(f"    var has_{f.name} = readBits(bytes, state, 1);")
+        for f in m.fields:
+            ind = "    "
+            if f.optional:
+                out.append(f"    if (has_{f.name}) {{")
+                ind = "        "
+            expr = f"readBits(bytes, state, {f.bits})"
+            if f.step != 1:
+                expr = f"{expr} * {f.step}"
+            if f.min != 0:
+                expr = f"{f.min} + {expr}"
+            if f.format == "epoch_s":
+                expr = f"new Date(({expr}) * 1000).toISOString()"
+            elif f.scale is not None:
+                expr = f"Math.round(({expr}) * {js_number(f.scale)} * 1e6) / 1e6"
+            unit = f"  // {f.unit}" if f.unit else ""
+            out.append(f"{ind}data.{f.name} = {expr};{unit}")
+            if f.optional:
+                out.append("    }")
+        if m.payload:
+            out += ["    // followed by the " + m.payload,
+                    "    data.payload_bytes = bytes.length - (state.pos + 7 >> 3);"]
+        out += ["    return { data: data };", "}", ""]
+
+    out += ["function decodeUplink(input) {",
+            "    switch (input.fPort) {"]
+    for m in msgs:
+        out += [f"    case {m.port}:", f"        return decode_{m.name}(input.bytes);"]
+    out += ["    default:",
+            "        // health (3) and energy (4) records are decoded by the ingest tool",
+            "        return { data: { port: input.fPort, bytes: input.bytes.length } };",
+            "    }",
+            "}",
+            ""]
+    return "\n".join(out)
+
+
+def write(path, text):
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def main():
+    here = __file__.rsplit("/", 1)[0] if "/" in __file__ else "."
+    parser = argparse.ArgumentParser(description="uplink codec generator")
+    parser.add_argument("--schema", default=f"{here}/uplink_schema.json")
+    parser.add_argument("--c-out", help="directory for uplink_schema.h and uplink_schema.c")
+    parser.add_argument("--js", help="write the TTN payload decoder")
+    parser.add_argument("--js-check", help="fail if this decoder is not up to date")
+    args = parser.parse_args()
+
+    msgs = load(args.schema)
+    if args.c_out:
+        os.makedirs(args.c_out, exist_ok=True)
+        write(f"{args.c_out}/uplink_schema.h", c_header(msgs))
+        write(f"{args.c_out}/uplink_schema.c", c_source(msgs))
+    if args.js:
+        write(args.js, js_decoder(msgs))
+    if args.js_check:
+        with open(args.js_check) as f:
+            if f.read() != js_decoder(msgs):
+                sys.exit(f"{args.js_check} does not match the uplink schema, regenerate it "
+                         "with tools/codegen/uplink_gen.py --js")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
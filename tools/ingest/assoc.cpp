@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "assoc.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace ingest {
+namespace {
+
+constexpr double EARTH_RADIUS_M = 6371000.0;
+constexpr double DEG = M_PI / 180.0;
+constexpr int LOCATE_ITERATIONS = 20;
+
+// one onset used by the location, relative to the first onset of the event
+struct Pick {
+    double x;
+    double y;
+    double t_s;
+    double w;       // untimed onsets (RTC only, no sample timestamp) count for less
+};
+
+// solve a * x = b in place for a 3x3 system, false if singular
+bool solve3(double a[3][3], double b[3])
+{
+    for (int col = 0; col < 3; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < 3; r++) {
+            if (std::fabs(a[r][col]) > std::fabs(a[pivot][col])) {
+                pivot = r;
+            }
+        }
+        if (std::fabs(a[pivot][col]) < 1e-12) {
+            return false;
+        }
+        std::swap(a[col], a[pivot]);
+        std::swap(b[col], b[pivot]);
+        for (int r = col + 1; r < 3; r++) {
+            double f = a[r][col] / a[col][col];
+            for (int c = col; c < 3; c++) {
+                a[r][c] -= f * a[col][c];
+            }
+            b[r] -= f * b[col];
+        }
+    }
+    for (int r = 2; r >= 0; r--) {
+        for (int c = r + 1; c < 3; c++) {
+            b[r] -= a[r][c] * b[c];
+        }
+        b[r] /= a[r][r];
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+bool parse_double(std::string_view s, double &out)
+{
+    std::string text(trim(s));
+    char *end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size();
+}
+
+} // namespace
+
+//  ========== Associator ==================================================================
+Associator::Associator(AssocOptions opt, std::vector<Station> stations, EventHandler handler)
+    : opt_(opt), stations_(std::move(stations)), handler_(std::move(handler))
+{
+    // local plane around the mean position, good enough over a few kilometres
+    for (const auto &s : stations_) {
+        if (s.located) {
+            lat0_ += s.lat;
+            lon0_ += s.lon;
+            located_++;
+        }
+    }
+    if (located_ > 0) {
+        lat0_ /= located_;
+        lon0_ /= located_;
+    }
+    for (uint32_t i = 0; i < stations_.size(); i++) {
+        Station &s = stations_[i];
+        if (s.located) {
+            s.x = (s.lon - lon0_) * DEG * EARTH_RADIUS_M * std::cos(lat0_ * DEG);
+            s.y = (s.lat - lat0_) * DEG * EARTH_RADIUS_M;
+        }
+        index_.emplace(s.device, i);
+    }
+}
+
+//  ========== station =====================================================================
+uint32_t Associator::station(std::string_view device)
+{
+    auto it = index_.find(std::string(device));
+    if (it != index_.end()) {
+        return it->second;
+    }
+
+    Station s;
+    s.device = std::string(device);
+    stations_.push_back(s);
+    uint32_t i = static_cast<uint32_t>(stations_.size() - 1);
+    index_.emplace(s.device, i);
+    return i;
+}
+
+//  ========== add =========================================================================
+void Associator::add(const Trigger &t)
+{
+    stats_.triggers++;
+
+    // beyond the latency its candidate may already be closed, and alarms are pointless
+    if (t.received_ms - t.onset_ms > opt_.latency_ms) {
+        stats_.late++;
+        advance(t.received_ms);
+        return;
+    }
+
+    Candidate *joined = nullptr;
+    for (auto &c : open_) {
+        auto same = std::find_if(c.triggers.begin(), c.triggers.end(),
+                                 [&](const Trigger &o) { return o.station == t.station; });
+        if (same != c.triggers.end()) {
+            if (same->seq == t.seq) {
+                stats_.duplicates++;
+                return;
+            }
+            continue;   // another trigger of this node, another event
+        }
+        int64_t span = std::max(c.last_ms, t.onset_ms) - std::min(c.first_ms, t.onset_ms);
+        if (span <= opt_.window_ms) {
+            joined = &c;
+            break;
+        }
+    }
+
+    if (!joined) {
+        open_.emplace_back();
+        joined = &open_.back();
+        joined->first_ms = t.onset_ms;
+        joined->last_ms = t.onset_ms;
+        stats_.candidates++;
+    }
+
+    Candidate &c = *joined;
+    auto pos = std::upper_bound(c.triggers.begin(), c.triggers.end(), t.onset_ms,
+                                [](int64_t ms, const Trigger &o) { return ms < o.onset_ms; });
+    c.triggers.insert(pos, t);
+    c.first_ms = std::min(c.first_ms, t.onset_ms);
+    c.last_ms = std::max(c.last_ms, t.onset_ms);
+
+    if (!c.confirmed && c.triggers.size() >= opt_.min_stations) {
+        c.confirmed = true;
+        c.id = next_id_++;
+        stats_.confirmed++;
+        emit(c, false, t.received_ms);
+    }
+
+    advance(t.received_ms);
+}
+
+//  ========== advance =====================================================================
+// a candidate is closed once any trigger that could still join it would be late
+void Associator::advance(int64_t now_ms)
+{
+    now_ms_ = std::max(now_ms_, now_ms);
+
+    for (auto it = open_.begin(); it != open_.end();) {
+        if (now_ms_ - it->first_ms <= opt_.window_ms + opt_.latency_ms) {
+            ++it;
+            continue;
+        }
+        if (it->confirmed) {
+            emit(*it, true, now_ms_);
+        } else {
+            stats_.rejected++;
+        }
+        it = open_.erase(it);
+    }
+}
+
+//  ========== finish ======================================================================
+void Associator::finish()
+{
+    advance(INT64_MAX - opt_.window_ms - opt_.latency_ms);
+}
+
+//  ========== emit ========================================================================
+void Associator::emit(Candidate &c, bool final, int64_t now_ms)
+{
+    Event ev;
+    ev.id = c.id;
+    ev.final = final;
+    ev.triggers = c.triggers;
+    ev.origin_ms = c.first_ms;
+    // final: up to the last trigger that joined
+    if (final) {
+        now_ms = c.first_ms;
+        for (const auto &t : c.triggers) {
+            now_ms = std::max(now_ms, t.received_ms);
+        }
+    }
+    ev.latency_ms = now_ms - c.first_ms;
+    locate(ev);
+    handler_(ev);
+}
+
+//  ========== locate ======================================================================
+// least squares on (x, y, origin time) with a constant apparent velocity, Levenberg-
+// Marquardt damped; with fewer than three located onsets the event is put at the
+// first triggered station
+void Associator::locate(Event &ev) const
+{
+    std::vector<Pick> picks;
+    int64_t t_ref = ev.triggers.front().onset_ms;
+    for (const auto &t : ev.triggers) {
+        const Station &s = stations_[t.station];
+        if (s.located) {
+            picks.push_back({s.x, s.y, (t.onset_ms - t_ref) / 1000.0, t.timed ? 1.0 : 0.1});
+        }
+    }
+    if (picks.empty()) {
+        return;
+    }
+
+    ev.located = true;
+    ev.used = 1;
+    double x = picks[0].x;
+    double y = picks[0].y;
+    double t0 = picks[0].t_s;
+
+    if (picks.size() >= 3) {
+        // start from the centroid, earlier onsets weigh more
+        double sw = 0.0, cx = 0.0, cy = 0.0;
+        for (size_t i = 0; i < picks.size(); i++) {
+            double w = 1.0 / (i + 1);
+            cx += w * picks[i].x;
+            cy += w * picks[i].y;
+            sw += w;
+        }
+        double px = cx / sw, py = cy / sw;
+        double pt = picks[0].t_s - std::hypot(px - picks[0].x, py - picks[0].y) /
+                                       opt_.velocity_m_s;
+        double lambda = 1e-3;
+        bool ok = true;
+
+        auto cost = [&](double cx_, double cy_, double ct_) {
+            double sum = 0.0;
+            for (const auto &p : picks) {
+                double r = p.t_s - ct_ - std::hypot(cx_ - p.x, cy_ - p.y) / opt_.velocity_m_s;
+                sum += p.w * r * r;
+            }
+            return sum;
+        };
+        double c = cost(px, py, pt);
+
+        for (int it = 0; it < LOCATE_ITERATIONS && ok; it++) {
+            double a[3][3] = {};
+            double b[3] = {};
+            for (const auto &p : picks) {
+                double d = std::max(std::hypot(px - p.x, py - p.y), 1.0);
+                double r = p.t_s - pt - d / opt_.velocity_m_s;
+                double j[3] = {(px - p.x) / (d * opt_.velocity_m_s),
+                               (py - p.y) / (d * opt_.velocity_m_s), 1.0};
+                for (int m = 0; m < 3; m++) {
+                    for (int n = 0; n < 3; n++) {
+                        a[m][n] += p.w * j[m] * j[n];
+                    }
+                    b[m] += p.w * j[m] * r;
+                }
+            }
+            for (int m = 0; m < 3; m++) {
+                a[m][m] *= 1.0 + lambda;
+            }
+            if (!solve3(a, b)) {
+                ok = false;
+                break;
+            }
+            double nc = cost(px + b[0], py + b[1], pt + b[2]);
+            if (nc < c) {
+                px += b[0];
+                py += b[1];
+                pt += b[2];
+                lambda = std::max(lambda / 10.0, 1e-9);
+                if (c - nc < 1e-12) {
+                    c = nc;
+                    break;
+                }
+                c = nc;
+            } else {
+                lambda *= 10.0;
+            }
+        }
+
+        double sw_all = 0.0;
+        for (const auto &p : picks) {
+            sw_all += p.w;
+        }
+        if (ok && std::isfinite(px) && std::isfinite(py) && std::isfinite(pt)) {
+            x = px;
+            y = py;
+            t0 = pt;
+            ev.used = picks.size();
+            ev.rms_ms = std::sqrt(c / sw_all) * 1000.0;
+        }
+    }
+
+    ev.x = x;
+    ev.y = y;
+    ev.origin_ms = t_ref + static_cast<int64_t>(std::llround(t0 * 1000.0));
+    ev.lat = lat0_ + y / EARTH_RADIUS_M / DEG;
+    ev.lon = lon0_ + x / (EARTH_RADIUS_M * std::cos(lat0_ * DEG)) / DEG;
+}
+
+//  ========== load_stations ===============================================================
+std::vector<Station> load_stations(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    std::vector<Station> stations;
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        std::string_view l = trim(line);
+        if (l.empty() || l.front() == '#') {
+            continue;
+        }
+
+        size_t c1 = l.find(',');
+        size_t c2 = c1 == std::string_view::npos ? c1 : l.find(',', c1 + 1);
+        Station s;
+        if (c2 == std::string_view::npos || !parse_double(l.substr(c1 + 1, c2 - c1 - 1), s.lat) ||
+            !parse_double(l.substr(c2 + 1), s.lon)) {
+            if (n == 1) {
+                continue;   // header
+            }
+            throw std::runtime_error(path + ":" + std::to_string(n) + ": expected device,lat,lon");
+        }
+        s.device = std::string(trim(l.substr(0, c1)));
+        s.located = true;
+        stations.push_back(std::move(s));
+    }
+    return stations;
+}
+
+} // namespace ingest
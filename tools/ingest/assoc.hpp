@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_ASSOC_HPP
+#define INGEST_ASSOC_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+struct AssocOptions {
+    int64_t window_ms = 2000;       // largest onset spread of one event across the array
+    int64_t latency_ms = 60000;     // trigger frames older than this on arrival are late
+    size_t min_stations = 3;        // k of the k-of-n rule
+    double velocity_m_s = 1000.0;   // apparent velocity used by the location
+};
+
+// a node, located when it comes from the stations file; x/y are metres east/north of the
+// mean position of the located stations
+struct Station {
+    std::string device;
+    bool located = false;
+    double lat = 0.0;
+    double lon = 0.0;
+    double x = 0.0;
+    double y = 0.0;
+};
+
+// one decoded trigger frame (uplink_schema.json, port 6)
+struct Trigger {
+    uint32_t station = 0;       // Associator::station() index
+    uint8_t seq = 0;            // window sequence number on the node
+    int64_t onset_ms = 0;       // epoch ms, node clock
+    bool timed = false;         // onset from the sample timestamps
+    uint16_t ratio_x10 = 0;
+    uint16_t sta = 0;
+    int64_t received_ms = 0;    // network server reception time
+};
+
+struct Event {
+    uint64_t id = 0;
+    bool final = false;         // false when sent at confirmation, true when closed
+    std::vector<Trigger> triggers;      // sorted by onset
+    int64_t origin_ms = 0;      // estimated origin time, first onset if not located
+    bool located = false;
+    size_t used = 0;            // onsets in the solution, 1: position of the first station
+    double x = 0.0;
+    double y = 0.0;
+    double lat = 0.0;
+    double lon = 0.0;
+    double rms_ms = 0.0;        // onset residual of the location
+    int64_t latency_ms = 0;     // first onset to the reception of the confirming (or last) trigger
+};
+
+struct AssocStats {
+    uint64_t triggers = 0;
+    uint64_t duplicates = 0;
+    uint64_t late = 0;
+    uint64_t candidates = 0;    // groups of triggers opened
+    uint64_t confirmed = 0;
+    uint64_t rejected = 0;      // groups closed below min_stations, single node noise
+};
+
+using EventHandler = std::function<void(const Event &)>;
+
+// k-of-n coincidence over trigger onsets: triggers whose onsets fit in window_ms form a
+// candidate event, confirmed (and emitted) as soon as min_stations distinct nodes are in,
+// then emitted again as final once no more triggers can join (latency_ms after the first
+// onset, by network reception time). Triggers may arrive in any order within latency_ms.
+// Work per trigger is bounded by the few candidates open at a time, not by the network.
+class Associator {
+public:
+    Associator(AssocOptions opt, std::vector<Station> stations, EventHandler handler);
+
+    uint32_t station(std::string_view device);     // unknown devices are added, unlocated
+    const Station &station_at(uint32_t i) const { return stations_[i]; }
+    size_t located_stations() const { return located_; }
+
+    void add(const Trigger &t);
+    void advance(int64_t now_ms);   // reception time of any uplink, closes old candidates
+    void finish();
+    AssocStats &stats() { return stats_; }
+
+private:
+    struct Candidate {
+        uint64_t id = 0;
+        int64_t first_ms = 0;
+        int64_t last_ms = 0;
+        bool confirmed = false;
+        std::vector<Trigger> triggers;
+    };
+
+    AssocOptions opt_;
+    std::vector<Station> stations_;
+    std::unordered_map<std::string, uint32_t> index_;
+    size_t located_ = 0;
+    double lat0_ = 0.0;
+    double lon0_ = 0.0;
+    EventHandler handler_;
+    AssocStats stats_;
+    std::deque<Candidate> open_;
+    uint64_t next_id_ = 1;
+    int64_t now_ms_ = 0;
+
+    void emit(Candidate &c, bool final, int64_t now_ms);
+    void locate(Event &ev) const;
+};
+
+//  ========== prototypes ==================================================================
+// "device,lat,lon" per line, # comments and a header line allowed;
+// throws std::runtime_error on unreadable files or malformed lines
+std::vector<Station> load_stations(const std::string &path);
+
+} // namespace ingest
+
+#endif /* INGEST_ASSOC_HPP */
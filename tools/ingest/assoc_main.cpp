@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// sixsens-assoc: associate the trigger frames of several nodes into events, see README
+
+//  ========== includes ====================================================================
+#include "assoc.hpp"
+#include "base64.hpp"
+#include "json_scan.hpp"
+#include "mapped_file.hpp"
+#include "timeutil.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "uplink_schema.h"
+}
+
+namespace {
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options] uplinks.json...\n"
+                 "  --stations FILE    node positions, device,lat,lon per line\n"
+                 "  -k N               distinct nodes needed to confirm an event (default 3)\n"
+                 "  --window MS        largest onset spread of one event (default 2000)\n"
+                 "  --latency S        trigger frames arrive within S seconds (default 60)\n"
+                 "  --velocity M/S     apparent velocity for the location (default 1000)\n"
+                 "events are written to stdout, one JSON object per line;\n"
+                 "- reads stdin line by line (e.g. mosquitto_sub output) and emits as it goes\n",
+                 prog);
+}
+
+//  ========== print_event =================================================================
+void print_event(const ingest::Associator &assoc, const ingest::Event &ev)
+{
+    char origin[32];
+    int len = ingest::format_iso_ms(ev.origin_ms, origin);
+
+    std::printf("{\"event\":%llu,\"status\":\"%s\",\"origin\":\"%.*s\",\"origin_ms\":%lld,"
+                "\"nodes\":%zu,\"latency_ms\":%lld",
+                (unsigned long long)ev.id, ev.final ? "final" : "confirmed", len, origin,
+                (long long)ev.origin_ms, ev.triggers.size(), (long long)ev.latency_ms);
+    if (ev.located) {
+        std::printf(",\"lat\":%.6f,\"lon\":%.6f,\"x_m\":%.0f,\"y_m\":%.0f,\"used\":%zu,"
+                    "\"rms_ms\":%.1f",
+                    ev.lat, ev.lon, ev.x, ev.y, ev.used, ev.rms_ms);
+    }
+    std::printf(",\"triggers\":[");
+    for (size_t i = 0; i < ev.triggers.size(); i++) {
+        const ingest::Trigger &t = ev.triggers[i];
+        std::printf("%s{\"device\":\"%s\",\"seq\":%u,\"onset_ms\":%lld,\"timed\":%s,"
+                    "\"ratio\":%.1f,\"sta\":%u}",
+                    i ? "," : "", assoc.station_at(t.station).device.c_str(), t.seq,
+                    (long long)t.onset_ms, t.timed ? "true" : "false", t.ratio_x10 / 10.0,
+                    t.sta);
+    }
+    std::printf("]}\n");
+    std::fflush(stdout);
+}
+
+} // namespace
+
+//  ========== main ========================================================================
+int main(int argc, char **argv)
+{
+    ingest::AssocOptions opt;
+    std::string stations_path;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--stations") {
+            stations_path = value();
+        } else if (arg == "-k") {
+            opt.min_stations = static_cast<size_t>(std::atoi(value().c_str()));
+        } else if (arg == "--window") {
+            opt.window_ms = std::atoll(value().c_str());
+        } else if (arg == "--latency") {
+            opt.latency_ms = std::atoll(value().c_str()) * 1000;
+        } else if (arg == "--velocity") {
+            opt.velocity_m_s = std::atof(value().c_str());
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty() || opt.min_stations < 1 || opt.window_ms < 0 || opt.velocity_m_s <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        std::vector<ingest::Station> stations;
+        if (!stations_path.empty()) {
+            stations = ingest::load_stations(stations_path);
+        }
+
+        ingest::Associator assoc(opt, std::move(stations),
+                                 [&](const ingest::Event &ev) { print_event(assoc, ev); });
+        std::vector<uint8_t> payload;
+        uint64_t events = 0, bad = 0, add_ns = 0, max_ns = 0;
+
+        auto handler = [&](const ingest::Uplink &up) {
+            int64_t received_ns = 0;
+            if (!ingest::parse_rfc3339(up.received_at, received_ns)) {
+                return;
+            }
+            int64_t received_ms = received_ns / 1000000;
+
+            struct uplink_trigger f;
+            if (up.f_port != UPLINK_TRIGGER_PORT) {
+                assoc.advance(received_ms);
+                return;
+            }
+            if (!ingest::base64_decode(up.payload, payload) ||
+                uplink_trigger_decode(payload.data(), payload.size(), &f) < 0) {
+                bad++;
+                return;
+            }
+
+            ingest::Trigger t;
+            t.station = assoc.station(up.device_id);
+            t.seq = f.seq;
+            t.onset_ms = static_cast<int64_t>(f.time) * 1000 + f.ms;
+            t.timed = f.timed != 0;
+            t.ratio_x10 = f.ratio;
+            t.sta = f.sta;
+            t.received_ms = received_ms;
+
+            auto start = std::chrono::steady_clock::now();
+            assoc.add(t);
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start).count();
+            add_ns += ns;
+            max_ns = std::max(max_ns, ns);
+        };
+
+        for (const auto &path : inputs) {
+            try {
+                if (path == "-") {
+                    // live feed: one event per line, handled as soon as it is read
+                    std::string line;
+                    while (std::getline(std::cin, line)) {
+                        events += ingest::scan_uplinks(line, handler);
+                    }
+                } else {
+                    ingest::MappedFile file(path);
+                    events += ingest::scan_uplinks(file.view(), handler);
+                }
+            } catch (const std::runtime_error &e) {
+                throw std::runtime_error(path + ": " + e.what());
+            }
+        }
+        assoc.finish();
+
+        const ingest::AssocStats &st = assoc.stats();
+        std::fprintf(stderr,
+                     "%llu events, %llu triggers (%llu duplicates, %llu late, %llu bad) from "
+                     "%zu located nodes\n%llu candidates: %llu confirmed, %llu rejected\n"
+                     "association %.2f us per trigger on average, %.2f us at most\n",
+                     (unsigned long long)events, (unsigned long long)st.triggers,
+                     (unsigned long long)st.duplicates, (unsigned long long)st.late,
+                     (unsigned long long)bad, assoc.located_stations(),
+                     (unsigned long long)st.candidates, (unsigned long long)st.confirmed,
+                     (unsigned long long)st.rejected,
+                     st.triggers ? add_ns / 1000.0 / st.triggers : 0.0, max_ns / 1000.0);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "base64.hpp"
+#include <array>
+
+namespace ingest {
+namespace {
+
+constexpr uint8_t INVALID = 0xFF;
+
+constexpr std::array<uint8_t, 256> make_table()
+{
+    std::array<uint8_t, 256> t{};
+    for (auto &v : t) {
+        v = INVALID;
+    }
+    const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t i = 0; i < 64; i++) {
+        t[static_cast<uint8_t>(alphabet[i])] = i;
+    }
+    return t;
+}
+
+constexpr std::array<uint8_t, 256> TABLE = make_table();
+
+} // namespace
+
+//  ========== base64_decode ===============================================================
+bool base64_decode(std::string_view in, std::vector<uint8_t> &out)
+{
+    while (!in.empty() && in.back() == '=') {
+        in.remove_suffix(1);
+    }
+    if (in.size() % 4 == 1) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve(in.size() * 3 / 4);
+
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        uint8_t v = TABLE[c];
+        if (v == INVALID) {
+            return false;
+        }
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<uint8_t>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+} // namespace ingest
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_BASE64_HPP
+#define INGEST_BASE64_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ingest {
+
+//  ========== prototypes ==================================================================
+// decode standard base64 (padding optional) into out, which is cleared first;
+// returns false on an invalid character or length
+bool base64_decode(std::string_view in, std::vector<uint8_t> &out);
+
+} // namespace ingest
+
+#endif /* INGEST_BASE64_HPP */
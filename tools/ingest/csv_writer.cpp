@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "csv_writer.hpp"
+#include <charconv>
+#include <stdexcept>
+
+namespace ingest {
+
+//  ========== CsvWriter ===================================================================
+CsvWriter::CsvWriter(const std::string &path, std::string_view header)
+    : file_(std::fopen(path.c_str(), "wb"))
+{
+    if (!file_) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    buf_.reserve(FLUSH_SIZE + 4096);
+    buf_.append(header);
+    buf_.push_back('\n');
+}
+
+CsvWriter::~CsvWriter()
+{
+    try {
+        flush();
+    } catch (const std::exception &) {
+        // nothing left to report to, the caller flushes explicitly to see errors
+    }
+    std::fclose(file_);
+}
+
+void CsvWriter::sep()
+{
+    if (!first_) {
+        buf_.push_back(',');
+    }
+    first_ = false;
+}
+
+CsvWriter &CsvWriter::field(std::string_view s)
+{
+    sep();
+    buf_.append(s);
+    return *this;
+}
+
+CsvWriter &CsvWriter::field(int64_t v)
+{
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    sep();
+    buf_.append(tmp, res.ptr - tmp);
+    return *this;
+}
+
+CsvWriter &CsvWriter::hex(const uint8_t *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    sep();
+    for (size_t i = 0; i < len; i++) {
+        buf_.push_back(digits[data[i] >> 4]);
+        buf_.push_back(digits[data[i] & 0xF]);
+    }
+    return *this;
+}
+
+void CsvWriter::end_row()
+{
+    buf_.push_back('\n');
+    first_ = true;
+    if (buf_.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void CsvWriter::flush()
+{
+    if (!buf_.empty() && std::fwrite(buf_.data(), 1, buf_.size(), file_) != buf_.size()) {
+        throw std::runtime_error("CSV write failed");
+    }
+    buf_.clear();
+}
+
+} // namespace ingest
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_CSV_WRITER_HPP
+#define INGEST_CSV_WRITER_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+// CSV file with a fixed column list, rows are formatted into a large buffer and written
+// in big chunks; fields are written as given, callers only pass values without commas,
+// quotes or line breaks (ids, numbers, timestamps, hex)
+class CsvWriter {
+public:
+    CsvWriter(const std::string &path, std::string_view header);
+    ~CsvWriter();
+    CsvWriter(const CsvWriter &) = delete;
+    CsvWriter &operator=(const CsvWriter &) = delete;
+
+    CsvWriter &field(std::string_view s);
+    CsvWriter &field(int64_t v);
+    CsvWriter &hex(const uint8_t *data, size_t len);
+    void end_row();
+    void flush();
+
+private:
+    static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+    FILE *file_;
+    std::string buf_;
+    bool first_ = true;
+
+    void sep();
+};
+
+} // namespace ingest
+
+#endif /* INGEST_CSV_WRITER_HPP */
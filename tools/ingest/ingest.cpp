@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "ingest.hpp"
+#include "base64.hpp"
+#include "timeutil.hpp"
+
+extern "C" {
+#include "app_uplink_codec.h"
+#include "uplink_schema.h"
+}
+
+namespace ingest {
+namespace {
+
+std::string join(const std::string &dir, const std::string &name)
+{
+    return dir.empty() || dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+std::string window_key(std::string_view device, uint8_t seq)
+{
+    std::string key(device);
+    key.push_back('/');
+    key.append(std::to_string(seq));
+    return key;
+}
+
+} // namespace
+
+//  ========== Ingest ======================================================================
+Ingest::Ingest(Options opt)
+    : opt_(std::move(opt)),
+      frames_(join(opt_.out_dir, "frames.csv"), "device,received_at,f_cnt,f_port,bytes,payload"),
+      telemetry_(join(opt_.out_dir, "telemetry.csv"),
+                 "device,received_at,f_cnt,time,time_s,battery,temperature,humidity,velocity"),
+      noise_(join(opt_.out_dir, "noise.csv"),
+             "device,received_at,f_cnt,period_ms,segments,band0,band1,band2,band3,band4,band5"),
+      windows_(join(opt_.out_dir, "windows.csv"),
+               "device,window,time,time_ms,samples,fragments,received,first_received_ns,"
+               "last_received_ns,status"),
+      events_(join(opt_.out_dir, "events.csv"),
+              "device,received_at,f_cnt,window,model,class,margin,sent,duration,peak_ratio,"
+              "peak_sta,rise,hv,freq,onset0,onset1,onset2,onset3,onset4,onset5,coda0,coda1,"
+              "coda2,coda3,coda4,coda5,label")
+{
+}
+
+Ingest::~Ingest() = default;
+
+//  ========== add =========================================================================
+void Ingest::add(const Uplink &up)
+{
+    stats_.uplinks++;
+    if (up.f_port == 0 || up.payload.empty()) {
+        return;
+    }
+
+    if (!base64_decode(up.payload, payload_)) {
+        stats_.bad_frames++;
+        return;
+    }
+
+    frames_.field(up.device_id).field(up.received_at).field(up.f_cnt).field(up.f_port)
+        .field(static_cast<int64_t>(payload_.size())).hex(payload_.data(), payload_.size());
+    frames_.end_row();
+
+    switch (up.f_port) {
+    case UPLINK_TELEMETRY_PORT:
+        telemetry(up);
+        break;
+    case UPLINK_NOISE_PORT:
+        noise(up);
+        break;
+    case UPLINK_EVENT_PORT:
+        event(up);
+        break;
+    case UPLINK_WAVEFORM_FRAGMENT_PORT: {
+        int64_t received_ns = 0;
+        parse_rfc3339(up.received_at, received_ns);
+        fragment(up, received_ns);
+        break;
+    }
+    default:
+        stats_.other++;
+        break;
+    }
+}
+
+//  ========== telemetry ===================================================================
+// temperature and humidity stay in the firmware units (0.01 degC, 0.01 %RH), velocity is
+// left empty when the frame does not carry it
+void Ingest::telemetry(const Uplink &up)
+{
+    struct uplink_telemetry t;
+    if (uplink_telemetry_decode(payload_.data(), payload_.size(), &t) < 0) {
+        stats_.bad_frames++;
+        return;
+    }
+
+    char iso[32];
+    int len = format_iso_ms(static_cast<int64_t>(t.time) * 1000, iso);
+    telemetry_.field(up.device_id).field(up.received_at).field(up.f_cnt)
+        .field(std::string_view(iso, len)).field(static_cast<int64_t>(t.time))
+        .field(t.battery).field(t.temperature).field(t.humidity);
+    if (t.has_velocity) {
+        telemetry_.field(t.velocity);
+    } else {
+        telemetry_.field("");
+    }
+    telemetry_.end_row();
+    stats_.telemetry++;
+}
+
+//  ========== noise =======================================================================
+// band levels stay in the firmware unit (0.1 dB re 1 count^2/Hz), band 0 is fs/4..fs/2
+void Ingest::noise(const Uplink &up)
+{
+    struct uplink_noise n;
+    if (uplink_noise_decode(payload_.data(), payload_.size(), &n) < 0) {
+        stats_.bad_frames++;
+        return;
+    }
+
+    noise_.field(up.device_id).field(up.received_at).field(up.f_cnt).field(n.period)
+        .field(n.segments).field(n.band0).field(n.band1).field(n.band2).field(n.band3)
+        .field(n.band4).field(n.band5);
+    noise_.end_row();
+    stats_.noise++;
+}
+
+//  ========== event =======================================================================
+// features stay quantized as on the node (see enum clf_feature in src/app_classifier.h),
+// label is left empty for an analyst, tools/classifier/clf_export.py trains on it
+void Ingest::event(const Uplink &up)
+{
+    static const char *const classes[] = {"rockfall", "creep", "anthropogenic", "weather"};
+
+    struct uplink_event e;
+    if (uplink_event_decode(payload_.data(), payload_.size(), &e) < 0) {
+        stats_.bad_frames++;
+        return;
+    }
+
+    events_.field(up.device_id).field(up.received_at).field(up.f_cnt).field(e.seq)
+        .field(e.model).field(classes[e.label]).field(e.margin).field(e.sent)
+        .field(e.duration).field(e.peak_ratio).field(e.peak_sta).field(e.rise).field(e.hv)
+        .field(e.freq).field(e.onset0).field(e.onset1).field(e.onset2).field(e.onset3)
+        .field(e.onset4).field(e.onset5).field(e.coda0).field(e.coda1).field(e.coda2)
+        .field(e.coda3).field(e.coda4).field(e.coda5).field("");
+    events_.end_row();
+    stats_.classified++;
+}
+
+//  ========== fragment ====================================================================
+// collect the fragments of a window, any order; a window is dropped as incomplete when
+// it stops making sense: fragment count changed, index seen twice with other content,
+// or nothing received for Options::stale_ns (the sequence restarts at each boot)
+void Ingest::fragment(const Uplink &up, int64_t received_ns)
+{
+    struct uplink_waveform_fragment h;
+    int hdr = uplink_waveform_fragment_decode(payload_.data(), payload_.size(), &h);
+    if (hdr < 0 || h.index >= h.count) {
+        stats_.bad_frames++;
+        return;
+    }
+    stats_.fragments++;
+
+    std::string key = window_key(up.device_id, h.seq);
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+        Pending &w = it->second;
+        const std::vector<uint8_t> &slice = w.slices[h.index < w.count ? h.index : 0];
+        bool same_slice = h.index < w.count && !slice.empty() &&
+                          slice.size() == payload_.size() - hdr &&
+                          std::equal(slice.begin(), slice.end(), payload_.begin() + hdr);
+        if (same_slice) {
+            stats_.duplicates++;
+            return;
+        }
+        bool restart = w.count != h.count || received_ns - w.last_ns > opt_.stale_ns ||
+                       !w.slices[h.index].empty();
+        if (restart) {
+            window_row(w, -1, 0, "incomplete");
+            stats_.incomplete++;
+            pending_.erase(it);
+            it = pending_.end();
+        }
+    }
+
+    if (it == pending_.end()) {
+        Pending w;
+        w.device = std::string(up.device_id);
+        w.seq = h.seq;
+        w.count = h.count;
+        w.slices.resize(h.count);
+        w.first_ns = received_ns;
+        it = pending_.emplace(std::move(key), std::move(w)).first;
+    }
+
+    Pending &w = it->second;
+    w.slices[h.index].assign(payload_.begin() + hdr, payload_.end());
+    w.received++;
+    w.last_ns = received_ns;
+
+    if (w.received == w.count) {
+        complete(w);
+        pending_.erase(it);
+    }
+}
+
+//  ========== complete ====================================================================
+void Ingest::complete(Pending &w)
+{
+    std::vector<uint8_t> window;
+    for (const auto &slice : w.slices) {
+        window.insert(window.end(), slice.begin(), slice.end());
+    }
+
+    uint64_t ts_ms;
+    samples_.resize(window.size() / 2);
+    int n = uplink_window_decode(window.data(), window.size(), &ts_ms, samples_.data(),
+                                 samples_.size());
+    if (n < 0) {
+        window_row(w, -1, 0, "bad");
+        stats_.bad_frames++;
+        return;
+    }
+    samples_.resize(n);
+
+    window_row(w, static_cast<int64_t>(ts_ms), samples_.size(), "complete");
+    stats_.windows++;
+    if (opt_.mseed && !samples_.empty()) {
+        mseed_for(w.device).write(static_cast<int64_t>(ts_ms) * 1000000, samples_);
+    }
+}
+
+//  ========== window_row ==================================================================
+void Ingest::window_row(const Pending &w, int64_t start_ms, size_t samples, const char *status)
+{
+    char iso[32];
+    int len = start_ms >= 0 ? format_iso_ms(start_ms, iso) : 0;
+
+    windows_.field(w.device).field(w.seq).field(std::string_view(iso, len));
+    if (start_ms >= 0) {
+        windows_.field(start_ms);
+    } else {
+        windows_.field("");
+    }
+    windows_.field(static_cast<int64_t>(samples)).field(w.count).field(w.received)
+        .field(w.first_ns).field(w.last_ns).field(status);
+    windows_.end_row();
+}
+
+//  ========== mseed_for ===================================================================
+MseedWriter &Ingest::mseed_for(const std::string &device)
+{
+    auto it = mseed_.find(device);
+    if (it != mseed_.end()) {
+        return *it->second;
+    }
+
+    auto named = opt_.stations.find(device);
+    SeedId id{opt_.network,
+              named != opt_.stations.end() ? named->second : seed_station(device),
+              opt_.location, opt_.channel};
+    auto writer = std::make_unique<MseedWriter>(join(opt_.out_dir, device + ".mseed"), id,
+                                                opt_.sample_rate_hz);
+    return *mseed_.emplace(device, std::move(writer)).first->second;
+}
+
+//  ========== finish ======================================================================
+void Ingest::finish()
+{
+    for (auto &[key, w] : pending_) {
+        window_row(w, -1, 0, "incomplete");
+        stats_.incomplete++;
+    }
+    pending_.clear();
+
+    frames_.flush();
+    telemetry_.flush();
+    noise_.flush();
+    windows_.flush();
+    events_.flush();
+}
+
+} // namespace ingest
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_INGEST_HPP
+#define INGEST_INGEST_HPP
+
+//  ========== includes ====================================================================
+#include "csv_writer.hpp"
+#include "json_scan.hpp"
+#include "mseed.hpp"
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+struct Options {
+    std::string out_dir = ".";
+    bool mseed = true;
+    std::string network = "XX";
+    std::string location = "00";
+    std::string channel = "EHZ";                    // short period, vertical
+    double sample_rate_hz = 100.0;                  // SAMPLING_RATE_MS = 10
+    int64_t stale_ns = 3600LL * 1000000000LL;       // fragments of one window arrive within
+    std::map<std::string, std::string> stations;    // device id -> station code
+};
+
+struct Stats {
+    uint64_t events = 0;
+    uint64_t uplinks = 0;
+    uint64_t telemetry = 0;
+    uint64_t noise = 0;
+    uint64_t classified = 0;    // event frames
+    uint64_t fragments = 0;
+    uint64_t duplicates = 0;
+    uint64_t windows = 0;
+    uint64_t incomplete = 0;
+    uint64_t bad_frames = 0;
+    uint64_t other = 0;         // health, energy, trigger and unknown ports, frames.csv only
+};
+
+// decodes uplinks with the firmware frame codec (src/app_uplink_codec.c) and writes:
+//   frames.csv     every uplink, payload in hex
+//   telemetry.csv  decoded telemetry frames
+//   noise.csv      decoded noise band levels
+//   windows.csv    one row per event window, complete or not
+//   events.csv     event classes and features, with an empty label column
+//   <device>.mseed reassembled windows (with Options::mseed)
+// uplinks must be fed in reception order per device
+class Ingest {
+public:
+    explicit Ingest(Options opt);
+    ~Ingest();
+
+    void add(const Uplink &up);
+    void finish();              // flush the windows still waiting for fragments
+    Stats &stats() { return stats_; }
+
+private:
+    struct Pending {
+        std::string device;
+        uint8_t seq = 0;
+        uint16_t count = 0;     // up to 256 fragments
+        uint16_t received = 0;
+        std::vector<std::vector<uint8_t>> slices;
+        int64_t first_ns = 0;
+        int64_t last_ns = 0;
+    };
+
+    Options opt_;
+    Stats stats_;
+    std::vector<uint8_t> payload_;
+    std::vector<uint16_t> samples_;
+    CsvWriter frames_;
+    CsvWriter telemetry_;
+    CsvWriter noise_;
+    CsvWriter windows_;
+    CsvWriter events_;
+    std::unordered_map<std::string, Pending> pending_;
+    std::unordered_map<std::string, std::unique_ptr<MseedWriter>> mseed_;
+
+    void telemetry(const Uplink &up);
+    void noise(const Uplink &up);
+    void event(const Uplink &up);
+    void fragment(const Uplink &up, int64_t received_ns);
+    void complete(Pending &w);
+    void window_row(const Pending &w, int64_t start_ms, size_t samples, const char *status);
+    MseedWriter &mseed_for(const std::string &device);
+};
+
+} // namespace ingest
+
+#endif /* INGEST_INGEST_HPP */
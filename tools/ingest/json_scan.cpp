@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "json_scan.hpp"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace ingest {
+namespace {
+
+// where the scanner is in an event, decides which keys are captured
+enum class Ctx { Event, DeviceIds, UplinkMessage };
+
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : p_(text.data()), end_(text.data() + text.size()),
+                                              begin_(text.data()) {}
+
+    uint64_t run(const UplinkHandler &handler)
+    {
+        uint64_t events = 0;
+
+        skip_ws();
+        bool array = p_ < end_ && *p_ == '[';
+        if (array) {
+            p_++;
+            skip_ws();
+            if (p_ < end_ && *p_ == ']') {
+                return 0;
+            }
+        }
+
+        while (p_ < end_) {
+            Uplink up;
+            bool is_uplink = false;
+
+            if (*p_ == '{') {
+                object(Ctx::Event, up, is_uplink);
+                if (is_uplink) {
+                    handler(up);
+                }
+                events++;
+            } else {
+                skip_value();
+            }
+
+            skip_ws();
+            if (array) {
+                if (p_ < end_ && *p_ == ',') {
+                    p_++;
+                    skip_ws();
+                    continue;
+                }
+                expect(']');
+                skip_ws();
+                if (p_ != end_) {
+                    fail("trailing data after the event array");
+                }
+                break;
+            }
+            // event stream: objects separated by white space or commas
+            if (p_ < end_ && *p_ == ',') {
+                p_++;
+                skip_ws();
+            }
+        }
+        return events;
+    }
+
+private:
+    const char *p_;
+    const char *end_;
+    const char *begin_;
+
+    [[noreturn]] void fail(const char *what) const
+    {
+        throw std::runtime_error(std::string(what) + " at offset " +
+                                 std::to_string(p_ - begin_));
+    }
+
+    void skip_ws()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+            p_++;
+        }
+    }
+
+    void expect(char c)
+    {
+        if (p_ >= end_ || *p_ != c) {
+            fail("unexpected character");
+        }
+        p_++;
+    }
+
+    // raw string content between the quotes, escapes left in place
+    std::string_view string()
+    {
+        expect('"');
+        const char *start = p_;
+        for (;;) {
+            const char *q = static_cast<const char *>(std::memchr(p_, '"', end_ - p_));
+            if (!q) {
+                fail("unterminated string");
+            }
+            // a quote is escaped when preceded by an odd number of backslashes
+            const char *b = q;
+            while (b > start && b[-1] == '\\') {
+                b--;
+            }
+            p_ = q + 1;
+            if (((q - b) & 1) == 0) {
+                return std::string_view(start, q - start);
+            }
+        }
+    }
+
+    std::string_view number()
+    {
+        const char *start = p_;
+        while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || *p_ == '-' || *p_ == '+' ||
+                             *p_ == '.' || *p_ == 'e' || *p_ == 'E')) {
+            p_++;
+        }
+        if (p_ == start) {
+            fail("number expected");
+        }
+        return std::string_view(start, p_ - start);
+    }
+
+    template <typename T>
+    T integer()
+    {
+        skip_ws();
+        T value = 0;
+        std::string_view digits = number();
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (ec != std::errc() || ptr != digits.data() + digits.size()) {
+            fail("integer expected");
+        }
+        return value;
+    }
+
+    std::string_view string_value()
+    {
+        skip_ws();
+        if (p_ < end_ && *p_ == '"') {
+            return string();
+        }
+        skip_value();
+        return {};
+    }
+
+    // skip any value, strings are jumped over with memchr and containers by depth only
+    void skip_value()
+    {
+        skip_ws();
+        if (p_ >= end_) {
+            fail("value expected");
+        }
+        char c = *p_;
+        if (c == '"') {
+            string();
+            return;
+        }
+        if (c != '{' && c != '[') {
+            // number, true, false or null
+            while (p_ < end_ && !std::strchr(",}] \n\r\t", *p_)) {
+                p_++;
+            }
+            return;
+        }
+
+        int depth = 0;
+        while (p_ < end_) {
+            c = *p_;
+            if (c == '"') {
+                string();
+                continue;
+            }
+            p_++;
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return;
+                }
+            }
+        }
+        fail("unterminated container");
+    }
+
+    void object(Ctx ctx, Uplink &up, bool &is_uplink)
+    {
+        skip_ws();
+        expect('{');
+        skip_ws();
+        if (p_ < end_ && *p_ == '}') {
+            p_++;
+            return;
+        }
+
+        for (;;) {
+            skip_ws();
+            std::string_view key = string();
+            skip_ws();
+            expect(':');
+            skip_ws();
+
+            bool nested = p_ < end_ && *p_ == '{';
+            switch (ctx) {
+            case Ctx::Event:
+                if (key == "data" && nested) {
+                    object(Ctx::Event, up, is_uplink);
+                } else if (key == "end_device_ids" && nested) {
+                    object(Ctx::DeviceIds, up, is_uplink);
+                } else if (key == "uplink_message" && nested) {
+                    is_uplink = true;
+                    object(Ctx::UplinkMessage, up, is_uplink);
+                } else if (key == "received_at") {
+                    up.received_at = string_value();
+                } else {
+                    skip_value();
+                }
+                break;
+
+            case Ctx::DeviceIds:
+                if (key == "device_id") {
+                    up.device_id = string_value();
+                } else {
+                    skip_value();
+                }
+                break;
+
+            case Ctx::UplinkMessage:
+                if (key == "f_port") {
+                    up.f_port = integer<int>();
+                } else if (key == "f_cnt") {
+                    up.f_cnt = integer<int64_t>();
+                } else if (key == "frm_payload") {
+                    up.payload = string_value();
+                } else if (key == "received_at" && up.received_at.empty()) {
+                    up.received_at = string_value();
+                } else {
+                    skip_value();
+                }
+                break;
+            }
+
+            skip_ws();
+            if (p_ < end_ && *p_ == ',') {
+                p_++;
+                continue;
+            }
+            expect('}');
+            return;
+        }
+    }
+};
+
+} // namespace
+
+//  ========== scan_uplinks ================================================================
+uint64_t scan_uplinks(std::string_view text, const UplinkHandler &handler)
+{
+    return Scanner(text).run(handler);
+}
+
+} // namespace ingest
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_JSON_SCAN_HPP
+#define INGEST_JSON_SCAN_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+// the fields of one TTN uplink event, views into the input text (no copy); string values
+// are kept as written, the fields used here never contain escapes
+struct Uplink {
+    std::string_view device_id;
+    std::string_view received_at;
+    std::string_view payload;       // frm_payload, base64
+    int f_port = 0;                 // zero values are omitted from TTN JSON
+    int64_t f_cnt = 0;
+};
+
+using UplinkHandler = std::function<void(const Uplink &)>;
+
+//  ========== prototypes ==================================================================
+// scan a TTN export: a JSON array of events (console export, "data" wrapper) or a stream
+// of events (webhook / MQTT captures, one object after the other); only the uplink
+// fields are looked at, everything else is skipped without being parsed.
+// returns the number of events seen, throws std::runtime_error on malformed input
+uint64_t scan_uplinks(std::string_view text, const UplinkHandler &handler);
+
+} // namespace ingest
+
+#endif /* INGEST_JSON_SCAN_HPP */
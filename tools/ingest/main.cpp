@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// sixsens-ingest: decode TTN uplink exports of the geophone nodes, see README
+
+//  ========== includes ====================================================================
+#include "ingest.hpp"
+#include "mapped_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options] export.json...\n"
+                 "  -o DIR             output directory (default .)\n"
+                 "  --no-mseed         do not write miniSEED files\n"
+                 "  --network NN       SEED network code (default XX)\n"
+                 "  --location LL      SEED location code (default 00)\n"
+                 "  --channel CCC      SEED channel code (default EHZ)\n"
+                 "  --station DEV=STA  SEED station code of a device (default: from its id)\n"
+                 "  --rate HZ          sampling rate of the windows (default 100)\n"
+                 "  --stale S          drop a window after S seconds without fragment (3600)\n"
+                 "files are processed in the given order, pass them oldest first; - is stdin\n",
+                 prog);
+}
+
+} // namespace
+
+//  ========== main ========================================================================
+int main(int argc, char **argv)
+{
+    ingest::Options opt;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-o") {
+            opt.out_dir = value();
+        } else if (arg == "--no-mseed") {
+            opt.mseed = false;
+        } else if (arg == "--network") {
+            opt.network = value();
+        } else if (arg == "--location") {
+            opt.location = value();
+        } else if (arg == "--channel") {
+            opt.channel = value();
+        } else if (arg == "--station") {
+            std::string m = value();
+            size_t eq = m.find('=');
+            if (eq == std::string::npos) {
+                usage(argv[0]);
+                return 2;
+            }
+            opt.stations[m.substr(0, eq)] = m.substr(eq + 1);
+        } else if (arg == "--rate") {
+            opt.sample_rate_hz = std::atof(value().c_str());
+        } else if (arg == "--stale") {
+            opt.stale_ns = std::atoll(value().c_str()) * 1000000000LL;
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty() || opt.sample_rate_hz <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+
+    try {
+        ingest::Ingest ing(opt);
+        for (const auto &path : inputs) {
+            ingest::MappedFile file(path);
+            bytes += file.view().size();
+            try {
+                ing.stats().events += ingest::scan_uplinks(
+                    file.view(), [&](const ingest::Uplink &up) { ing.add(up); });
+            } catch (const std::runtime_error &e) {
+                throw std::runtime_error(path + ": " + e.what());
+            }
+        }
+        ing.finish();
+
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                       .count();
+        const ingest::Stats &st = ing.stats();
+        std::fprintf(stderr,
+                     "%llu events, %llu uplinks: %llu telemetry, %llu noise, %llu classified, "
+                     "%llu fragments "
+                     "(%llu duplicates), %llu windows, %llu incomplete, %llu other, "
+                     "%llu bad\n%.1f MB in %.2f s\n",
+                     (unsigned long long)st.events, (unsigned long long)st.uplinks,
+                     (unsigned long long)st.telemetry, (unsigned long long)st.noise,
+                     (unsigned long long)st.classified,
+                     (unsigned long long)st.fragments,
+                     (unsigned long long)st.duplicates, (unsigned long long)st.windows,
+                     (unsigned long long)st.incomplete, (unsigned long long)st.other,
+                     (unsigned long long)st.bad_frames, bytes / 1e6, s);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
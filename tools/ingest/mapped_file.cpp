@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ingest {
+
+//  ========== MappedFile ==================================================================
+MappedFile::MappedFile(const std::string &path)
+{
+    if (path == "-") {
+        data_.assign(std::istreambuf_iterator<char>(std::cin), {});
+        view_ = data_;
+        return;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) < 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path + ": " + std::strerror(errno));
+        }
+        ::madvise(map_, size_, MADV_SEQUENTIAL);
+        view_ = std::string_view(static_cast<const char *>(map_), size_);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (map_ && map_ != MAP_FAILED) {
+        ::munmap(map_, size_);
+    }
+}
+
+} // namespace ingest
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_MAPPED_FILE_HPP
+#define INGEST_MAPPED_FILE_HPP
+
+//  ========== includes ====================================================================
+#include <string>
+#include <string_view>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+// read-only view of a whole input file, stdin ("-") is read into memory;
+// throws std::runtime_error when the file cannot be opened or mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view view() const { return view_; }
+
+private:
+    void *map_ = nullptr;
+    size_t size_ = 0;
+    std::string data_;
+    std::string_view view_;
+};
+
+} // namespace ingest
+
+#endif /* INGEST_MAPPED_FILE_HPP */
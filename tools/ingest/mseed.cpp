@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "mseed.hpp"
+#include "timeutil.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace ingest {
+namespace {
+
+constexpr size_t HEADER_SIZE = 48;
+constexpr size_t B1000_SIZE = 8;
+constexpr size_t DATA_OFFSET = 64;          // header and blockette 1000, 64-byte aligned
+constexpr size_t SAMPLES_PER_RECORD = (MseedWriter::RECORD_SIZE - DATA_OFFSET) / 2;
+constexpr uint8_t ENCODING_INT16 = 1;
+constexpr uint8_t RECORD_LENGTH_EXP = 9;    // 2^9 = 512
+
+void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v >> 16);
+    put_u16(p + 2, v & 0xFFFF);
+}
+
+// space padded fixed width field
+void put_field(uint8_t *p, const std::string &s, size_t width)
+{
+    std::memset(p, ' ', width);
+    std::memcpy(p, s.data(), std::min(s.size(), width));
+}
+
+// sample rate factor and multiplier of the fixed header
+void rate_factors(double hz, int16_t &factor, int16_t &multiplier)
+{
+    if (hz >= 1.0 && std::floor(hz) == hz && hz <= 32767) {
+        factor = static_cast<int16_t>(hz);
+        multiplier = 1;
+    } else if (hz < 1.0 && hz > 0) {
+        factor = static_cast<int16_t>(-std::lround(1.0 / hz));
+        multiplier = 1;
+    } else {
+        factor = static_cast<int16_t>(std::lround(hz * 100));
+        multiplier = -100;
+    }
+}
+
+} // namespace
+
+//  ========== MseedWriter =================================================================
+MseedWriter::MseedWriter(const std::string &path, SeedId id, double sample_rate_hz)
+    : file_(std::fopen(path.c_str(), "wb")), id_(std::move(id)), rate_hz_(sample_rate_hz)
+{
+    if (!file_) {
+        throw std::runtime_error("cannot open " + path);
+    }
+}
+
+MseedWriter::~MseedWriter()
+{
+    std::fclose(file_);
+}
+
+size_t MseedWriter::write(int64_t start_ns, const std::vector<uint16_t> &samples)
+{
+    int16_t factor, multiplier;
+    rate_factors(rate_hz_, factor, multiplier);
+
+    size_t records = 0;
+    for (size_t first = 0; first < samples.size(); first += SAMPLES_PER_RECORD) {
+        uint8_t rec[RECORD_SIZE] = {0};
+        size_t n = std::min(SAMPLES_PER_RECORD, samples.size() - first);
+        int64_t t_ns = start_ns + static_cast<int64_t>(std::llround(first * 1e9 / rate_hz_));
+        CivilTime t = civil_from_epoch_ns(t_ns);
+
+        // fixed section of data header
+        char seq[7];
+        std::snprintf(seq, sizeof(seq), "%06u", sequence_++ % 1000000);
+        std::memcpy(rec, seq, 6);
+        rec[6] = 'D';
+        rec[7] = ' ';
+        put_field(rec + 8, id_.station, 5);
+        put_field(rec + 13, id_.location, 2);
+        put_field(rec + 15, id_.channel, 3);
+        put_field(rec + 18, id_.network, 2);
+        put_u16(rec + 20, static_cast<uint16_t>(t.year));
+        put_u16(rec + 22, static_cast<uint16_t>(t.yday));
+        rec[24] = static_cast<uint8_t>(t.hour);
+        rec[25] = static_cast<uint8_t>(t.minute);
+        rec[26] = static_cast<uint8_t>(t.second);
+        put_u16(rec + 28, static_cast<uint16_t>(t.nanos / 100000));   // 0.0001 s
+        put_u16(rec + 30, static_cast<uint16_t>(n));
+        put_u16(rec + 32, static_cast<uint16_t>(factor));
+        put_u16(rec + 34, static_cast<uint16_t>(multiplier));
+        rec[39] = 1;                                // blockettes that follow
+        put_u32(rec + 40, 0);                       // time correction
+        put_u16(rec + 44, DATA_OFFSET);
+        put_u16(rec + 46, HEADER_SIZE);
+
+        // blockette 1000: data only SEED
+        put_u16(rec + HEADER_SIZE, 1000);
+        put_u16(rec + HEADER_SIZE + 2, 0);
+        rec[HEADER_SIZE + 4] = ENCODING_INT16;
+        rec[HEADER_SIZE + 5] = 1;                   // big-endian
+        rec[HEADER_SIZE + 6] = RECORD_LENGTH_EXP;
+        static_assert(HEADER_SIZE + B1000_SIZE <= DATA_OFFSET, "blockette overlaps data");
+
+        for (size_t i = 0; i < n; i++) {
+            put_u16(rec + DATA_OFFSET + 2 * i, samples[first + i]);
+        }
+
+        if (std::fwrite(rec, 1, RECORD_SIZE, file_) != RECORD_SIZE) {
+            throw std::runtime_error("miniSEED write failed");
+        }
+        records++;
+    }
+    return records;
+}
+
+//  ========== seed_station ================================================================
+std::string seed_station(const std::string &device_id)
+{
+    std::string out;
+    for (char c : device_id) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+            if (out.size() == 5) {
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace ingest
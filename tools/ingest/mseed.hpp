@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_MSEED_HPP
+#define INGEST_MSEED_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+struct SeedId {
+    std::string network;    // up to 2 characters
+    std::string station;    // up to 5
+    std::string location;   // up to 2
+    std::string channel;    // up to 3
+};
+
+// miniSEED 2.4 writer: 512-byte records, 16-bit integer samples (encoding 1),
+// big-endian, one blockette 1000 per record. Records of successive windows are appended
+// to the same file, readers (ObsPy, libmseed) merge them by time
+class MseedWriter {
+public:
+    static constexpr size_t RECORD_SIZE = 512;
+
+    MseedWriter(const std::string &path, SeedId id, double sample_rate_hz);
+    ~MseedWriter();
+    MseedWriter(const MseedWriter &) = delete;
+    MseedWriter &operator=(const MseedWriter &) = delete;
+
+    // write one window, start time in epoch ns; returns the number of records
+    size_t write(int64_t start_ns, const std::vector<uint16_t> &samples);
+
+private:
+    FILE *file_;
+    SeedId id_;
+    double rate_hz_;
+    uint32_t sequence_ = 1;
+};
+
+// SEED station code from a device id: letters and digits, upper case, 5 at most
+std::string seed_station(const std::string &device_id);
+
+} // namespace ingest
+
+#endif /* INGEST_MSEED_HPP */
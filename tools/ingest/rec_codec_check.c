@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// round trip of the recorder block codec (src/app_rec_codec.c) on host: sample sequences
+// are packed into blocks, checked, decoded and compared; exits non-zero on a mismatch
+
+//  ========== includes ====================================================================
+#include "app_rec_codec.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//  ========== defines =====================================================================
+#define CHECK_SAMPLES           20000
+
+//  ========== globals =====================================================================
+static uint16_t in[CHECK_SAMPLES];
+static uint16_t out[CHECK_SAMPLES];
+static uint8_t block[REC_BLOCK_SIZE] __attribute__((aligned(4)));
+static uint32_t rng = 1;
+
+//  ========== helpers =====================================================================
+static uint32_t next(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static size_t decode_block(size_t at)
+{
+    int n = rec_block_decode(block, 0, &out[at], CHECK_SAMPLES - at);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+// encode in[] into successive blocks, decoding each one as it is sealed; returns the
+// number of wrong samples
+static size_t roundtrip(const char *name)
+{
+    struct rec_encoder enc;
+    size_t done = 0, wrong = 0, blocks = 0;
+
+    rec_encoder_start(&enc, block, 0, 0, 10, in[0]);
+    for (size_t i = 1; i <= CHECK_SAMPLES; i++) {
+        if (i < CHECK_SAMPLES && rec_encoder_append(&enc, in[i]) == 0) {
+            continue;
+        }
+        rec_encoder_finish(&enc, 0);
+        if (rec_block_check(block) != 0) {
+            printf("%s: block %zu fails its check\n", name, blocks);
+            return CHECK_SAMPLES;
+        }
+        done += decode_block(done);
+        blocks++;
+        if (i < CHECK_SAMPLES) {
+            rec_encoder_start(&enc, block, blocks, 0, 10, in[i]);
+        }
+    }
+
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) {
+        wrong += i >= done || out[i] != in[i];
+    }
+    printf("%-14s %zu blocks, %.2f bits/sample, %zu wrong\n", name, blocks,
+           blocks * (REC_BLOCK_SIZE * 8.0) / CHECK_SAMPLES, wrong);
+    return wrong;
+}
+
+//  ========== main ========================================================================
+int main(void)
+{
+    size_t wrong = 0;
+
+    // single-ended SAADC near 0 V: small negative readings stored as 0xFFFx
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) {
+        in[i] = (uint16_t)((int)(next() % 5) - 2);
+    }
+    wrong += roundtrip("around 0");
+
+    // quiet mid-scale signal
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) {
+        in[i] = (uint16_t)(2048 + (int)(next() % 9) - 4);
+    }
+    wrong += roundtrip("mid-scale");
+
+    // any value, every delta down to the escape
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) {
+        in[i] = (uint16_t)next();
+    }
+    wrong += roundtrip("full range");
+
+    // largest steps both ways across the wrap
+    static const uint16_t steps[] = {0x0000, 0xFFFF, 0x8000, 0x7FFF, 0x0001, 0x8001, 0xFFFE};
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) {
+        in[i] = steps[next() % (sizeof(steps) / sizeof(steps[0]))];
+    }
+    wrong += roundtrip("extreme steps");
+
+    return wrong ? EXIT_FAILURE : EXIT_SUCCESS;
+}
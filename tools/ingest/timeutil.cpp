@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "timeutil.hpp"
+#include <cstdio>
+
+namespace ingest {
+namespace {
+
+constexpr int64_t NS_PER_S = 1000000000;
+constexpr int64_t S_PER_DAY = 86400;
+
+// days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's algorithm)
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool digits(std::string_view s, size_t pos, size_t n, int &value)
+{
+    if (pos + n > s.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + n; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+int64_t floor_div(int64_t a, int64_t b)
+{
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+} // namespace
+
+//  ========== parse_rfc3339 ===============================================================
+bool parse_rfc3339(std::string_view s, int64_t &epoch_ns)
+{
+    int y, mo, d, h, mi, sec;
+    if (!digits(s, 0, 4, y) || s.size() < 19 || s[4] != '-' || !digits(s, 5, 2, mo) ||
+        s[7] != '-' || !digits(s, 8, 2, d) || (s[10] != 'T' && s[10] != ' ') ||
+        !digits(s, 11, 2, h) || s[13] != ':' || !digits(s, 14, 2, mi) || s[16] != ':' ||
+        !digits(s, 17, 2, sec)) {
+        return false;
+    }
+
+    size_t pos = 19;
+    int64_t frac = 0;
+    if (pos < s.size() && s[pos] == '.') {
+        int64_t scale = NS_PER_S;
+        pos++;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (s[pos] - '0') * scale;
+            }
+            pos++;
+        }
+    }
+
+    int64_t offset_s = 0;
+    if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+        int oh, om;
+        if (!digits(s, pos + 1, 2, oh) || pos + 3 >= s.size() || s[pos + 3] != ':' ||
+            !digits(s, pos + 4, 2, om)) {
+            return false;
+        }
+        offset_s = (s[pos] == '+' ? 1 : -1) * (oh * 3600 + om * 60);
+        pos += 6;
+    } else if (pos < s.size() && (s[pos] == 'Z' || s[pos] == 'z')) {
+        pos++;
+    } else {
+        return false;
+    }
+    if (pos != s.size()) {
+        return false;
+    }
+
+    int64_t secs = days_from_civil(y, mo, d) * S_PER_DAY + h * 3600 + mi * 60 + sec - offset_s;
+    epoch_ns = secs * NS_PER_S + frac;
+    return true;
+}
+
+//  ========== civil_from_epoch_ns =========================================================
+CivilTime civil_from_epoch_ns(int64_t epoch_ns)
+{
+    CivilTime t;
+    int64_t secs = floor_div(epoch_ns, NS_PER_S);
+    int64_t days = floor_div(secs, S_PER_DAY);
+    int64_t sod = secs - days * S_PER_DAY;
+
+    t.nanos = epoch_ns - secs * NS_PER_S;
+    t.hour = static_cast<int>(sod / 3600);
+    t.minute = static_cast<int>(sod % 3600 / 60);
+    t.second = static_cast<int>(sod % 60);
+
+    // inverse of days_from_civil
+    int64_t z = days + 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    t.day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    t.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    t.year = static_cast<int>(yoe + era * 400 + (t.month <= 2));
+    t.yday = static_cast<int>(days - days_from_civil(t.year, 1, 1) + 1);
+    return t;
+}
+
+//  ========== format_iso_ms ===============================================================
+int format_iso_ms(int64_t epoch_ms, char *out)
+{
+    CivilTime t = civil_from_epoch_ns(epoch_ms * 1000000);
+    return std::snprintf(out, 25, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", t.year, t.month,
+                         t.day, t.hour, t.minute, t.second,
+                         static_cast<int>(t.nanos / 1000000));
+}
+
+} // namespace ingest
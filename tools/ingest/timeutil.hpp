@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef INGEST_TIMEUTIL_HPP
+#define INGEST_TIMEUTIL_HPP
+
+//  ========== includes ====================================================================
+#include <cstdint>
+#include <string_view>
+
+namespace ingest {
+
+//  ========== globals =====================================================================
+struct CivilTime {
+    int year;
+    int month;          // 1..12
+    int day;            // 1..31
+    int yday;           // 1..366
+    int hour;
+    int minute;
+    int second;
+    int64_t nanos;      // 0..999999999
+};
+
+//  ========== prototypes ==================================================================
+// "2025-05-20T08:28:43.720760677Z" (any fraction length, Z or +hh:mm) to epoch ns,
+// returns false if the text is not RFC 3339
+bool parse_rfc3339(std::string_view text, int64_t &epoch_ns);
+
+CivilTime civil_from_epoch_ns(int64_t epoch_ns);
+
+// "2025-05-20T08:28:43.720Z" into out (24 characters), returns the length
+int format_iso_ms(int64_t epoch_ms, char *out);
+
+} // namespace ingest
+
+#endif /* INGEST_TIMEUTIL_HPP */
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+#
+# RAM budget report, run after each link (see CMakeLists.txt): statically allocated RAM
+# of the image grouped by use, so thread stacks and pools can be resized with the numbers
+# in front of you. Exits with an error when the image leaves less than --min-free bytes.
+# Without --ram (native_sim, no fixed RAM) the usage is reported but not checked.
+
+import argparse
+import re
+import subprocess
+import sys
+
+# first matching rule wins
+GROUPS = [
+    ("thread stacks", re.compile(r"(^z_.*stack|_stack$|stacks?_)")),
+    ("buffer pools", re.compile(r"(^_net_buf_|^net_buf_|_pool$)")),
+    ("adc ring", re.compile(r"^(ring_buffer|block_ts_us)$")),
+    ("shell / log", re.compile(r"(shell|log_)")),
+    ("kernel", re.compile(r"^(_kernel|z_|k_|_k_|_sw_isr|_thread)")),
+]
+
+
+def ram_symbols(nm, elf):
+    """(name, size) of every data, bss and noinit symbol"""
+    out = subprocess.run([nm, "-S", "--size-sort", elf], check=True,
+                         capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4 or parts[2] not in "bBdD":
+            continue
+        yield parts[3], int(parts[1], 16)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="static RAM usage of a Zephyr image by group")
+    parser.add_argument("elf")
+    parser.add_argument("--nm", default="nm")
+    parser.add_argument("--ram", type=lambda v: int(v, 0),
+                        help="RAM size in bytes, omit to report only")
+    parser.add_argument("--min-free", type=lambda v: int(v, 0), default=0,
+                        help="fail when less than this is left")
+    parser.add_argument("--top", type=int, default=12)
+    args = parser.parse_args()
+
+    symbols = sorted(ram_symbols(args.nm, args.elf), key=lambda s: -s[1])
+    totals = {name: 0 for name, _ in GROUPS}
+    totals["application"] = 0
+    for name, size in symbols:
+        group = next((g for g, rule in GROUPS if rule.search(name)), "application")
+        totals[group] += size
+
+    used = sum(totals.values())
+    if args.ram:
+        free = args.ram - used
+        print(f"RAM budget: {used} / {args.ram} bytes ({100 * used // args.ram} %), {free} free")
+    else:
+        print(f"RAM budget: {used} bytes, no RAM size given, not checked")
+    for group, size in sorted(totals.items(), key=lambda t: -t[1]):
+        print(f"  {group:<16} {size:>8}")
+    print("largest symbols:")
+    for name, size in symbols[:args.top]:
+        print(f"  {name:<32} {size:>8}")
+
+    if args.ram and free < args.min_free:
+        print(f"error: {free} bytes free, budget requires {args.min_free}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())